@@ -1,43 +1,35 @@
 function GenerateOutput(compiler)
+    local wordWidth = compiler:GetWordWidth()
+    local memoryDepth = compiler:GetMemoryDepth()
     local instructionBitsCount = compiler:GetBitBufferSize()
-    if instructionBitsCount % 18 ~= 0 then
+    if instructionBitsCount % wordWidth ~= 0 then
         return Exception.MakeCompilerImplementationError(
-            "The number of bits in the instruction buffer is not a multiple of 18."
+            "The number of bits in the instruction buffer is not a multiple of " .. wordWidth .. "."
         )
     end
 
-    if instructionBitsCount > 18 * 1024 then
+    if instructionBitsCount > wordWidth * memoryDepth then
         return Exception.MakeCompileError(
-            "The number of bits in the instruction buffer exceeds the maximum allowed size of 18 * 1024 bits."
+            "The number of bits in the instruction buffer exceeds the maximum allowed size of " .. wordWidth
+                .. " * " .. memoryDepth .. " bits."
         )
     end
 
-    local index = 1
-    local output = "@00000000\n"
-    local bitBuffer = compiler:GetBitBuffer()
+    local words, size = Native.GetBits(Native.Bind(compiler))
+    local instructionCount = math.floor(size / wordWidth)
+    local wordFormat = "%0" .. math.ceil(wordWidth / 4) .. "X"
+    local lines = { "@00000000" }
 
-    -- Padding to exactly 1024 instructions
-    local bitsToAdd = 18 * 1024 - #bitBuffer
-    for i = 1, bitsToAdd do
-        bitBuffer:add(0)
+    -- Read whole words straight from the packed buffer, a loop LuaJIT compiles
+    for index = 0, instructionCount - 1 do
+        lines[#lines + 1] = string.format(wordFormat, Native.ReadWord(words, size, index, wordWidth))
     end
 
-    local bit = require("bit32")
-
-    while index <= #bitBuffer do
-        local instruction = 0
-
-        -- Read 18 bits (LSB first, i = 0 is lowest bit)
-        for i = 0, 17 do
-            if bitBuffer[index + i] == 1 then
-                instruction = bit.bor(instruction, bit.lshift(1, i))
-            end
-        end
-
-        local hexInstruction = string.format("%05X", instruction)
-        output = output .. hexInstruction .. "\n"
-        index = index + 18
+    -- Padding to exactly memoryDepth instructions
+    local padding = string.format(wordFormat, 0)
+    for index = instructionCount, memoryDepth - 1 do
+        lines[#lines + 1] = padding
     end
 
-    return output
+    return table.concat(lines, "\n") .. "\n"
 end
@@ -42,18 +42,13 @@ function Lib.ParseSimpleUnsigned(tokenStream, str) -- 8 bit unsigned immediate v
     return tonumber(str, 16)
 end
 
+-- returned by a handler, a Diagnostic is recorded at the current token and compiling goes on with the next line
 function Exception.MakeCompileErrorWithLocation(tokenStream, message)
-    local position = tokenStream:GetApproxCurrentLocation()
-    return Exception.MakeCompileError(
-        "Compile Error " .. position .. ": " .. message
-    )
+    return Diagnostic.MakeError(tokenStream, message)
 end
 
 function Exception.MakeLinkErrorWithLocation(tokenStream, message)
-    local position = tokenStream:GetApproxCurrentLocation()
-    return Exception.MakeLinkError(
-        "Link Error " .. position .. ": " .. message
-    )
+    return Diagnostic.MakeError(tokenStream, message)
 end
 
 function Exception.MakeCompilerImplementationErrorWithLocation(tokenStream, message)
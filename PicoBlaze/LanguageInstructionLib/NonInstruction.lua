@@ -1,13 +1,11 @@
 function AddLabel(compiler, label)
-    local linkerContext = compiler:GetLinkerContext()
-    if linkerContext.LabelToAddressMap[label] ~= nil then
+    local symbolTable = compiler:GetSymbolTable()
+    if not symbolTable:DefineLabel(label, compiler:GetBitBufferSize() / compiler:GetWordWidth()) then
         return Exception.MakeCompileErrorWithLocation(
             compiler:GetTokenStream(),
             "Label '" .. label .. "' is already defined."
         )
     end
-
-    linkerContext.LabelToAddressMap[label] = compiler:GetBitBufferSize() / 18
 end
 
 function CheckLabelValid(compiler, token)
@@ -5,18 +5,20 @@ function ParseAddress(compiler)
         return Exception.MakeCompileErrorWithLocation(tokenStream, "No token found in the token stream.")
     end
     local address = Lib.ParseSimpleUnsigned(tokenStream, thisToken)
-    if address == nil or address < 0 or address > 1023 then
+    local maxAddress = compiler:GetMemoryDepth() - 1
+    if address == nil or address < 0 or address > maxAddress then
         return Exception.MakeCompileErrorWithLocation(
             tokenStream,
-            "Invalid address value: '" .. thisToken .. "'. Expected a value between 0 and 1023."
+            "Invalid address value: '" .. thisToken .. "'. Expected a value between 0 and " .. maxAddress .. "."
         )
     end
+    local wordWidth = compiler:GetWordWidth()
     local BitBufferSize = compiler:GetBitBufferSize()
-    if 18 * address < BitBufferSize then
+    if wordWidth * address < BitBufferSize then
         return Exception.MakeCompileErrorWithLocation(
             tokenStream,
             "Address value '" .. address .. "' is too small for the current bit buffer size of " .. BitBufferSize .. "."
         )
     end
-    compiler:WriteUnsignedNumber(0, 18 * address - BitBufferSize)
+    compiler:WriteUnsignedNumber(0, wordWidth * address - BitBufferSize)
 end
\ No newline at end of file
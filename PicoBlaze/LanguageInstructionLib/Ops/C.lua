@@ -8,14 +8,15 @@ function ProcessCall(compiler)
     local thisToken, conditionToWrite = Util.GetPossibleCondition(tokenStream, thisToken)
 
     local Address = Lib.ParseSimpleUnsigned(tokenStream, thisToken)
+    local maxAddress = compiler:GetMemoryDepth() - 1
     if Address == nil then
         Util.WriteDummyAddress(compiler, thisToken)
-    elseif Address >= 0 and Address <= 1023 then
-        compiler:WriteUnsignedNumber(Address, 10)
+    elseif Address >= 0 and Address <= maxAddress then
+        compiler:WriteUnsignedNumber(Address, compiler:GetAddressWidth())
     else
         return Exception.MakeCompileErrorWithLocation(
             tokenStream,
-            "Address value '" .. Address .. "' is out of range. Expected a value between 0 and 1023."
+            "Address value '" .. Address .. "' is out of range. Expected a value between 0 and " .. maxAddress .. "."
         )
     end
     compiler:WriteUnsignedNumber(conditionToWrite, 3)
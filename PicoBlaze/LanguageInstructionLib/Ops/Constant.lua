@@ -1,8 +1,7 @@
 function ParseConstant(compiler)
     local tokenStream = compiler:GetTokenStream()
     local thisToken = tokenStream:ParseCurrent()
-    local linkerContext = compiler:GetLinkerContext()
-    local constantTable = linkerContext.ConstantToValueMap
+    local symbolTable = compiler:GetSymbolTable()
 
     if thisToken == nil then
         return Exception.MakeCompileErrorWithLocation(
@@ -11,7 +10,7 @@ function ParseConstant(compiler)
         )
     end
 
-    if constantTable[thisToken] ~= nil then
+    if symbolTable:GetConstant(thisToken) ~= nil then
         return Exception.MakeCompileErrorWithLocation(
             tokenStream,
             "Constant '" .. thisToken .. "' is already defined."
@@ -53,5 +52,5 @@ function ParseConstant(compiler)
         )
     end
 
-    constantTable[constantName] = constantValue
+    symbolTable:DefineConstant(constantName, constantValue)
 end
\ No newline at end of file
@@ -1,10 +1,13 @@
 Util = {}
 -- Util functions for PicoBlaze assembly language
+-- Tokens and operand fields go through the FFI functions of Native rather than the sol2 bindings. Every value
+-- written here is range checked first, so the writes cannot fail and their results are not checked.
 
 function Util.WriteSimpleImmediateOrRegister(compiler)
     local tokenStream = compiler:GetTokenStream()
+    local native = Native.Bind(compiler)
 
-    local thisToken = tokenStream:ParseCurrent()
+    local thisToken = Native.ParseCurrent(native)
     if thisToken == nil then
         return Exception.MakeCompileErrorWithLocation(tokenStream, "No token found in the token stream.")
     end
@@ -20,7 +23,7 @@ function Util.WriteSimpleImmediateOrRegister(compiler)
         end
     end
 
-    thisToken = tokenStream:ParseCurrent()
+    thisToken = Native.ParseCurrent(native)
     if thisToken == nil then
         return Exception.MakeCompileErrorWithLocation(tokenStream, "No token found in the token stream.")
     end
@@ -32,7 +35,7 @@ function Util.WriteSimpleImmediateOrRegister(compiler)
     end
 
 
-    thisToken = tokenStream:ParseCurrent()
+    thisToken = Native.ParseCurrent(native)
     if thisToken == nil then
         return Exception.MakeCompileErrorWithLocation(tokenStream, "No token found in the token stream.")
     end
@@ -45,18 +48,18 @@ function Util.WriteSimpleImmediateOrRegister(compiler)
         if immValue == nil or immValue < 0 or immValue > 255 then
             Util.WriteDummyConstantData(compiler, thisToken)
         else
-            compiler:WriteUnsignedNumber(immValue, 8)
+            Native.WriteUnsigned(native, immValue, 8)
         end
-        compiler:WriteUnsignedNumber(regFirst, 4)
-        compiler:WriteUnsignedNumber(0, 1)
+        Native.WriteUnsigned(native, regFirst, 4)
+        Native.WriteUnsigned(native, 0, 1)
         return nil
     end
 
     if type(regSecond) == "number" then
-        compiler:WriteUnsignedNumber(0, 4)
-        compiler:WriteUnsignedNumber(regSecond, 4)
-        compiler:WriteUnsignedNumber(regFirst, 4)
-        compiler:WriteUnsignedNumber(1, 1)
+        Native.WriteUnsigned(native, 0, 4)
+        Native.WriteUnsigned(native, regSecond, 4)
+        Native.WriteUnsigned(native, regFirst, 4)
+        Native.WriteUnsigned(native, 1, 1)
         return nil
     end
 
@@ -68,8 +71,9 @@ end
 
 function Util.WriteAddressImmediateOrRegister(compiler)
     local tokenStream = compiler:GetTokenStream()
+    local native = Native.Bind(compiler)
 
-    local thisToken = tokenStream:ParseCurrent()
+    local thisToken = Native.ParseCurrent(native)
     if thisToken == nil then
         return Exception.MakeCompileErrorWithLocation(tokenStream, "No token found in the token stream.")
     end
@@ -85,7 +89,7 @@ function Util.WriteAddressImmediateOrRegister(compiler)
         end
     end
 
-    thisToken = tokenStream:ParseCurrent()
+    thisToken = Native.ParseCurrent(native)
     if thisToken == nil then
         return Exception.MakeCompileErrorWithLocation(tokenStream, "No token found in the token stream.")
     end
@@ -97,14 +101,14 @@ function Util.WriteAddressImmediateOrRegister(compiler)
     end
 
     -- a '(' then it is a register, or it is an immediate value
-    thisToken = tokenStream:PeekCurrent()
+    thisToken = Native.PeekCurrent(native)
     if (thisToken == nil) then
         return Exception.MakeCompileErrorWithLocation(tokenStream, "No token found in the token stream.")
     end
 
     if (thisToken ~= '(') then
         -- it is an immediate value
-        thisToken = tokenStream:ParseCurrent()
+        thisToken = Native.ParseCurrent(native)
         if thisToken == nil then
             return Exception.MakeCompileErrorWithLocation(tokenStream, "No token found in the token stream.")
         end
@@ -112,16 +116,16 @@ function Util.WriteAddressImmediateOrRegister(compiler)
         if immValue == nil or immValue < 0 or immValue > 255 then
             Util.WriteDummyConstantData(compiler, thisToken)
         else
-            compiler:WriteUnsignedNumber(immValue, 8)
+            Native.WriteUnsigned(native, immValue, 8)
         end
-        compiler:WriteUnsignedNumber(regFirst, 4)
-        compiler:WriteUnsignedNumber(0, 1)
+        Native.WriteUnsigned(native, regFirst, 4)
+        Native.WriteUnsigned(native, 0, 1)
         return nil
     end
 
     -- it is a register
     tokenStream:SkipCurrent()
-    thisToken = tokenStream:ParseCurrent()
+    thisToken = Native.ParseCurrent(native)
     if thisToken == nil then
         return Exception.MakeCompileErrorWithLocation(tokenStream, "No token found in the token stream.")
     end
@@ -137,12 +141,12 @@ function Util.WriteAddressImmediateOrRegister(compiler)
             return regSecond
         end
     else
-        compiler:WriteUnsignedNumber(0, 4)
-        compiler:WriteUnsignedNumber(regSecond, 4)
-        compiler:WriteUnsignedNumber(regFirst, 4)
-        compiler:WriteUnsignedNumber(1, 1)
+        Native.WriteUnsigned(native, 0, 4)
+        Native.WriteUnsigned(native, regSecond, 4)
+        Native.WriteUnsigned(native, regFirst, 4)
+        Native.WriteUnsigned(native, 1, 1)
         -- expect ')'
-        thisToken = tokenStream:PeekCurrent()
+        thisToken = Native.PeekCurrent(native)
         if thisToken == nil then
             return Exception.MakeCompileErrorWithLocation(tokenStream, "No token found in the token stream.")
         elseif thisToken ~= ')' then
@@ -189,23 +193,18 @@ function Util.WriteAddressImmediateOrRegister(compiler)
 end
 
 function Util.WriteDummyAddress(compiler, label)
-    local currentStart = compiler:GetBitBufferSize()
-    compiler:WriteUnsignedNumber(1023, 10)
-    local linkerContext = compiler:GetLinkerContext()
-    linkerContext.LinkAddressRequestArray[#linkerContext.LinkAddressRequestArray + 1] = {
-        Label = label,
-        Start = currentStart,
-    }
+    local native = Native.Bind(compiler)
+    local currentStart = Native.GetBitBufferSize(native)
+    local addressWidth = compiler:GetAddressWidth()
+    Native.WriteUnsigned(native, 2 ^ addressWidth - 1, addressWidth)
+    compiler:GetSymbolTable():AddAddressRelocation(label, currentStart, addressWidth)
 end
 
 function Util.WriteDummyConstantData(compiler, constantName)
-    local currentStart = compiler:GetBitBufferSize()
-    compiler:WriteUnsignedNumber(0, 8) -- Dummy value
-    local linkerContext = compiler:GetLinkerContext()
-    linkerContext.LinkConstantRequestArray[#linkerContext.LinkConstantRequestArray + 1] = {
-        ConstantName = constantName,
-        Start = currentStart,
-    }
+    local native = Native.Bind(compiler)
+    local currentStart = Native.GetBitBufferSize(native)
+    Native.WriteUnsigned(native, 0, 8) -- Dummy value
+    compiler:GetSymbolTable():AddConstantRelocation(constantName, currentStart, 8)
 end
 
 function Util.GetPossibleCondition(tokenStream, thisToken)
@@ -0,0 +1,437 @@
+export module BenchMain;
+
+import std;
+import <args.hxx>;
+import Core.Compiler;
+import Core.Parser;
+import Core.Output;
+import Core.Json;
+import Core.BitBuffer;
+import Core.Diagnostics;
+import Core.Incremental;
+import Bench.ProgramGenerator;
+import Bench.ProcessMemory;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct BenchInput {
+        std::string Name;
+        std::string Source;
+        size_t Lines = 0;
+    };
+
+    struct PhaseResult {
+        std::string Name;
+        std::vector<double> Samples; // nanoseconds for all inputs, one per measured iteration
+        size_t PeakMemoryBytes = 0;  // process peak once the phase had run every iteration
+        bool PerInput = true;        // false where lines per second mean nothing, e.g. compiler startup
+    };
+
+    struct Statistics {
+        double Min = 0;
+        double Median = 0;
+        double Mean = 0;
+        double Max = 0;
+        double StdDev = 0;
+    };
+
+    Statistics Summarize(std::vector<double> samples) {
+        Statistics statistics;
+        if (samples.empty())
+            return statistics;
+
+        std::ranges::sort(samples);
+        statistics.Min = samples.front();
+        statistics.Max = samples.back();
+        size_t middle = samples.size() / 2;
+        statistics.Median = samples.size() % 2 == 1 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+        statistics.Mean = std::reduce(samples.begin(), samples.end()) / static_cast<double>(samples.size());
+        double variance = 0;
+        for (double sample: samples) {
+            variance += (sample - statistics.Mean) * (sample - statistics.Mean);
+        }
+        statistics.StdDev = std::sqrt(variance / static_cast<double>(samples.size()));
+        return statistics;
+    }
+
+    bool SameBits(const Core::BitBuffer &lhs, const Core::BitBuffer &rhs) {
+        if (lhs.Size() != rhs.Size())
+            return false;
+        for (size_t bit = 0; bit < lhs.Size(); bit += Core::BitBuffer::WordBits) {
+            size_t bits = std::min(Core::BitBuffer::WordBits, lhs.Size() - bit);
+            if (lhs.ReadBits(bit, bits) != rhs.ReadBits(bit, bits))
+                return false;
+        }
+        return true;
+    }
+
+    std::string JoinLines(std::span<const std::string> lines) {
+        std::string source;
+        for (const auto &line: lines) {
+            source += line;
+            source += '\n';
+        }
+        return source;
+    }
+
+    template<typename Function>
+    double TimeNanoseconds(Function &&function) {
+        auto start = Clock::now();
+        function();
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    class BenchmarkRunner {
+    public:
+        BenchmarkRunner(std::filesystem::path languageRootDir, std::vector<BenchInput> inputs,
+                        size_t iterations, size_t warmup)
+            : m_LanguageRootDir(std::move(languageRootDir)), m_Inputs(std::move(inputs)),
+              m_Iterations(iterations), m_Warmup(warmup) {}
+
+        std::vector<PhaseResult> Run() {
+            std::vector<PhaseResult> results;
+            results.push_back(RunStartup());
+            results.push_back(RunLexer());
+            for (auto &result: RunAssembly()) {
+                results.push_back(std::move(result));
+            }
+            results.push_back(RunIncremental());
+            return results;
+        }
+
+    private:
+        bool IsMeasured(size_t iteration) const {
+            return iteration >= m_Warmup;
+        }
+
+        PhaseResult RunStartup() {
+            PhaseResult result{"Startup"};
+            result.PerInput = false;
+            for (size_t iteration = 0; iteration < m_Warmup + m_Iterations; ++iteration) {
+                double elapsed = TimeNanoseconds([&] {
+                    Core::Compiler compiler{m_LanguageRootDir};
+                });
+                if (IsMeasured(iteration))
+                    result.Samples.push_back(elapsed);
+            }
+            result.PeakMemoryBytes = Bench::GetPeakMemoryBytes();
+            return result;
+        }
+
+        PhaseResult RunLexer() {
+            PhaseResult result{"Lex"};
+            for (size_t iteration = 0; iteration < m_Warmup + m_Iterations; ++iteration) {
+                double elapsed = 0;
+                for (const auto &input: m_Inputs) {
+                    std::string source = input.Source;
+                    elapsed += TimeNanoseconds([&] {
+                        Core::TokenStream tokenStream{std::move(source)};
+                        while (tokenStream.ParseCurrent()) {}
+                    });
+                }
+                if (IsMeasured(iteration))
+                    result.Samples.push_back(elapsed);
+            }
+            result.PeakMemoryBytes = Bench::GetPeakMemoryBytes();
+            return result;
+        }
+
+        // Each phase needs the previous one, so they run as a pipeline per input and are timed one by one.
+        std::vector<PhaseResult> RunAssembly() {
+            std::vector<PhaseResult> results{
+                PhaseResult{"CompileAll"}, PhaseResult{"Link"}, PhaseResult{"GenerateOutput"},
+                PhaseResult{"EmitOutput(mem)"}
+            };
+
+            Core::Compiler compiler{m_LanguageRootDir};
+            for (size_t iteration = 0; iteration < m_Warmup + m_Iterations; ++iteration) {
+                std::array<double, 4> elapsed{};
+                for (const auto &input: m_Inputs) {
+                    auto sourceCompiler = compiler.CreateSourceCompiler(input.Source);
+                    elapsed[0] += TimeNanoseconds([&] { sourceCompiler.CompileAll(); });
+                    elapsed[1] += TimeNanoseconds([&] { sourceCompiler.Link(); });
+                    elapsed[2] += TimeNanoseconds([&] { (void) sourceCompiler.GenerateOutput(); });
+                    elapsed[3] += TimeNanoseconds([&] {
+                        Core::Output::StringSink sink;
+                        sourceCompiler.EmitOutput(Core::Output::OutputFormat::Mem, sink, input.Name);
+                    });
+                }
+                if (IsMeasured(iteration)) {
+                    for (size_t i = 0; i < results.size(); ++i) {
+                        results[i].Samples.push_back(elapsed[i]);
+                    }
+                }
+            }
+
+            for (auto &result: results) {
+                result.PeakMemoryBytes = Bench::GetPeakMemoryBytes();
+            }
+            return results;
+        }
+
+        // Edits about 16 lines spread over each input the way an editor does, inserting a comment line, then
+        // duplicating and then deleting the line, and undoing each edit. The first iteration checks every
+        // update against a full compile of the same text, and throws at the first image that differs.
+        PhaseResult RunIncremental() {
+            PhaseResult result{"IncrementalUpdate"};
+            result.PerInput = false; // the samples are single-line updates, not passes over the inputs
+
+            Core::Compiler compiler{m_LanguageRootDir};
+            for (size_t iteration = 0; iteration < m_Warmup + m_Iterations; ++iteration) {
+                double elapsed = 0;
+                for (const auto &input: m_Inputs) {
+                    std::vector<std::string> lines;
+                    for (auto line: std::views::split(std::string_view(input.Source), '\n')) {
+                        lines.emplace_back(std::string_view(line));
+                    }
+                    if (!lines.empty() && lines.back().empty())
+                        lines.pop_back();
+
+                    Core::Incremental::IncrementalAssembler assembler{compiler};
+                    (void) assembler.Update(JoinLines(lines));
+                    auto update = [&](std::span<const std::string> text, size_t editedLine) {
+                        auto source = JoinLines(text);
+                        elapsed += TimeNanoseconds([&] { (void) assembler.Update(source); });
+                        if (iteration == 0) {
+                            CheckAgainstFullCompile(compiler, assembler, source, input.Name, editedLine);
+                        }
+                    };
+
+                    size_t stride = std::max<size_t>(lines.size() / 16, 1);
+                    for (size_t i = 0; i < lines.size(); i += stride) {
+                        auto edited = lines;
+                        edited.insert(edited.begin() + static_cast<std::ptrdiff_t>(i), "; edited");
+                        update(edited, i);
+                        update(lines, i);
+
+                        edited = lines;
+                        edited.insert(edited.begin() + static_cast<std::ptrdiff_t>(i), lines[i]);
+                        update(edited, i);
+                        update(lines, i);
+
+                        edited = lines;
+                        edited.erase(edited.begin() + static_cast<std::ptrdiff_t>(i));
+                        update(edited, i);
+                        update(lines, i);
+                    }
+                }
+                if (IsMeasured(iteration))
+                    result.Samples.push_back(elapsed);
+            }
+            result.PeakMemoryBytes = Bench::GetPeakMemoryBytes();
+            return result;
+        }
+
+        static void CheckAgainstFullCompile(const Core::Compiler &compiler,
+                                            const Core::Incremental::IncrementalAssembler &assembler,
+                                            const std::string &source, std::string_view name, size_t editedLine) {
+            auto sourceCompiler = compiler.CreateSourceCompiler(source);
+            bool failed = false;
+            try {
+                sourceCompiler.CompileAll();
+                sourceCompiler.Link();
+            } catch (const Core::DiagnosticError &) {
+                failed = true;
+            }
+            // a failed link leaves the image only partially patched, so then only the outcome must agree
+            bool same = failed ? assembler.HasErrors()
+                               : !assembler.HasErrors() && SameBits(assembler.GetImage(), sourceCompiler.GetBitBuffer());
+            if (!same) {
+                throw std::runtime_error(std::format(
+                    "Incremental update of {} around line {} differs from a full compile", name, editedLine + 1));
+            }
+        }
+
+        std::filesystem::path m_LanguageRootDir;
+        std::vector<BenchInput> m_Inputs;
+        size_t m_Iterations;
+        size_t m_Warmup;
+    };
+
+    std::string ToJson(const std::filesystem::path &languageRootDir, const std::vector<BenchInput> &inputs,
+                       const std::vector<PhaseResult> &results, size_t iterations, size_t warmup) {
+        size_t totalLines = 0;
+        size_t totalBytes = 0;
+
+        Core::Json::JsonWriter writer;
+        writer.BeginObject()
+                .Member("schema", "easyasm-bench/1")
+                .Member("language", languageRootDir.generic_string())
+                .Member("iterations", iterations)
+                .Member("warmup", warmup);
+
+        writer.Key("inputs").BeginArray();
+        for (const auto &input: inputs) {
+            totalLines += input.Lines;
+            totalBytes += input.Source.size();
+            writer.BeginObject()
+                    .Member("name", input.Name)
+                    .Member("bytes", input.Source.size())
+                    .Member("lines", input.Lines)
+                    .EndObject();
+        }
+        writer.EndArray();
+
+        writer.Key("phases").BeginArray();
+        for (const auto &result: results) {
+            auto statistics = Summarize(result.Samples);
+            writer.BeginObject()
+                    .Member("name", result.Name)
+                    .Member("unit", "ns")
+                    .Member("min", statistics.Min)
+                    .Member("median", statistics.Median)
+                    .Member("mean", statistics.Mean)
+                    .Member("max", statistics.Max)
+                    .Member("stddev", statistics.StdDev)
+                    .Member("peakMemoryBytes", result.PeakMemoryBytes);
+            if (result.PerInput && statistics.Median > 0) {
+                writer.Member("linesPerSecond", static_cast<double>(totalLines) * 1e9 / statistics.Median)
+                        .Member("bytesPerSecond", static_cast<double>(totalBytes) * 1e9 / statistics.Median);
+            }
+            writer.EndObject();
+        }
+        writer.EndArray();
+
+        writer.Member("peakMemoryBytes", Bench::GetPeakMemoryBytes());
+        writer.EndObject();
+        return writer.TakeOutput();
+    }
+
+    void PrintSummary(const std::vector<BenchInput> &inputs, const std::vector<PhaseResult> &results) {
+        size_t totalLines = 0;
+        for (const auto &input: inputs) {
+            totalLines += input.Lines;
+        }
+
+        std::cout << std::format("{} input(s), {} lines\n", inputs.size(), totalLines);
+        std::cout << std::format("{:<18}{:>14}{:>14}{:>14}{:>16}{:>14}\n",
+                                 "Phase", "min (us)", "median (us)", "max (us)", "lines/s", "peak (MiB)");
+        for (const auto &result: results) {
+            auto statistics = Summarize(result.Samples);
+            std::string linesPerSecond = "-";
+            if (result.PerInput && statistics.Median > 0) {
+                linesPerSecond = std::format("{:.0f}", static_cast<double>(totalLines) * 1e9 / statistics.Median);
+            }
+            std::cout << std::format("{:<18}{:>14.1f}{:>14.1f}{:>14.1f}{:>16}{:>14.1f}\n",
+                                     result.Name, statistics.Min / 1e3, statistics.Median / 1e3,
+                                     statistics.Max / 1e3, linesPerSecond,
+                                     static_cast<double>(result.PeakMemoryBytes) / (1024.0 * 1024.0));
+        }
+    }
+
+    std::string ReadFile(const std::filesystem::path &path) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error(std::format("Cannot open input file: {}", path.string()));
+        }
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+}
+
+export int main(int argc, char *argv[]) {
+    args::ArgumentParser parser(
+        "Benchmarks the phases of EasyASM on real or generated PicoBlaze programs",
+        "Usage example:\n  EasyASMBench -l ../../PicoBlaze --programs 8 --json results.json\n"
+        "  EasyASMBench -l ../../PicoBlaze -i ../../tests/pracPICO.psm -n 50\n"
+        "  EasyASMBench --generate big.psm --instructions 1023");
+    args::HelpFlag help(parser, "help", "Display this help menu", {'h', "help"});
+    args::ValueFlag<std::string> languageRootDirFlag(
+        parser, "languageRootDir", "Path to the library root directory of the language", {'l', "language-root-dir"});
+    args::ValueFlagList<std::string> inputFlag(
+        parser, "Input file", "Benchmark this source instead of generated ones, may be repeated", {'i', "input"});
+    args::ValueFlag<size_t> programsFlag(
+        parser, "Programs", "Number of generated programs, each with its own seed (default 4)", {"programs"});
+    args::ValueFlag<size_t> instructionsFlag(
+        parser, "Instructions", "Instructions per generated program, at most 1023 (default 1000)", {"instructions"});
+    args::ValueFlag<double> commentDensityFlag(
+        parser, "Comment density", "Chance of a comment before and after each instruction (default 0.5)",
+        {"comment-density"});
+    args::ValueFlag<uint64_t> seedFlag(parser, "Seed", "Seed of the first generated program (default 1)", {"seed"});
+    args::ValueFlag<size_t> iterationsFlag(
+        parser, "Iterations", "Measured iterations of every phase (default 10)", {'n', "iterations"});
+    args::ValueFlag<size_t> warmupFlag(
+        parser, "Warmup", "Unmeasured iterations before measuring (default 2)", {"warmup"});
+    args::ValueFlag<std::string> jsonFlag(
+        parser, "JSON file", "Write machine-readable results to this file, '-' for stdout", {"json"});
+    args::ValueFlag<std::string> generateFlag(
+        parser, "Output file", "Only write one generated program to this file", {"generate"});
+
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (args::Help &) {
+        std::cout << parser;
+        return 0;
+    } catch (args::ParseError &e) {
+        std::cerr << e.what() << "\n" << parser;
+        return 1;
+    }
+
+    try {
+        Bench::GeneratorOptions options;
+        options.InstructionCount = instructionsFlag ? args::get(instructionsFlag) : options.InstructionCount;
+        options.CommentDensity = commentDensityFlag ? args::get(commentDensityFlag) : options.CommentDensity;
+        options.Seed = seedFlag ? args::get(seedFlag) : options.Seed;
+
+        if (generateFlag) {
+            auto program = Bench::GenerateProgram(options);
+            std::ofstream output(args::get(generateFlag), std::ios::binary);
+            output << program.Source;
+            std::cout << std::format("Generated {} instructions, {} labels, {} lines into {}\n",
+                                     program.Instructions, program.Labels, program.Lines, args::get(generateFlag));
+            return output ? 0 : 1;
+        }
+
+        if (!languageRootDirFlag) {
+            std::cerr << "Error: Missing required argument --language-root-dir.\n";
+            parser.Help(std::cerr);
+            return 1;
+        }
+
+        std::vector<BenchInput> inputs;
+        for (const auto &path: args::get(inputFlag)) {
+            auto source = ReadFile(path);
+            auto lines = static_cast<size_t>(std::ranges::count(source, '\n'));
+            inputs.push_back({std::filesystem::path(path).filename().string(), std::move(source), lines});
+        }
+        if (inputs.empty()) {
+            size_t programs = programsFlag ? std::max<size_t>(args::get(programsFlag), 1) : 4;
+            for (size_t i = 0; i < programs; ++i) {
+                auto programOptions = options;
+                programOptions.Seed = options.Seed + i;
+                auto program = Bench::GenerateProgram(programOptions);
+                inputs.push_back({std::format("generated_{}", programOptions.Seed), std::move(program.Source),
+                                  program.Lines});
+            }
+        }
+
+        size_t iterations = iterationsFlag ? std::max<size_t>(args::get(iterationsFlag), 1) : 10;
+        size_t warmup = warmupFlag ? args::get(warmupFlag) : 2;
+        std::filesystem::path languageRootDir = args::get(languageRootDirFlag);
+
+        auto results = BenchmarkRunner(languageRootDir, inputs, iterations, warmup).Run();
+
+        bool jsonToStdout = jsonFlag && args::get(jsonFlag) == "-";
+        if (!jsonToStdout) {
+            PrintSummary(inputs, results);
+        }
+        if (jsonFlag) {
+            auto json = ToJson(languageRootDir, inputs, results, iterations, warmup);
+            if (jsonToStdout) {
+                std::cout << json << "\n";
+            } else {
+                std::ofstream output(args::get(jsonFlag), std::ios::binary);
+                output << json << "\n";
+                if (!output) {
+                    std::cerr << std::format("Failed to write results to {}\n", args::get(jsonFlag));
+                    return 1;
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << std::format("Benchmark failed:\n{}\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,35 @@
+module;
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+export module Bench.ProcessMemory;
+
+import std;
+
+namespace Bench {
+    // Peak working set (Windows) or resident set size (POSIX) of this process in bytes.
+    export size_t GetPeakMemoryBytes() {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters{};
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0;
+        return counters.PeakWorkingSetSize;
+#else
+        rusage usage{};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss); // bytes on macOS
+#else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024; // kilobytes elsewhere
+#endif
+#endif
+    }
+}
@@ -0,0 +1,221 @@
+module Bench.ProgramGenerator;
+
+import std;
+
+namespace Bench {
+    namespace {
+        constexpr size_t maxInstructions = 1023;
+
+        constexpr std::array<std::string_view, 24> commentWords{
+            "update", "the", "counter", "before", "checking", "port", "state", "delay", "loop", "interrupt",
+            "service", "routine", "value", "buffer", "flag", "keep", "result", "in", "scratch", "pad",
+            "wait", "for", "next", "byte"
+        };
+        constexpr std::array<std::string_view, 10> registerOps{
+            "LOAD", "ADD", "ADDCY", "SUB", "SUBCY", "AND", "OR", "XOR", "TEST", "COMPARE"
+        };
+        constexpr std::array<std::string_view, 10> shiftOps{
+            "SL0", "SL1", "SLA", "SLX", "SR0", "SR1", "SRA", "SRX", "RL", "RR"
+        };
+        constexpr std::array<std::string_view, 5> conditions{"", "Z", "NZ", "C", "NC"};
+
+        class ProgramWriter {
+        public:
+            explicit ProgramWriter(const GeneratorOptions &options)
+                : m_Options(options), m_Random(options.Seed) {}
+
+            GeneratedProgram Generate() {
+                if (m_Options.InstructionCount < 3 || m_Options.InstructionCount > maxInstructions) {
+                    throw std::invalid_argument(
+                        std::format("Instruction count must be between 3 and {}", maxInstructions));
+                }
+
+                WriteHeader();
+                WriteDirectives();
+                WriteBody(m_Options.InstructionCount - 1);
+
+                // interrupt vector in the last word
+                m_Source += "\n                    ADDRESS 3FF\n";
+                WriteInstruction("JUMP isr");
+
+                m_Program.Source = std::move(m_Source);
+                m_Program.Lines = static_cast<size_t>(std::ranges::count(m_Program.Source, '\n'));
+                return std::move(m_Program);
+            }
+
+        private:
+            size_t Pick(size_t count) {
+                return std::uniform_int_distribution<size_t>(0, count - 1)(m_Random);
+            }
+
+            bool Chance(double probability) {
+                return std::bernoulli_distribution(std::clamp(probability, 0.0, 1.0))(m_Random);
+            }
+
+            std::string Comment() {
+                std::string comment = "; ";
+                size_t words = 2 + Pick(8);
+                for (size_t i = 0; i < words; ++i) {
+                    if (i != 0)
+                        comment += ' ';
+                    comment += commentWords[Pick(commentWords.size())];
+                }
+                return comment;
+            }
+
+            std::string Mnemonic(std::string_view mnemonic) {
+                std::string result(mnemonic);
+                if (Chance(0.2)) {
+                    std::ranges::transform(result, result.begin(), [](unsigned char c) { return std::tolower(c); });
+                }
+                return result;
+            }
+
+            std::string Register() {
+                return m_Registers[Pick(m_Registers.size())];
+            }
+
+            std::string HexByte() {
+                return std::format("{:02X}", Pick(256));
+            }
+
+            std::string Value() {
+                return m_Values[Pick(m_Values.size())];
+            }
+
+            std::string Port() {
+                return m_Ports[Pick(m_Ports.size())];
+            }
+
+            void WriteHeader() {
+                m_Source += ";**************************************************************************************\n";
+                m_Source += std::format("; Synthetic KCPSM3 program, seed {}\n", m_Options.Seed);
+                m_Source += ";**************************************************************************************\n";
+                for (size_t i = 0; i < 6; ++i) {
+                    m_Source += Comment() + "\n";
+                }
+                m_Source += ";\n";
+            }
+
+            void WriteDirectives() {
+                for (size_t i = 0; i < std::max<size_t>(m_Options.ConstantCount, 2); ++i) {
+                    // half ports, half values used as immediates and scratchpad addresses
+                    std::string name = i % 2 == 0 ? std::format("port_{}", i / 2) : std::format("value_{}", i / 2);
+                    (i % 2 == 0 ? m_Ports : m_Values).push_back(name);
+                    m_Source += std::format("                    CONSTANT {}, {}", name, HexByte());
+                    m_Source += Chance(m_Options.CommentDensity) ? "    " + Comment() + "\n" : "\n";
+                }
+                m_Source += ";\n";
+
+                size_t aliases = std::min<size_t>(m_Options.AliasCount, 8);
+                for (size_t i = 0; i < 16; ++i) {
+                    if (i < 8 || i >= 8 + aliases) {
+                        m_Registers.push_back(std::format("s{:X}", i));
+                    }
+                }
+                for (size_t i = 0; i < aliases; ++i) {
+                    auto alias = std::format("alias_{}", i);
+                    m_Registers.push_back(alias);
+                    m_Source += std::format("                    NAMEREG s{:X}, {}\n", 8 + i, alias);
+                }
+                m_Source += ";\n";
+            }
+
+            void WriteInstruction(const std::string &instruction) {
+                if (Chance(m_Options.CommentDensity)) {
+                    m_Source += "                    " + Comment() + "\n";
+                }
+                m_Source += "                    ";
+                m_Source += instruction;
+                if (Chance(m_Options.CommentDensity)) {
+                    m_Source += "    " + Comment();
+                }
+                m_Source += '\n';
+                ++m_Program.Instructions;
+            }
+
+            void WriteBody(size_t instructionCount) {
+                // at least 'start' and 'isr', and never more labels than instructions
+                size_t labelCount = std::clamp<size_t>(
+                    instructionCount / std::max<size_t>(m_Options.InstructionsPerLabel, 1), 2, instructionCount);
+                std::vector<std::string> labels;
+                for (size_t i = 0; i < labelCount; ++i) {
+                    labels.push_back(i == 0 ? "start" : i + 1 == labelCount ? "isr" : std::format("routine_{}", i));
+                }
+                m_Program.Labels = labelCount;
+
+                size_t currentLabel = 0;
+                for (size_t i = 0; i < instructionCount; ++i) {
+                    if (currentLabel < labelCount && i == currentLabel * instructionCount / labelCount) {
+                        m_Source += std::format("{}:", labels[currentLabel]);
+                        m_Source += Chance(m_Options.CommentDensity) ? "    " + Comment() + "\n" : "\n";
+                        ++currentLabel;
+                    }
+
+                    if (i + 1 == instructionCount) {
+                        WriteInstruction(Mnemonic("RETURNI") + " ENABLE");
+                        break;
+                    }
+
+                    // mostly forward references, the label of the current routine is currentLabel - 1
+                    auto target = [&] {
+                        if (currentLabel < labelCount && Chance(0.8)) {
+                            return labels[currentLabel + Pick(labelCount - currentLabel)];
+                        }
+                        return labels[Pick(labelCount)];
+                    };
+
+                    size_t kind = Pick(100);
+                    if (kind < 40) {
+                        std::string operand;
+                        switch (Pick(3)) {
+                            case 0: operand = Register();
+                                break;
+                            case 1: operand = HexByte();
+                                break;
+                            default: operand = Value();
+                                break;
+                        }
+                        WriteInstruction(std::format("{} {}, {}", Mnemonic(registerOps[Pick(registerOps.size())]),
+                                                     Register(), operand));
+                    } else if (kind < 50) {
+                        auto operand = Chance(0.5) ? Value() : std::format("({})", Register());
+                        WriteInstruction(std::format("{} {}, {}", Mnemonic(Chance(0.5) ? "FETCH" : "STORE"),
+                                                     Register(), operand));
+                    } else if (kind < 60) {
+                        auto operand = Chance(0.7) ? Port() : std::format("({})", Register());
+                        WriteInstruction(std::format("{} {}, {}", Mnemonic(Chance(0.5) ? "INPUT" : "OUTPUT"),
+                                                     Register(), operand));
+                    } else if (kind < 70) {
+                        WriteInstruction(std::format("{} {}", Mnemonic(shiftOps[Pick(shiftOps.size())]), Register()));
+                    } else if (kind < 94) {
+                        auto mnemonic = Mnemonic(kind < 85 ? "JUMP" : "CALL");
+                        auto condition = conditions[Pick(conditions.size())];
+                        WriteInstruction(condition.empty()
+                                             ? std::format("{} {}", mnemonic, target())
+                                             : std::format("{} {}, {}", mnemonic, condition, target()));
+                    } else if (kind < 99) {
+                        auto condition = conditions[Pick(conditions.size())];
+                        WriteInstruction(condition.empty()
+                                             ? Mnemonic("RETURN")
+                                             : std::format("{} {}", Mnemonic("RETURN"), condition));
+                    } else {
+                        WriteInstruction(std::format("{} INTERRUPT", Mnemonic(Chance(0.5) ? "ENABLE" : "DISABLE")));
+                    }
+                }
+            }
+
+            const GeneratorOptions &m_Options;
+            std::mt19937_64 m_Random;
+            std::string m_Source;
+            GeneratedProgram m_Program;
+            std::vector<std::string> m_Registers;
+            std::vector<std::string> m_Ports;
+            std::vector<std::string> m_Values;
+        };
+    }
+
+    GeneratedProgram GenerateProgram(const GeneratorOptions &options) {
+        return ProgramWriter(options).Generate();
+    }
+}
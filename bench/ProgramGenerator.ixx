@@ -0,0 +1,26 @@
+export module Bench.ProgramGenerator;
+
+import std;
+
+namespace Bench {
+    export struct GeneratorOptions {
+        size_t InstructionCount = 1000; // 3 to 1023, the last word holds the interrupt vector
+        size_t ConstantCount = 48;
+        size_t AliasCount = 6;          // NAMEREG aliases for s8 and up
+        size_t InstructionsPerLabel = 6;
+        double CommentDensity = 0.5;    // chance of a comment line before and after each instruction
+        uint64_t Seed = 1;
+    };
+
+    export struct GeneratedProgram {
+        std::string Source;
+        size_t Lines = 0;
+        size_t Instructions = 0;
+        size_t Labels = 0;
+    };
+
+    // A KCPSM3 program shaped like hand-written firmware: a block of CONSTANT and NAMEREG directives,
+    // many short labelled routines with mostly forward JUMP/CALL references, constants used as
+    // immediates and ports, and comment lines and trailing comments throughout. Deterministic per seed.
+    export GeneratedProgram GenerateProgram(const GeneratorOptions &options);
+}
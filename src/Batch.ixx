@@ -0,0 +1,149 @@
+export module Batch;
+
+import std;
+import FindPaths;
+import Core.Compiler;
+import Core.Assembler;
+import Core.WorkerPool;
+import Core.Profiler;
+import Core.BuildCache;
+import Core.Diagnostics;
+import Core.Json;
+
+namespace {
+    struct BatchResult {
+        bool Success = false;
+        bool CacheHit = false;
+        std::vector<std::filesystem::path> OutputPaths;
+        std::string Error;
+        std::vector<Core::Diagnostic> Diagnostics; // of a DiagnosticError, Error is empty then
+    };
+
+    // The Compiler is created on first use, so a worker whose files all hit the build cache never starts
+    // Lua. A failed initialization is reported again for every file the worker takes.
+    struct BatchWorker {
+        const ProgramPaths &Paths;
+        std::shared_ptr<Core::Profiling::Profiler> Profiler;
+        std::unique_ptr<Core::Compiler> Compiler;
+        std::optional<std::string> InitError;
+
+        const Core::Compiler &GetCompiler() {
+            if (InitError) {
+                throw std::runtime_error(*InitError);
+            }
+            if (!Compiler) {
+                try {
+                    Compiler = std::make_unique<Core::Compiler>(Paths.GetLanguageRootDir(), Profiler);
+                } catch (const std::exception &e) {
+                    InitError = e.what();
+                    throw;
+                }
+            }
+            return *Compiler;
+        }
+    };
+
+    std::string ToDisplayString(const std::filesystem::path &path) {
+        std::u8string u8str = path.u8string();
+        return std::string(reinterpret_cast<const char *>(u8str.c_str()), u8str.size());
+    }
+}
+
+// Assembles every input of the command line on a pool of workers, each owning its own Compiler and Lua
+// state. Results are reported in input order once all files are done, so the output is deterministic.
+// A profiler, if given, is shared by all workers, and so is a build cache.
+export int RunBatch(const ProgramPaths &paths, std::shared_ptr<Core::Profiling::Profiler> profiler = nullptr,
+                    const Core::Cache::BuildCache *cache = nullptr, std::string_view languageDigest = {}) {
+    const auto &sources = paths.GetSourceFilePaths();
+
+    std::vector<Core::AssembleJob> jobs;
+    jobs.reserve(sources.size());
+    std::map<std::filesystem::path, size_t> outputOwners;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        Core::AssembleJob job{sources[i], paths.GetOutputDirFor(sources[i]), sources[i].stem().string()};
+        job.DeadCodeOptions = paths.GetDeadCodeOptions();
+        auto [owner, inserted] = outputOwners.emplace(job.OutputDir / job.OutputStem, i);
+        if (!inserted) {
+            std::cerr << std::format("Error: '{}' and '{}' would write to the same output '{}'\n",
+                                     ToDisplayString(sources[owner->second]), ToDisplayString(sources[i]),
+                                     ToDisplayString(owner->first));
+            return 1;
+        }
+        jobs.push_back(std::move(job));
+    }
+
+    size_t threadCount = paths.GetJobCount() == 0 ? Core::GetDefaultWorkerCount() : paths.GetJobCount();
+    std::vector<BatchResult> results(jobs.size());
+    auto start = std::chrono::steady_clock::now();
+
+    Core::ParallelForEach(
+        jobs.size(), threadCount,
+        [&] {
+            return BatchWorker{paths, profiler};
+        },
+        [&](BatchWorker &worker, size_t index) {
+            auto &result = results[index];
+            try {
+                if (paths.IsCompileOnly()) {
+                    result.OutputPaths = {Core::CompileObjectFile(worker.GetCompiler(), jobs[index])};
+                } else if (cache) {
+                    auto cached = Core::AssembleFileCached(
+                        *cache, languageDigest, [&]() -> const Core::Compiler & { return worker.GetCompiler(); },
+                        jobs[index], paths.GetOutputFormats());
+                    result.OutputPaths = std::move(cached.OutputPaths);
+                    result.CacheHit = cached.CacheHit;
+                } else {
+                    result.OutputPaths = Core::AssembleFile(worker.GetCompiler(), jobs[index], paths.GetOutputFormats());
+                }
+                result.Success = true;
+            } catch (const Core::DiagnosticError &e) {
+                result.Diagnostics.assign(e.GetDiagnostics().begin(), e.GetDiagnostics().end());
+            } catch (const std::exception &e) {
+                result.Error = e.what();
+            } catch (...) {
+                result.Error = "unknown error";
+            }
+        });
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    size_t succeeded = 0;
+    size_t cached = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const auto &result = results[i];
+        if (result.Success) {
+            ++succeeded;
+            cached += result.CacheHit ? 1 : 0;
+            std::string outputs;
+            for (const auto &outputPath: result.OutputPaths) {
+                if (!outputs.empty())
+                    outputs += ", ";
+                outputs += ToDisplayString(outputPath);
+            }
+            std::cout << std::format("{} -> {}{}\n", ToDisplayString(jobs[i].SourcePath), outputs,
+                                     result.CacheHit ? " (cached)" : "");
+        } else if (!result.Diagnostics.empty() && paths.IsJsonDiagnostics()) {
+            Core::Json::JsonWriter writer;
+            Core::WriteDiagnosticsJson(writer, result.Diagnostics, ToDisplayString(jobs[i].SourcePath));
+            std::cout << writer.GetOutput() << "\n";
+        } else if (!result.Diagnostics.empty()) {
+            auto sourceName = ToDisplayString(jobs[i].SourcePath);
+            std::cerr << std::format("{}: Compilation failed due to an error:\n{}\n", sourceName,
+                                     Core::FormatDiagnostics(result.Diagnostics, sourceName));
+        } else {
+            std::cerr << std::format("{}: Compilation failed due to an error:\n{}\n",
+                                     ToDisplayString(jobs[i].SourcePath), result.Error);
+        }
+    }
+
+    size_t failed = jobs.size() - succeeded;
+    std::cout << std::format("Batch finished: {} succeeded, {} failed ({} files, {} threads, {} ms)\n",
+                             succeeded, failed, jobs.size(), std::min(threadCount, jobs.size()),
+                             elapsed.count());
+    if (cache) {
+        std::cout << std::format("Build cache: {} of {} files restored\n", cached, jobs.size());
+    }
+
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+module Core.Assembler;
+
+import std;
+import Core.Compiler;
+import Core.Output;
+import Core.Profiler;
+import Core.Object;
+import Core.BitBuffer;
+import Core.SymbolTable;
+import Core.BuildCache;
+import Core.SourceBuffer;
+import Core.ChunkedAssembly;
+import Core.DeadCode;
+
+namespace Core {
+    std::shared_ptr<const SourceBuffer> OpenSourceFile(const std::filesystem::path &path) {
+        if (path == StdinSourcePath) {
+            return SourceBuffer::FromStdin();
+        }
+        return SourceBuffer::FromFile(path);
+    }
+
+    namespace {
+        std::shared_ptr<const SourceBuffer> ReadSource(const Compiler &compiler, const std::filesystem::path &path) {
+            Profiling::PhaseScope phase{compiler.GetProfiler(), "Read source"};
+            return OpenSourceFile(path);
+        }
+
+        std::vector<std::filesystem::path> WriteImages(const Compiler &compiler, SourceCompiler &sourceCompiler,
+                                                       const std::filesystem::path &outputDir,
+                                                       const std::string &stem,
+                                                       std::span<const Output::OutputFormat> formats) {
+            if (formats.empty()) {
+                formats = compiler.GetOutputFormats();
+            }
+
+            if (!formats.empty()) {
+                return sourceCompiler.WriteOutputFiles(formats, outputDir, stem);
+            }
+
+            auto outputPath = outputDir / (stem + ".mem");
+            std::ofstream outputFile(outputPath);
+            outputFile << sourceCompiler.GenerateOutput();
+            return {outputPath};
+        }
+
+        std::vector<std::filesystem::path> AssembleSource(const Compiler &compiler,
+                                                          std::shared_ptr<const SourceBuffer> source,
+                                                          const AssembleJob &job,
+                                                          std::span<const Output::OutputFormat> formats) {
+            SourceCompiler sourceCompiler{compiler.CreateSourceCompiler(std::move(source))};
+            if (job.Chunking) {
+                Chunked::CompileChunked(compiler, sourceCompiler, *job.Chunking);
+            } else {
+                sourceCompiler.CompileAll();
+            }
+            sourceCompiler.SetDeadCodeOptions(job.DeadCodeOptions);
+            sourceCompiler.Link();
+
+            return WriteImages(compiler, sourceCompiler, job.OutputDir, job.OutputStem, formats);
+        }
+    }
+
+    std::vector<std::filesystem::path> AssembleFile(const Compiler &compiler,
+                                                    const AssembleJob &job,
+                                                    std::span<const Output::OutputFormat> formats) {
+        return AssembleSource(compiler, ReadSource(compiler, job.SourcePath), job, formats);
+    }
+
+    BitBuffer AssembleImage(const Compiler &compiler, const std::filesystem::path &sourcePath) {
+        SourceCompiler sourceCompiler{compiler.CreateSourceCompiler(ReadSource(compiler, sourcePath))};
+        sourceCompiler.CompileAll();
+        sourceCompiler.Link();
+        return std::move(sourceCompiler.GetBitBuffer());
+    }
+
+    CachedAssembleResult AssembleFileCached(const Cache::BuildCache &cache,
+                                            std::string_view languageDigest,
+                                            const std::function<const Compiler &()> &getCompiler,
+                                            const AssembleJob &job,
+                                            std::span<const Output::OutputFormat> formats) {
+        auto source = OpenSourceFile(job.SourcePath);
+        std::string linkOptions;
+        if (job.DeadCodeOptions.RemoveUnused) {
+            linkOptions = "strip-unused;";
+            for (const auto &label: job.DeadCodeOptions.KeepLabels) {
+                linkOptions += std::format("keep {};", label);
+            }
+        }
+        // the HDL emitters name the entity or module after the output stem; the language's default formats
+        // may include them too
+        bool namedAfterStem = formats.empty() || std::ranges::any_of(formats, [](Output::OutputFormat format) {
+            return format == Output::OutputFormat::Vhdl || format == Output::OutputFormat::Verilog;
+        });
+        if (namedAfterStem) {
+            linkOptions += std::format("stem {};", job.OutputStem);
+        }
+        auto key = Cache::BuildCache::MakeKey(languageDigest, source->GetText(), formats, linkOptions);
+
+        CachedAssembleResult result;
+        if (auto files = cache.Lookup(key)) {
+            for (const auto &file: *files) {
+                auto outputPath = job.OutputDir / (job.OutputStem + file.Extension);
+                std::ofstream output(outputPath, std::ios::binary | std::ios::trunc);
+                output.write(file.Contents.data(), static_cast<std::streamsize>(file.Contents.size()));
+                if (!output) {
+                    throw std::runtime_error(std::format("Failed to write '{}'", outputPath.string()));
+                }
+                result.OutputPaths.push_back(std::move(outputPath));
+            }
+            result.CacheHit = true;
+            return result;
+        }
+
+        result.OutputPaths = AssembleSource(getCompiler(), std::move(source), job, formats);
+
+        // stored exactly as written, so a hit reproduces the files byte for byte
+        std::vector<Cache::CachedFile> files;
+        for (const auto &outputPath: result.OutputPaths) {
+            std::ifstream input(outputPath, std::ios::binary);
+            files.push_back({outputPath.extension().string(),
+                             std::string((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>())});
+        }
+        cache.Store(key, files);
+        return result;
+    }
+
+    std::filesystem::path CompileObjectFile(const Compiler &compiler, const AssembleJob &job) {
+        SourceCompiler sourceCompiler{compiler.CreateSourceCompiler(ReadSource(compiler, job.SourcePath))};
+        sourceCompiler.CompileAll();
+        sourceCompiler.ReportDiagnostics(); // unresolved symbols are left to the link
+
+        Profiling::PhaseScope phase{compiler.GetProfiler(), "Write object file"};
+        auto outputPath = job.OutputDir / (job.OutputStem + std::string(Object::ObjectFileExtension));
+        Object::WriteObjectFile(sourceCompiler.GetBitBuffer(), sourceCompiler.GetSymbolTable(),
+                                sourceCompiler.GetImageLayout().WordWidth, outputPath);
+        return outputPath;
+    }
+
+    std::vector<std::filesystem::path> LinkObjectFiles(const Compiler &compiler,
+                                                       std::span<const std::filesystem::path> objectPaths,
+                                                       const std::filesystem::path &outputDir,
+                                                       const std::string &stem,
+                                                       std::span<const Output::OutputFormat> formats) {
+        SourceCompiler sourceCompiler{compiler.CreateSourceCompiler({})};
+        {
+            Profiling::PhaseScope phase{compiler.GetProfiler(), "Merge objects"};
+            std::vector<Object::ObjectFile> objects;
+            objects.reserve(objectPaths.size());
+            for (const auto &objectPath: objectPaths) {
+                objects.emplace_back(objectPath);
+            }
+
+            BitBuffer bitBuffer;
+            SymbolTable symbolTable;
+            Object::MergeObjects(objects, sourceCompiler.GetImageLayout().WordWidth, bitBuffer, symbolTable);
+            sourceCompiler.LoadProgram(std::move(bitBuffer), std::move(symbolTable));
+        }
+        sourceCompiler.Link();
+
+        return WriteImages(compiler, sourceCompiler, outputDir, stem, formats);
+    }
+}
@@ -0,0 +1,60 @@
+export module Core.Assembler;
+
+import std;
+import Core.Compiler;
+import Core.Output;
+import Core.BuildCache;
+import Core.SourceBuffer;
+import Core.ChunkedAssembly;
+import Core.BitBuffer;
+import Core.DeadCode;
+
+namespace Core {
+    export struct AssembleJob {
+        std::filesystem::path SourcePath;
+        std::filesystem::path OutputDir;
+        std::string OutputStem;
+        std::optional<Chunked::ChunkedOptions> Chunking; // compile the source in parallel chunks, see Chunked::CompileChunked
+        DeadCode::Options DeadCodeOptions;               // applied when linking, see SourceCompiler::Link
+    };
+
+    // Path that stands for standard input rather than a file.
+    export constexpr std::string_view StdinSourcePath = "-";
+
+    // Maps the source file, or reads it when it cannot be mapped, and reads stdin for StdinSourcePath.
+    export std::shared_ptr<const SourceBuffer> OpenSourceFile(const std::filesystem::path &path);
+
+    // Compiles, links and writes the images of one source file with an already initialized Compiler.
+    // An empty format list means the formats of the language, or the Lua output function if it has none.
+    // Errors propagate as exceptions, exactly as in a single-file run.
+    export std::vector<std::filesystem::path> AssembleFile(const Compiler &compiler,
+                                                           const AssembleJob &job,
+                                                           std::span<const Output::OutputFormat> formats);
+
+    // Compiles and links one source file and returns its image instead of writing it, e.g. to simulate it.
+    export BitBuffer AssembleImage(const Compiler &compiler, const std::filesystem::path &sourcePath);
+
+    export struct CachedAssembleResult {
+        std::vector<std::filesystem::path> OutputPaths;
+        bool CacheHit = false;
+    };
+
+    // AssembleFile behind a build cache. The source is hashed first and a hit is restored by copying the
+    // stored images, so getCompiler is only called, and a Compiler with its Lua state only needed, on a miss.
+    export CachedAssembleResult AssembleFileCached(const Cache::BuildCache &cache,
+                                                   std::string_view languageDigest,
+                                                   const std::function<const Compiler &()> &getCompiler,
+                                                   const AssembleJob &job,
+                                                   std::span<const Output::OutputFormat> formats);
+
+    // Compiles one source without linking it and writes '<OutputDir>/<OutputStem>.eo', see Object::WriteObjectFile.
+    export std::filesystem::path CompileObjectFile(const Compiler &compiler, const AssembleJob &job);
+
+    // Places the objects one after another in the given order, links them with the language's linker and
+    // writes the images as AssembleFile does.
+    export std::vector<std::filesystem::path> LinkObjectFiles(const Compiler &compiler,
+                                                              std::span<const std::filesystem::path> objectPaths,
+                                                              const std::filesystem::path &outputDir,
+                                                              const std::string &stem,
+                                                              std::span<const Output::OutputFormat> formats);
+}
@@ -0,0 +1,46 @@
+module Core.BitBuffer;
+
+import std;
+import Vendor.sol;
+
+namespace Core {
+    void BitBuffer::AddLibToState(sol::state &state) {
+        // Indexing stays 1-based and bit-valued so scripts written against the old
+        // std::vector<uint8_t> container keep working unchanged.
+        state.new_usertype<BitBuffer>("BitBuffer",
+                                      sol::meta_function::index,
+                                      [](const BitBuffer &self, size_t index) -> std::optional<int> {
+                                          if (index == 0 || index > self.Size())
+                                              return std::nullopt;
+                                          return self.GetBit(index - 1) ? 1 : 0;
+                                      },
+                                      sol::meta_function::new_index,
+                                      [](BitBuffer &self, size_t index, int bit) {
+                                          if (index == self.Size() + 1) {
+                                              self.PushBit(bit != 0);
+                                              return;
+                                          }
+                                          if (index == 0 || index > self.Size()) {
+                                              throw std::out_of_range("BitBuffer index out of range");
+                                          }
+                                          self.SetBit(index - 1, bit != 0);
+                                      },
+                                      sol::meta_function::length, &BitBuffer::Size,
+                                      "add", [](BitBuffer &self, int bit) { self.PushBit(bit != 0); },
+                                      "size", &BitBuffer::Size,
+                                      "ReadBits", [](const BitBuffer &self, size_t startIndex, size_t bits) {
+                                          if (bits > WordBits || startIndex + bits > self.Size()) {
+                                              throw std::out_of_range("BitBuffer read out of range");
+                                          }
+                                          return self.ReadBits(startIndex, bits);
+                                      },
+                                      "ReadWord", [](const BitBuffer &self, size_t index, size_t wordWidth) {
+                                          if (wordWidth > WordBits || (index + 1) * wordWidth > self.Size()) {
+                                              throw std::out_of_range("BitBuffer read out of range");
+                                          }
+                                          return self.ReadWord(index, wordWidth);
+                                      },
+                                      "GetWordCount", &BitBuffer::GetWordCount
+        );
+    }
+}
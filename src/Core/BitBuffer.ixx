@@ -0,0 +1,157 @@
+export module Core.BitBuffer;
+
+import std;
+import Vendor.sol;
+import <cassert>;
+
+namespace Core {
+    // LSB-first bit stream packed into 64-bit words. Bit i of the stream is bit (i % 64) of word (i / 64),
+    // so a field written with PushBits can be read back or patched with a single shift and mask.
+    // Bits past Size() in the last word are always kept zero.
+    export class BitBuffer {
+    public:
+        static constexpr size_t WordBits = 64;
+
+        BitBuffer() = default;
+
+        void PushBits(uint64_t value, size_t bits) {
+            assert(bits <= WordBits && "PushBits can write at most one word at a time");
+            if (bits == 0)
+                return;
+
+            value &= Mask(bits);
+            size_t offset = m_Size % WordBits;
+            if (offset == 0) {
+                m_Words.push_back(value);
+            } else {
+                m_Words.back() |= value << offset;
+                if (offset + bits > WordBits) {
+                    m_Words.push_back(value >> (WordBits - offset));
+                }
+            }
+            m_Size += bits;
+        }
+
+        void PushZeros(size_t bits) {
+            m_Size += bits;
+            m_Words.resize(WordCountFor(m_Size), 0);
+        }
+
+        void PushBit(bool bit) {
+            PushBits(bit ? 1 : 0, 1);
+        }
+
+        [[nodiscard]] uint64_t ReadBits(size_t startIndex, size_t bits) const {
+            assert(bits <= WordBits && startIndex + bits <= m_Size && "ReadBits out of range");
+            if (bits == 0)
+                return 0;
+
+            size_t word = startIndex / WordBits;
+            size_t offset = startIndex % WordBits;
+            uint64_t result = m_Words[word] >> offset;
+            if (offset + bits > WordBits) {
+                result |= m_Words[word + 1] << (WordBits - offset);
+            }
+            return result & Mask(bits);
+        }
+
+        void ReplaceBits(uint64_t value, size_t bits, size_t startIndex) {
+            assert(bits <= WordBits && startIndex + bits <= m_Size && "ReplaceBits out of range");
+            if (bits == 0)
+                return;
+
+            value &= Mask(bits);
+            size_t word = startIndex / WordBits;
+            size_t offset = startIndex % WordBits;
+            m_Words[word] = (m_Words[word] & ~(Mask(bits) << offset)) | (value << offset);
+            if (offset + bits > WordBits) {
+                size_t highBits = offset + bits - WordBits;
+                m_Words[word + 1] = (m_Words[word + 1] & ~Mask(highBits)) | (value >> (WordBits - offset));
+            }
+        }
+
+        [[nodiscard]] bool GetBit(size_t index) const {
+            return (m_Words[index / WordBits] >> (index % WordBits)) & 1;
+        }
+
+        void SetBit(size_t index, bool bit) {
+            ReplaceBits(bit ? 1 : 0, 1, index);
+        }
+
+        [[nodiscard]] size_t Size() const {
+            return m_Size;
+        }
+
+        [[nodiscard]] bool Empty() const {
+            return m_Size == 0;
+        }
+
+        void Reserve(size_t bits) {
+            m_Words.reserve(WordCountFor(bits));
+        }
+
+        void Clear() {
+            m_Words.clear();
+            m_Size = 0;
+        }
+
+        // Word-level view, for consumers that read whole instruction words rather than single bits.
+        [[nodiscard]] std::span<const uint64_t> GetWords() const {
+            return m_Words;
+        }
+
+        [[nodiscard]] size_t GetWordCount(size_t wordWidth) const {
+            return m_Size / wordWidth;
+        }
+
+        [[nodiscard]] uint64_t ReadWord(size_t index, size_t wordWidth) const {
+            return ReadBits(index * wordWidth, wordWidth);
+        }
+
+        // Calls callback(index, word) for every whole word in order. Given the width DispatchWordWidth passes,
+        // the shifts and masks of the loop are constants.
+        template<typename Width, typename Callback>
+        void ForEachWord(Width wordWidth, Callback &&callback) const {
+            size_t wordCount = m_Size / wordWidth;
+            size_t bit = 0;
+            for (size_t index = 0; index < wordCount; ++index, bit += wordWidth) {
+                callback(index, ReadBits(bit, wordWidth));
+            }
+        }
+
+        static void AddLibToState(sol::state &state);
+
+    private:
+        static constexpr uint64_t Mask(size_t bits) {
+            return bits >= WordBits ? ~0ull : (1ull << bits) - 1;
+        }
+
+        static constexpr size_t WordCountFor(size_t bits) {
+            return (bits + WordBits - 1) / WordBits;
+        }
+
+        std::vector<uint64_t> m_Words;
+        size_t m_Size = 0;
+    };
+
+    // Calls function with the word width as a std::integral_constant for the common widths, so the word loop
+    // inside is compiled once per width with constant shifts and masks, and as a plain size_t for any other
+    // width. Dispatch once around a loop, not for every word.
+    export template<typename Function>
+    decltype(auto) DispatchWordWidth(size_t wordWidth, Function &&function) {
+        switch (wordWidth) {
+            case 8:
+                return function(std::integral_constant<size_t, 8>{});
+            case 16:
+                return function(std::integral_constant<size_t, 16>{});
+            case 18:
+                return function(std::integral_constant<size_t, 18>{});
+            case 24:
+                return function(std::integral_constant<size_t, 24>{});
+            case 32:
+                return function(std::integral_constant<size_t, 32>{});
+            default:
+                return function(wordWidth);
+        }
+    }
+}
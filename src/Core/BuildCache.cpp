@@ -0,0 +1,315 @@
+module;
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+module Core.BuildCache;
+
+import std;
+import Core.Output;
+import Core.Sha256;
+
+namespace Core::Cache {
+    namespace {
+        constexpr std::string_view entryMagic = "EASMCCHE";
+        constexpr uint32_t entryVersion = 1;
+        constexpr std::string_view entryExtension = ".entry";
+        constexpr std::string_view temporaryMarker = ".tmp.";
+        constexpr auto abandonedTemporaryAge = std::chrono::hours(1);
+        // touched by every trim, its time stamp tells other processes the last walk is recent
+        constexpr std::string_view trimStampName = "trim.stamp";
+        constexpr auto trimInterval = std::chrono::minutes(10);
+
+        template<std::unsigned_integral Integer>
+        void AppendInteger(std::string &output, Integer value) {
+            for (size_t i = 0; i < sizeof(Integer); ++i) {
+                output += static_cast<char>((value >> (8 * i)) & 0xFF); // little endian
+            }
+        }
+
+        void AppendBlob(std::string &output, std::string_view blob) {
+            AppendInteger<uint64_t>(output, blob.size());
+            output.append(blob);
+        }
+
+        // Like the bundle reader, but a malformed entry is a miss rather than an error.
+        class EntryReader {
+        public:
+            explicit EntryReader(std::string_view data) : m_Data(data) {}
+
+            template<std::unsigned_integral Integer>
+            std::optional<Integer> ReadInteger() {
+                auto bytes = Take(sizeof(Integer));
+                if (!bytes)
+                    return std::nullopt;
+                Integer value = 0;
+                for (size_t i = 0; i < sizeof(Integer); ++i) {
+                    value |= static_cast<Integer>(static_cast<uint8_t>((*bytes)[i])) << (8 * i);
+                }
+                return value;
+            }
+
+            std::optional<std::string_view> ReadBlob() {
+                auto size = ReadInteger<uint64_t>();
+                return size ? Take(*size) : std::nullopt;
+            }
+
+            std::optional<std::string_view> Take(uint64_t size) {
+                if (m_Data.size() < size)
+                    return std::nullopt;
+                auto result = m_Data.substr(0, size);
+                m_Data.remove_prefix(size);
+                return result;
+            }
+
+            [[nodiscard]] bool AtEnd() const {
+                return m_Data.empty();
+            }
+
+        private:
+            std::string_view m_Data;
+        };
+
+        std::optional<std::string> ReadWholeFile(const std::filesystem::path &path) {
+            std::ifstream input(path, std::ios::binary | std::ios::ate);
+            if (!input)
+                return std::nullopt;
+            std::string data(static_cast<size_t>(input.tellg()), '\0');
+            input.seekg(0);
+            input.read(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!input)
+                return std::nullopt;
+            return data;
+        }
+
+        std::filesystem::path GetExecutablePath() {
+#ifdef _WIN32
+            std::wstring path(MAX_PATH, L'\0');
+            for (;;) {
+                DWORD length = GetModuleFileNameW(nullptr, path.data(), static_cast<DWORD>(path.size()));
+                if (length == 0)
+                    return {};
+                if (length < path.size()) {
+                    path.resize(length);
+                    return path;
+                }
+                path.resize(path.size() * 2);
+            }
+#else
+            std::error_code error;
+            auto path = std::filesystem::read_symlink("/proc/self/exe", error);
+            return error ? std::filesystem::path{} : path;
+#endif
+        }
+
+        // A rebuilt assembler may encode differently, its size and time stamp stand in for its version.
+        void HashExecutableIdentity(Sha256 &hash) {
+            std::error_code sizeError;
+            std::error_code timeError;
+            auto executable = GetExecutablePath();
+            auto size = std::filesystem::file_size(executable, sizeError);
+            auto modified = std::filesystem::last_write_time(executable, timeError);
+            if (sizeError || timeError) {
+                hash.UpdateField("unknown executable");
+                return;
+            }
+            hash.UpdateField(executable.generic_string());
+            hash.UpdateField(std::to_string(size));
+            hash.UpdateField(std::to_string(modified.time_since_epoch().count()));
+        }
+    }
+
+    std::string ComputeLanguageDigest(const std::filesystem::path &languageRootDir) {
+        std::vector<std::pair<std::string, std::filesystem::path>> files;
+        for (const auto &entry: std::filesystem::recursive_directory_iterator(languageRootDir)) {
+            if (!entry.is_regular_file())
+                continue;
+            const auto &path = entry.path();
+            auto name = path.filename().string();
+            if (path.extension() == ".lua" || name == "Language_Specification.yaml" || name == "Language.bundle") {
+                files.emplace_back(std::filesystem::relative(path, languageRootDir).generic_string(), path);
+            }
+        }
+        std::ranges::sort(files);
+
+        Sha256 hash;
+        hash.UpdateField("easyasm-language");
+        HashExecutableIdentity(hash);
+        for (const auto &[name, path]: files) {
+            auto contents = ReadWholeFile(path);
+            if (!contents) {
+                throw std::runtime_error(std::format("Failed to read '{}' for the build cache", path.string()));
+            }
+            hash.UpdateField(name);
+            hash.UpdateField(*contents);
+        }
+        return hash.FinishHex();
+    }
+
+    BuildCache::BuildCache(std::filesystem::path directory, uint64_t maxBytes)
+        : m_Directory(std::move(directory)), m_MaxBytes(maxBytes) {
+        std::filesystem::create_directories(m_Directory);
+    }
+
+    std::string BuildCache::MakeKey(std::string_view languageDigest, std::string_view source,
+                                    std::span<const Output::OutputFormat> formats, std::string_view linkOptions) {
+        Sha256 hash;
+        hash.UpdateField("easyasm-cache/2");
+        hash.UpdateField(languageDigest);
+        std::string formatList = formats.empty() ? "language default" : "";
+        for (auto format: formats) {
+            formatList += Output::GetFileExtension(format);
+            formatList += ';';
+        }
+        hash.UpdateField(formatList);
+        hash.UpdateField(linkOptions);
+        hash.UpdateField(source);
+        return hash.FinishHex();
+    }
+
+    std::filesystem::path BuildCache::GetEntryPath(const std::string &key) const {
+        // fan out by the first two hex digits to keep directories small
+        return m_Directory / key.substr(0, 2) / (key + std::string(entryExtension));
+    }
+
+    std::optional<std::vector<CachedFile>> BuildCache::Lookup(const std::string &key) const {
+        auto path = GetEntryPath(key);
+        auto data = ReadWholeFile(path);
+        if (!data)
+            return std::nullopt;
+
+        EntryReader reader(*data);
+        if (reader.Take(entryMagic.size()) != entryMagic || reader.ReadInteger<uint32_t>() != entryVersion)
+            return std::nullopt;
+        auto count = reader.ReadInteger<uint32_t>();
+        if (!count)
+            return std::nullopt;
+
+        std::vector<CachedFile> files;
+        for (uint32_t i = 0; i < *count; ++i) {
+            auto extension = reader.ReadBlob();
+            auto contents = reader.ReadBlob();
+            if (!extension || !contents)
+                return std::nullopt;
+            files.push_back({std::string(*extension), std::string(*contents)});
+        }
+        if (!reader.AtEnd())
+            return std::nullopt;
+
+        // the modification time is the LRU clock, losing this race to an eviction only costs a rebuild
+        std::error_code error;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+        return files;
+    }
+
+    bool BuildCache::Store(const std::string &key, std::span<const CachedFile> files) const {
+        std::string data(entryMagic);
+        AppendInteger<uint32_t>(data, entryVersion);
+        AppendInteger<uint32_t>(data, static_cast<uint32_t>(files.size()));
+        for (const auto &file: files) {
+            AppendBlob(data, file.Extension);
+            AppendBlob(data, file.Contents);
+        }
+
+        auto path = GetEntryPath(key);
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+
+        // unique per writer, so concurrent stores of the same key never share a temporary file
+        static std::atomic<uint64_t> counter{0};
+        auto temporaryPath = path;
+        temporaryPath += std::format("{}{:x}-{:x}-{}", temporaryMarker,
+                                     std::hash<std::thread::id>{}(std::this_thread::get_id()),
+                                     std::random_device{}(), counter.fetch_add(1));
+        {
+            std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+            output.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!output) {
+                output.close();
+                std::filesystem::remove(temporaryPath, error);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error) {
+            // another process may hold the entry open (Windows), its copy is just as good
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+        m_StoredBytes += data.size();
+        return true;
+    }
+
+    void BuildCache::Trim() const {
+        auto storedBytes = m_StoredBytes.load();
+        if (storedBytes == 0)
+            return;
+
+        auto now = std::filesystem::file_time_type::clock::now();
+        std::error_code error;
+        auto stampPath = m_Directory / trimStampName;
+        auto lastTrim = std::filesystem::last_write_time(stampPath, error);
+        if (!error && now - lastTrim < trimInterval && storedBytes < m_MaxBytes / 16)
+            return;
+
+        // claim the walk before it starts, so concurrent builds don't all walk the cache at once
+        if (error) {
+            std::ofstream{stampPath, std::ios::binary | std::ios::app};
+        }
+        std::filesystem::last_write_time(stampPath, now, error);
+        error.clear();
+        m_StoredBytes = 0;
+
+        struct Entry {
+            std::filesystem::path Path;
+            uint64_t Size;
+            std::filesystem::file_time_type LastUsed;
+        };
+
+        std::vector<Entry> entries;
+        uint64_t totalBytes = 0;
+        for (auto it = std::filesystem::recursive_directory_iterator(m_Directory, error);
+             !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+            if (!it->is_regular_file(error))
+                continue;
+
+            auto path = it->path();
+            auto size = it->file_size(error);
+            auto lastUsed = it->last_write_time(error);
+            if (error) {
+                error.clear(); // removed by another process meanwhile
+                continue;
+            }
+
+            if (path.filename().string().find(temporaryMarker) != std::string::npos) {
+                if (now - lastUsed > abandonedTemporaryAge) {
+                    std::filesystem::remove(path, error);
+                    error.clear();
+                }
+                continue;
+            }
+            if (path.extension() != entryExtension)
+                continue;
+
+            entries.push_back({std::move(path), size, lastUsed});
+            totalBytes += size;
+        }
+
+        if (totalBytes <= m_MaxBytes)
+            return;
+
+        std::ranges::sort(entries, {}, &Entry::LastUsed);
+        for (const auto &entry: entries) {
+            if (totalBytes <= m_MaxBytes)
+                break;
+            // best effort, an entry another process holds open or already evicted counts as gone
+            std::filesystem::remove(entry.Path, error);
+            error.clear();
+            totalBytes -= entry.Size;
+        }
+    }
+}
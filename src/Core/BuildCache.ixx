@@ -0,0 +1,52 @@
+export module Core.BuildCache;
+
+import std;
+import Core.Output;
+
+namespace Core::Cache {
+    export constexpr uint64_t DefaultMaxCacheBytes = 1ull << 30;
+
+    // One output file of an assembled image, stored without the source's stem.
+    export struct CachedFile {
+        std::string Extension; // including the dot, e.g. ".mem"
+        std::string Contents;
+    };
+
+    // Digest of everything in the language root that can change an image: every .lua file, the
+    // specification, a prebuilt bundle, and the identity of the running assembler itself.
+    export std::string ComputeLanguageDigest(const std::filesystem::path &languageRootDir);
+
+    // Content-addressed store of assembled images below one directory, safe to share between processes.
+    // Entries are written to a temporary file and renamed into place, a hit refreshes the entry's
+    // modification time, and Trim evicts the least recently used entries beyond the size limit.
+    export class BuildCache {
+    public:
+        BuildCache(std::filesystem::path directory, uint64_t maxBytes);
+
+        // The requested formats are part of the key, an empty list stands for the language's own choice, and
+        // so are options that change what is written, e.g. dead code elimination or the stem an HDL entity is
+        // named after.
+        [[nodiscard]] static std::string MakeKey(std::string_view languageDigest, std::string_view source,
+                                                 std::span<const Output::OutputFormat> formats,
+                                                 std::string_view linkOptions = {});
+
+        // nullopt on a miss, and for an entry that is unreadable or was evicted while being read.
+        [[nodiscard]] std::optional<std::vector<CachedFile>> Lookup(const std::string &key) const;
+
+        // Best effort: false if the entry could not be written (disk full, read-only share, ...).
+        bool Store(const std::string &key, std::span<const CachedFile> files) const;
+
+        // Evicts entries, oldest first, until the cache fits its size limit; also removes temporary files
+        // abandoned by crashed writers. Meant to run once per invocation rather than after every store, and
+        // only walks the cache if this instance stored something and no process has trimmed it recently,
+        // unless the stores alone could have pushed it over the limit.
+        void Trim() const;
+
+    private:
+        [[nodiscard]] std::filesystem::path GetEntryPath(const std::string &key) const;
+
+        std::filesystem::path m_Directory;
+        uint64_t m_MaxBytes;
+        mutable std::atomic<uint64_t> m_StoredBytes{0};
+    };
+}
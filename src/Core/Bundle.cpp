@@ -0,0 +1,232 @@
+module Core.Bundle;
+
+import std;
+import Core.Sha256;
+
+namespace Core::Bundle {
+    namespace {
+        constexpr std::string_view bundleMagic = "EASMBNDL";
+        constexpr uint32_t bundleVersion = 3;
+
+        template<std::unsigned_integral Integer>
+        void AppendInteger(std::string &output, Integer value) {
+            for (size_t i = 0; i < sizeof(Integer); ++i) {
+                output += static_cast<char>((value >> (8 * i)) & 0xFF); // little endian
+            }
+        }
+
+        void AppendBlob(std::string &output, std::string_view blob) {
+            AppendInteger<uint64_t>(output, blob.size());
+            output.append(blob);
+        }
+
+        std::string ReadSourceFile(const std::filesystem::path &path) {
+            std::ifstream input(path, std::ios::binary);
+            if (!input) {
+                throw std::runtime_error(std::format("Failed to read '{}'", path.string()));
+            }
+            return {std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+        }
+
+        std::optional<BundleSource> StatSource(const std::filesystem::path &languageRootDir,
+                                               const std::filesystem::path &path) {
+            std::error_code error;
+            auto status = std::filesystem::status(path, error);
+            if (error || !std::filesystem::exists(status)) {
+                return std::nullopt;
+            }
+
+            BundleSource source;
+            source.Name = std::filesystem::relative(path, languageRootDir).generic_string();
+            source.Directory = std::filesystem::is_directory(status);
+            if (!source.Directory) {
+                source.Size = std::filesystem::file_size(path, error);
+            }
+            auto modifiedTime = error ? std::filesystem::file_time_type{}
+                                      : std::filesystem::last_write_time(path, error);
+            if (error) {
+                return std::nullopt;
+            }
+            source.ModifiedTime = static_cast<int64_t>(modifiedTime.time_since_epoch().count());
+            return source;
+        }
+
+        class BundleReader {
+        public:
+            BundleReader(std::string_view data, const std::filesystem::path &path)
+                : m_Data(data), m_Path(path) {}
+
+            template<std::unsigned_integral Integer>
+            Integer ReadInteger() {
+                auto bytes = Take(sizeof(Integer));
+                Integer value = 0;
+                for (size_t i = 0; i < sizeof(Integer); ++i) {
+                    value |= static_cast<Integer>(static_cast<uint8_t>(bytes[i])) << (8 * i);
+                }
+                return value;
+            }
+
+            std::string_view ReadBlob() {
+                auto size = ReadInteger<uint64_t>();
+                return Take(size);
+            }
+
+            std::string_view Take(size_t size) {
+                if (m_Data.size() < size) {
+                    throw std::runtime_error(std::format("Language bundle '{}' is truncated", m_Path.string()));
+                }
+                auto result = m_Data.substr(0, size);
+                m_Data.remove_prefix(size);
+                return result;
+            }
+
+        private:
+            std::string_view m_Data;
+            const std::filesystem::path &m_Path;
+        };
+    }
+
+    std::vector<std::filesystem::path> CollectLuaSources(const std::filesystem::path &directory) {
+        std::vector<std::filesystem::path> sources;
+        for (const auto &entry: std::filesystem::recursive_directory_iterator(directory)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".lua") {
+                sources.push_back(entry.path());
+            }
+        }
+
+        std::ranges::sort(sources, {}, [&](const std::filesystem::path &source) {
+            return std::filesystem::relative(source, directory).generic_string();
+        });
+        return sources;
+    }
+
+    std::string ComputeSourceDigest(const std::filesystem::path &languageRootDir,
+                                    const std::filesystem::path &specificationPath,
+                                    std::span<const std::filesystem::path> luaSources) {
+        Sha256 hash;
+        hash.UpdateField("easyasm-bundle-sources");
+        auto addFile = [&](const std::filesystem::path &path) {
+            hash.UpdateField(std::filesystem::relative(path, languageRootDir).generic_string());
+            hash.UpdateField(ReadSourceFile(path));
+        };
+        addFile(specificationPath);
+        for (const auto &luaSource: luaSources) {
+            addFile(luaSource);
+        }
+        return hash.FinishHex();
+    }
+
+    std::vector<BundleSource> DescribeSources(const std::filesystem::path &languageRootDir,
+                                              const std::filesystem::path &specificationPath,
+                                              const std::filesystem::path &languageLoadPath,
+                                              std::span<const std::filesystem::path> luaSources) {
+        std::vector<std::filesystem::path> paths{specificationPath, languageLoadPath};
+        for (const auto &entry: std::filesystem::recursive_directory_iterator(languageLoadPath)) {
+            if (entry.is_directory()) {
+                paths.push_back(entry.path());
+            }
+        }
+        paths.insert(paths.end(), luaSources.begin(), luaSources.end());
+
+        std::vector<BundleSource> sources;
+        sources.reserve(paths.size());
+        for (const auto &path: paths) {
+            auto source = StatSource(languageRootDir, path);
+            if (!source) {
+                throw std::runtime_error(std::format("Failed to read '{}'", path.string()));
+            }
+            sources.push_back(std::move(*source));
+        }
+        return sources;
+    }
+
+    bool SourcesUnchanged(const std::filesystem::path &languageRootDir, std::span<const BundleSource> sources) {
+        if (sources.empty()) {
+            return false;
+        }
+        for (const auto &recorded: sources) {
+            auto current = StatSource(languageRootDir, languageRootDir / recorded.Name);
+            if (!current || current->Directory != recorded.Directory || current->Size != recorded.Size ||
+                current->ModifiedTime != recorded.ModifiedTime) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void WriteBundle(const LanguageBundle &bundle, const std::filesystem::path &path) {
+        std::string data(bundleMagic);
+        AppendInteger<uint32_t>(data, bundleVersion);
+        AppendInteger<uint32_t>(data, static_cast<uint32_t>(bundle.Chunks.size()));
+        AppendBlob(data, bundle.Configuration);
+        AppendBlob(data, bundle.SourceDigest);
+        AppendInteger<uint32_t>(data, static_cast<uint32_t>(bundle.Sources.size()));
+        for (const auto &source: bundle.Sources) {
+            AppendBlob(data, source.Name);
+            AppendInteger<uint8_t>(data, source.Directory ? 1 : 0);
+            AppendInteger<uint64_t>(data, source.Size);
+            AppendInteger<uint64_t>(data, static_cast<uint64_t>(source.ModifiedTime));
+        }
+        for (const auto &chunk: bundle.Chunks) {
+            AppendBlob(data, chunk.Name);
+            AppendBlob(data, chunk.Bytecode);
+        }
+
+        // write next to the target and rename, so a running compiler never sees half a bundle
+        auto temporaryPath = path;
+        temporaryPath += ".tmp";
+        {
+            std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+            output.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!output) {
+                throw std::runtime_error(std::format("Failed to write language bundle '{}'", temporaryPath.string()));
+            }
+        }
+        std::filesystem::rename(temporaryPath, path);
+    }
+
+    std::optional<LanguageBundle> ReadBundle(const std::filesystem::path &path) {
+        std::ifstream input(path, std::ios::binary | std::ios::ate);
+        if (!input) {
+            return std::nullopt;
+        }
+
+        std::string data(static_cast<size_t>(input.tellg()), '\0');
+        input.seekg(0);
+        input.read(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!input) {
+            throw std::runtime_error(std::format("Failed to read language bundle '{}'", path.string()));
+        }
+
+        BundleReader reader(data, path);
+        if (reader.Take(bundleMagic.size()) != bundleMagic) {
+            throw std::runtime_error(std::format("'{}' is not a language bundle", path.string()));
+        }
+        if (auto version = reader.ReadInteger<uint32_t>(); version != bundleVersion) {
+            throw std::runtime_error(std::format("Language bundle '{}' has unsupported version {}, rebuild it",
+                                                 path.string(), version));
+        }
+
+        LanguageBundle bundle;
+        auto chunkCount = reader.ReadInteger<uint32_t>();
+        bundle.Configuration = reader.ReadBlob();
+        bundle.SourceDigest = reader.ReadBlob();
+        auto sourceCount = reader.ReadInteger<uint32_t>();
+        bundle.Sources.reserve(sourceCount);
+        for (uint32_t i = 0; i < sourceCount; ++i) {
+            BundleSource source;
+            source.Name = reader.ReadBlob();
+            source.Directory = reader.ReadInteger<uint8_t>() != 0;
+            source.Size = reader.ReadInteger<uint64_t>();
+            source.ModifiedTime = static_cast<int64_t>(reader.ReadInteger<uint64_t>());
+            bundle.Sources.push_back(std::move(source));
+        }
+        bundle.Chunks.reserve(chunkCount);
+        for (uint32_t i = 0; i < chunkCount; ++i) {
+            auto name = reader.ReadBlob();
+            auto bytecode = reader.ReadBlob();
+            bundle.Chunks.push_back({std::string(name), std::string(bytecode)});
+        }
+        return bundle;
+    }
+}
@@ -0,0 +1,54 @@
+export module Core.Bundle;
+
+import std;
+
+namespace Core::Bundle {
+    export constexpr std::string_view BundleFileName = "Language.bundle";
+
+    export struct BundleChunk {
+        std::string Name; // path relative to the language root, used as the Lua chunk name
+        std::string Bytecode;
+    };
+
+    // What a source file or directory looked like when the bundle was built, compared with a single stat.
+    export struct BundleSource {
+        std::string Name; // path relative to the language root
+        bool Directory = false;
+        uint64_t Size = 0; // always 0 for a directory
+        int64_t ModifiedTime = 0; // ticks of std::filesystem::file_time_type
+    };
+
+    // A whole language in one file: the serialized specification and every library chunk in load order.
+    export struct LanguageBundle {
+        std::string Configuration;
+        std::string SourceDigest; // of the files it was built from, see ComputeSourceDigest
+        std::vector<BundleSource> Sources;
+        std::vector<BundleChunk> Chunks;
+    };
+
+    // Every .lua file below the directory, sorted by relative path so load order never depends on
+    // the order the filesystem enumerates entries in.
+    export std::vector<std::filesystem::path> CollectLuaSources(const std::filesystem::path &directory);
+
+    // SHA-256 of the specification and the Lua sources, with their paths relative to the language root,
+    // which tells a bundle that no longer matches the files next to it.
+    export std::string ComputeSourceDigest(const std::filesystem::path &languageRootDir,
+                                           const std::filesystem::path &specificationPath,
+                                           std::span<const std::filesystem::path> luaSources);
+
+    // The specification, the Lua sources and every directory below the load path, whose times change
+    // when a source is added or removed.
+    export std::vector<BundleSource> DescribeSources(const std::filesystem::path &languageRootDir,
+                                                     const std::filesystem::path &specificationPath,
+                                                     const std::filesystem::path &languageLoadPath,
+                                                     std::span<const std::filesystem::path> luaSources);
+
+    // True if every recorded source still has its size and time, without reading any of them.
+    export bool SourcesUnchanged(const std::filesystem::path &languageRootDir,
+                                 std::span<const BundleSource> sources);
+
+    export void WriteBundle(const LanguageBundle &bundle, const std::filesystem::path &path);
+
+    // Reads the whole bundle with a single read, nullopt if there is no bundle at the path.
+    export std::optional<LanguageBundle> ReadBundle(const std::filesystem::path &path);
+}
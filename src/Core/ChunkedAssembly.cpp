@@ -0,0 +1,308 @@
+module Core.ChunkedAssembly;
+
+import std;
+import Core.Compiler;
+import Core.Parser;
+import Core.SourceBuffer;
+import Core.MnemonicTable;
+import Core.BitBuffer;
+import Core.SymbolTable;
+import Core.Profiler;
+import Core.WorkerPool;
+import Core.Diagnostics;
+import Core.DeadCode;
+
+namespace Core::Chunked {
+    namespace {
+        constexpr size_t chunksPerThread = 4; // spare chunks even out lines that take longer than others
+
+        // Byte offsets of token locations, found by walking the lines in order once.
+        class LineIndex {
+        public:
+            explicit LineIndex(std::string_view text) : m_Text(text) {}
+
+            size_t GetOffset(const SourceLocation &location) {
+                while (m_Line < location.Line) {
+                    m_LineStart = m_Text.find('\n', m_LineStart) + 1;
+                    ++m_Line;
+                }
+                return m_LineStart + location.Column - 1;
+            }
+
+        private:
+            std::string_view m_Text;
+            size_t m_Line = 1;
+            size_t m_LineStart = 0;
+        };
+
+        struct ChunkResult {
+            BitBuffer Bits;
+            SymbolTable Symbols;
+            std::optional<size_t> PlacementEnd; // bit size right after the placement directive of a placed chunk
+            std::vector<DeadCode::Placement> Placements;
+            std::vector<std::string> Messages;
+            std::vector<Diagnostic> Diagnostics; // warnings only, a chunk with errors has Failed set
+            bool Failed = false;
+        };
+
+        // Owns a Compiler and with it a Lua state, so one worker never shares handlers with another.
+        class ChunkWorker {
+        public:
+            ChunkWorker(const std::filesystem::path &languageRootDir,
+                        std::shared_ptr<Profiling::Profiler> profiler)
+                : m_Compiler(languageRootDir, std::move(profiler)) {
+                m_Compiler.SetPrintHandler([this](std::string_view message) {
+                    if (m_Messages) {
+                        m_Messages->emplace_back(message);
+                    }
+                });
+            }
+
+            ChunkResult Compile(const std::shared_ptr<const SourceBuffer> &source, const ChunkPlan &plan,
+                                size_t index) {
+                m_Messages = nullptr; // the event and replayed directives print in the chunks that own them
+
+                const auto &chunk = plan.Chunks[index];
+                SourceCompiler sourceCompiler{m_Compiler.CreateSourceCompiler(source)};
+                sourceCompiler.BeginCompile();
+                for (const auto &directive: plan.StateDirectives) {
+                    if (directive.Begin >= chunk.Range.Begin)
+                        break;
+                    sourceCompiler.SetSourceRange(directive);
+                    while (!sourceCompiler.CompileOneLine()) {}
+                }
+                if (index != 0) {
+                    // only the first chunk keeps what the event wrote, as it is first in a sequential compile
+                    sourceCompiler.GetBitBuffer().Clear();
+                    sourceCompiler.GetSymbolTable().Clear();
+                    sourceCompiler.GetDiagnostics().Clear();
+                    sourceCompiler.GetPlacements().clear();
+                }
+
+                ChunkResult result;
+                m_Messages = &result.Messages;
+                sourceCompiler.SetSourceRange(chunk.Range);
+                if (chunk.Placed) {
+                    sourceCompiler.CompileOneLine();
+                    result.PlacementEnd = sourceCompiler.GetBitBufferSize();
+                }
+                while (!sourceCompiler.CompileOneLine()) {}
+                m_Messages = nullptr;
+
+                result.Failed = sourceCompiler.GetDiagnostics().HasErrors();
+                result.Diagnostics = sourceCompiler.GetDiagnostics().GetSorted();
+                result.Bits = std::move(sourceCompiler.GetBitBuffer());
+                result.Symbols = std::move(sourceCompiler.GetSymbolTable());
+                result.Placements = std::move(sourceCompiler.GetPlacements());
+                return result;
+            }
+
+        private:
+            Compiler m_Compiler;
+            std::vector<std::string> *m_Messages = nullptr;
+        };
+
+        void AppendBits(BitBuffer &destination, const BitBuffer &source, size_t from) {
+            for (size_t bit = from; bit < source.Size();) {
+                size_t bits = std::min(BitBuffer::WordBits, source.Size() - bit);
+                destination.PushBits(source.ReadBits(bit, bits), bits);
+                bit += bits;
+            }
+        }
+
+        // Concatenates the chunks as a sequential compile would have laid them out. False if the result
+        // would differ, the caller then compiles sequentially to report what is wrong.
+        bool MergeChunks(std::span<const ChunkResult> chunks, size_t wordWidth,
+                         BitBuffer &bitBuffer, SymbolTable &symbolTable,
+                         std::vector<DeadCode::Placement> &placements) {
+            uint64_t totalBits = 0;
+            for (const auto &chunk: chunks) {
+                totalBits += chunk.Bits.Size();
+            }
+            bitBuffer.Reserve(totalBits);
+
+            for (const auto &chunk: chunks) {
+                uint64_t baseBit = 0;
+                size_t copyFrom = 0;
+                if (chunk.PlacementEnd) {
+                    // compiled from an empty buffer, so everything after the placement already sits where it
+                    // belongs and the bits before it are padding
+                    if (bitBuffer.Size() > *chunk.PlacementEnd)
+                        return false;
+                    copyFrom = bitBuffer.Size();
+                } else {
+                    baseBit = bitBuffer.Size();
+                    if (baseBit % wordWidth != 0)
+                        return false;
+                }
+                AppendBits(bitBuffer, chunk.Bits, copyFrom);
+
+                uint64_t baseAddress = baseBit / wordWidth;
+                for (const auto &placement: chunk.Placements) {
+                    // the padding of a placed chunk starts where the chunk before it ended
+                    placements.push_back({std::max(baseAddress + placement.From, copyFrom / wordWidth),
+                                          baseAddress + placement.To});
+                }
+                std::vector<SymbolId> localToMerged(chunk.Symbols.GetSymbolCount());
+                for (SymbolId id = 0; id < localToMerged.size(); ++id) {
+                    const auto &name = chunk.Symbols.GetName(id);
+                    const auto &definition = chunk.Symbols.GetDefinition(id);
+                    localToMerged[id] = symbolTable.Intern(name);
+                    if (definition.Address && !symbolTable.DefineLabel(name, baseAddress + *definition.Address))
+                        return false;
+                    if (definition.Value && !symbolTable.DefineConstant(name, *definition.Value))
+                        return false;
+                }
+
+                for (const auto &relocation: chunk.Symbols.GetRelocations()) {
+                    symbolTable.AddRelocation(relocation.Kind, localToMerged[relocation.Symbol],
+                                              baseBit + relocation.Offset, relocation.Width);
+                }
+            }
+            return true;
+        }
+    }
+
+    ChunkPlan PlanChunks(const std::shared_ptr<const SourceBuffer> &source, const MnemonicTable &mnemonics,
+                         const ChunkingDirectives &directives, size_t chunkCount,
+                         size_t minChunkStatements) {
+        // where a chunk may start: every line's first statement, and every placement directive
+        struct Cut {
+            size_t Offset;
+            SourceLocation Location;
+            bool Placed;
+        };
+
+        // a statement is the first token of a line, or the one after a leading 'label:'
+        enum class Expect { Statement, LabelColon, StatementAfterLabel, Nothing };
+
+        auto text = source->GetText();
+        LineIndex lines(text);
+        TokenStream stream(source);
+        std::vector<Cut> cuts;
+        ChunkPlan plan;
+        std::optional<size_t> openStateDirective;
+        size_t previousEndLine = 0;
+        Expect expect = Expect::Nothing;
+
+        while (auto token = stream.ParseToken()) {
+            auto offset = lines.GetOffset(token->Span.Begin);
+            if (token->Span.Begin.Line > previousEndLine) {
+                if (openStateDirective) {
+                    plan.StateDirectives[*openStateDirective].End = offset;
+                    openStateDirective.reset();
+                }
+                cuts.push_back({offset, token->Span.Begin, false});
+                expect = Expect::Statement;
+            }
+            previousEndLine = token->Span.End.Line;
+
+            bool isStatement = expect == Expect::Statement || expect == Expect::StatementAfterLabel;
+            if (expect == Expect::Statement) {
+                expect = Expect::LabelColon;
+            } else if (expect == Expect::LabelColon && token->Text == ":") {
+                expect = Expect::StatementAfterLabel;
+            } else {
+                expect = Expect::Nothing;
+            }
+
+            auto opcode = isStatement ? mnemonics.Find(token->Text) : std::nullopt;
+            if (!opcode)
+                continue;
+
+            if (std::ranges::contains(directives.Placement, *opcode)) {
+                if (cuts.back().Offset == offset) {
+                    cuts.back().Placed = true;
+                } else {
+                    cuts.push_back({offset, token->Span.Begin, true});
+                }
+            } else if (std::ranges::contains(directives.State, *opcode)) {
+                openStateDirective = plan.StateDirectives.size();
+                plan.StateDirectives.push_back({offset, text.size(), token->Span.Begin});
+            }
+        }
+
+        size_t statementsPerChunk = std::max(minChunkStatements, cuts.size() / std::max<size_t>(chunkCount, 1));
+        size_t statementsInChunk = 0;
+        for (const auto &cut: cuts) {
+            if (plan.Chunks.empty() || cut.Placed || statementsInChunk >= statementsPerChunk) {
+                if (!plan.Chunks.empty()) {
+                    plan.Chunks.back().Range.End = cut.Offset;
+                }
+                plan.Chunks.push_back({{cut.Offset, text.size(), cut.Location}, cut.Placed});
+                statementsInChunk = 0;
+            }
+            ++statementsInChunk;
+        }
+        return plan;
+    }
+
+    void CompileChunked(const Compiler &compiler, SourceCompiler &sourceCompiler,
+                        const ChunkedOptions &options) {
+        const auto &directives = compiler.GetChunkingDirectives();
+        if (!directives) {
+            sourceCompiler.CompileAll();
+            return;
+        }
+
+        auto *profiler = compiler.GetProfiler();
+        size_t threadCount = options.ThreadCount == 0 ? GetDefaultWorkerCount() : options.ThreadCount;
+        const auto &source = sourceCompiler.GetTokenStream().GetSourceBuffer();
+
+        ChunkPlan plan;
+        {
+            Profiling::PhaseScope phase{profiler, "Plan chunks"};
+            plan = PlanChunks(source, compiler.GetMnemonics(), *directives, threadCount * chunksPerThread,
+                              options.MinChunkStatements);
+        }
+        if (plan.Chunks.size() < 2 || threadCount < 2) {
+            sourceCompiler.CompileAll();
+            return;
+        }
+
+        std::vector<ChunkResult> results(plan.Chunks.size());
+        try {
+            Profiling::PhaseScope phase{profiler, "Compile chunks"};
+            ParallelForEach(
+                plan.Chunks.size(), threadCount,
+                [&] {
+                    return std::make_unique<ChunkWorker>(options.LanguageRootDir, compiler.GetSharedProfiler());
+                },
+                [&](std::unique_ptr<ChunkWorker> &worker, size_t index) {
+                    results[index] = worker->Compile(source, plan, index);
+                });
+        } catch (...) {
+            sourceCompiler.CompileAll();
+            return;
+        }
+        if (std::ranges::any_of(results, &ChunkResult::Failed)) {
+            // compiled again as a whole, so diagnostics of state directives and lines are reported once each
+            sourceCompiler.CompileAll();
+            return;
+        }
+
+        BitBuffer bitBuffer;
+        SymbolTable symbolTable;
+        std::vector<DeadCode::Placement> placements;
+        bool merged;
+        {
+            Profiling::PhaseScope phase{profiler, "Merge chunks"};
+            merged = MergeChunks(results, compiler.GetImageLayout().WordWidth, bitBuffer, symbolTable, placements);
+        }
+        if (!merged) {
+            sourceCompiler.CompileAll();
+            return;
+        }
+
+        sourceCompiler.BeginCompile(); // its output, if any, is part of the first chunk
+        for (const auto &result: results) {
+            for (const auto &message: result.Messages) {
+                sourceCompiler.PrintMessage(message);
+            }
+            for (const auto &diagnostic: result.Diagnostics) {
+                sourceCompiler.GetDiagnostics().Report(diagnostic);
+            }
+        }
+        sourceCompiler.LoadProgram(std::move(bitBuffer), std::move(symbolTable), std::move(placements));
+    }
+}
@@ -0,0 +1,45 @@
+export module Core.ChunkedAssembly;
+
+import std;
+import Core.Compiler;
+import Core.Parser;
+import Core.SourceBuffer;
+import Core.MnemonicTable;
+
+namespace Core::Chunked {
+    export struct ChunkedOptions {
+        std::filesystem::path LanguageRootDir; // every worker loads its own Compiler and Lua state from here
+        size_t ThreadCount = 0;                // 0 means one worker per core
+        size_t MinChunkStatements = 256;       // smaller sources are not worth a second Lua state
+    };
+
+    export struct SourceChunk {
+        SourceRange Range;
+        bool Placed = false; // starts with a placement directive, so its code sits at an absolute position
+    };
+
+    export struct ChunkPlan {
+        std::vector<SourceChunk> Chunks;
+        std::vector<SourceRange> StateDirectives; // in source order, each one statement
+    };
+
+    // The quick pre-scan: lexes the whole source once without running any handler, finds the state and
+    // placement directives and cuts the source at statement boundaries into chunks of at least
+    // minChunkStatements statements, about chunkCount of them.
+    export ChunkPlan PlanChunks(const std::shared_ptr<const SourceBuffer> &source, const MnemonicTable &mnemonics,
+                                const ChunkingDirectives &directives, size_t chunkCount,
+                                size_t minChunkStatements);
+
+    // Compiles the source of sourceCompiler as CompileAll does, but split into chunks encoded in parallel.
+    // Before its own statements, every chunk replays the state directives of the chunks before it; labels
+    // and relocations are rebased when the chunk buffers are concatenated, constants are symbols resolved
+    // by the linker anyway. The result is bit for bit that of CompileAll, anything the chunks cannot
+    // reproduce exactly (any compile error, a symbol defined in two chunks, code overlapping a placement)
+    // makes it compile sequentially instead, so diagnostics read exactly as they do without chunking.
+    // Messages printed by the language are held back and printed in source order.
+    //
+    // Languages without a 'ParallelAssembly' section, and sources too small to split, are always compiled
+    // sequentially.
+    export void CompileChunked(const Compiler &compiler, SourceCompiler &sourceCompiler,
+                               const ChunkedOptions &options);
+}
@@ -4,17 +4,27 @@ import std;
 import Core.Lib;
 import <cassert>;
 import Core.Exceptions;
+import Core.Bundle;
+import Core.Encoder;
+import Core.Profiler;
+import Core.Diagnostics;
+import Core.Ffi;
+import Core.DeadCode;
 
 namespace Core {
     void SourceCompiler::AddLibToState(sol::state &state) {
         Lib::AddLibToState(state);
         Exceptions::AddLibToState(state);
         TokenStream::AddLibToState(state);
+        BitBuffer::AddLibToState(state);
+        SymbolTable::AddLibToState(state);
+        AddDiagnosticsLibToState(state);
 
         state.new_usertype<SourceCompiler>("SourceCompiler",
                                            "GetCompilerContext", &SourceCompiler::GetCompilerContext,
                                            "GetLinkerContext", &SourceCompiler::GetLinkerContext,
                                            "GetTokenStream", &SourceCompiler::GetTokenStream,
+                                           "GetSymbolTable", &SourceCompiler::GetSymbolTable,
                                            "GetBitBuffer", &SourceCompiler::GetBitBuffer,
                                            "WriteBit", &SourceCompiler::WriteBit,
                                            "WriteBits", &SourceCompiler::WriteBits,
@@ -22,157 +32,414 @@ namespace Core {
                                            "WriteUnsignedNumber", &SourceCompiler::WriteUnsignedNumber,
                                            "GetBitBufferSize", &SourceCompiler::GetBitBufferSize,
                                            "AlignStartAddress", &SourceCompiler::AlignStartAddress,
-                                           "ReplaceUnsignedNumber", &SourceCompiler::ReplaceUnsignedNumber
+                                           "ReplaceUnsignedNumber", &SourceCompiler::ReplaceUnsignedNumber,
+                                           "LinkSymbols", &SourceCompiler::LinkSymbols,
+                                           "ReportError", &SourceCompiler::ReportError,
+                                           "ReportWarning", &SourceCompiler::ReportWarning,
+                                           "GetNativeHandle", [](SourceCompiler &self) {
+                                               return static_cast<void *>(&self);
+                                           },
+                                           "GetWordWidth", [](const SourceCompiler &self) {
+                                               return self.GetImageLayout().WordWidth;
+                                           },
+                                           "GetAddressWidth", [](const SourceCompiler &self) {
+                                               return self.GetImageLayout().AddressWidth;
+                                           },
+                                           "GetMemoryDepth", [](const SourceCompiler &self) {
+                                               return self.GetImageLayout().MemoryDepth;
+                                           }
         );
     }
 
     void SourceCompiler::WriteBit(bool bit) {
-        m_BitBuffer.push_back(bit);
+        m_BitBuffer.PushBit(bit);
     }
 
     void SourceCompiler::WriteBits(const std::vector<bool> &bits) {
-        m_BitBuffer.insert(m_BitBuffer.end(), bits.begin(), bits.end());
+        for (bool bit: bits) {
+            m_BitBuffer.PushBit(bit);
+        }
     }
 
     void SourceCompiler::WriteSignedNumber(int64_t number, size_t bits) {
-        int64_t min_value = -(1ll << (bits - 1));
-        int64_t max_value = (1ll << (bits - 1)) - 1;
-
-        if (number < min_value || number > max_value) {
-            throw Exceptions::CompileError(
-                std::format("Compile Error({}): Signed number {} exceeds the bit limit of {} bits (valid range: [{}, {}])",
-                            m_TokenStream.GetApproxCurrentLocation(), number, bits, min_value, max_value));
+        if (bits == 0 || bits > BitBuffer::WordBits) {
+            FailStatement(std::format("Cannot encode a signed number into {} bits", bits));
         }
 
-        // Two's complement encoding, masked to lower 'bits' bits
-        uint64_t encoded = static_cast<uint64_t>(number) & ((1ull << bits) - 1);
+        int64_t min_value = bits == 64 ? std::numeric_limits<int64_t>::min() : -(1ll << (bits - 1));
+        int64_t max_value = bits == 64 ? std::numeric_limits<int64_t>::max() : (1ll << (bits - 1)) - 1;
 
-        for (size_t i = 0; i < bits; ++i) {
-            m_BitBuffer.push_back((encoded >> i) & 1);  // LSB first
+        if (number < min_value || number > max_value) {
+            FailStatement(std::format("Signed number {} exceeds the bit limit of {} bits (valid range: [{}, {}])",
+                                      number, bits, min_value, max_value));
         }
+
+        // Two's complement encoding, PushBits masks to the lower 'bits' bits
+        m_BitBuffer.PushBits(static_cast<uint64_t>(number), bits);
     }
 
     void SourceCompiler::WriteUnsignedNumber(uint64_t number, size_t bits) {
-        if (number >= (1ull << bits)) {
-            throw Exceptions::CompileError(
-                std::format("Compile Error({}): Number {} exceeds the bit limit of {} bits",
-                            m_TokenStream.GetApproxCurrentLocation(), number, bits));
+        if (bits < BitBuffer::WordBits && number >= (1ull << bits)) {
+            FailStatement(std::format("Number {} exceeds the bit limit of {} bits", number, bits));
         }
 
-        for (size_t i = 0; i < bits; ++i) {
-            bool bit = (number >> i) & 1;  // LSB first
-            m_BitBuffer.push_back(bit);
+        // Wider fields (e.g. ADDRESS padding) are the value followed by zero bits
+        if (bits > BitBuffer::WordBits) {
+            m_BitBuffer.PushBits(number, BitBuffer::WordBits);
+            m_BitBuffer.PushZeros(bits - BitBuffer::WordBits);
+            return;
         }
+
+        m_BitBuffer.PushBits(number, bits);
     }
 
     void SourceCompiler::ReplaceUnsignedNumber(uint64_t number, size_t bits, size_t startIndex) {
-        if (number >= (1ull << bits)) {
-            throw Exceptions::CompileError(
-                std::format("Compile Error({}): Number {} exceeds the bit limit of {} bits",
-                            m_TokenStream.GetApproxCurrentLocation(), number, bits));
+        if (bits > BitBuffer::WordBits || (bits < BitBuffer::WordBits && number >= (1ull << bits))) {
+            FailStatement(std::format("Number {} exceeds the bit limit of {} bits", number, bits));
         }
 
-        if (startIndex + bits > m_BitBuffer.size()) {
-            throw Exceptions::CompileError(
-                std::format("Compile Error({}): Attempted to replace bits beyond the current buffer size",
-                            m_TokenStream.GetApproxCurrentLocation()));
+        if (startIndex + bits > m_BitBuffer.Size()) {
+            FailStatement("Attempted to replace bits beyond the current buffer size");
         }
 
-        for (size_t i = 0; i < bits; ++i) {
-            m_BitBuffer[startIndex + i] = (number >> i) & 1;  // LSB first
-        }
+        m_BitBuffer.ReplaceBits(number, bits, startIndex);
     }
 
 
     size_t SourceCompiler::GetBitBufferSize() const {
-        return m_BitBuffer.size();
+        return m_BitBuffer.Size();
+    }
+
+    std::optional<size_t> SourceCompiler::ResolveRegister(const Encoder::RegisterSpec &spec,
+                                                          std::string_view token) const {
+        auto aliases = m_CompilerContext.get<sol::optional<sol::table>>(spec.AliasTable);
+
+        // a renamed register is only reachable through its alias
+        if (auto index = Encoder::ParseRegisterName(spec, token)) {
+            if (aliases && aliases->get<sol::object>(*index).valid()) {
+                return std::nullopt;
+            }
+            return index;
+        }
+
+        if (!aliases) {
+            return std::nullopt;
+        }
+        for (size_t i = 0; i < spec.Count; ++i) {
+            auto alias = aliases->get<sol::optional<std::string_view>>(i);
+            if (alias && *alias == token) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void SourceCompiler::RequestLink(RelocationKind kind, std::string_view symbol, size_t start, size_t bits) {
+        m_SymbolTable.AddRelocation(kind, symbol, start, bits);
+    }
+
+    void SourceCompiler::PrintMessage(std::string_view message) const {
+        sol::function print = (*m_SharedState)["print"];
+        print(message);
+    }
+
+    void SourceCompiler::ReportError(std::string message) {
+        m_Diagnostics.Report(Severity::Error, m_TokenStream.GetCurrentSpan(), std::move(message));
+    }
+
+    void SourceCompiler::ReportWarning(std::string message) {
+        m_Diagnostics.Report(Severity::Warning, m_TokenStream.GetCurrentSpan(), std::move(message));
+    }
+
+    void SourceCompiler::ReportDiagnostics() {
+        if (m_Diagnostics.IsEmpty())
+            return;
+
+        auto diagnostics = m_Diagnostics.GetSorted();
+        bool hasErrors = m_Diagnostics.HasErrors();
+        m_Diagnostics.Clear();
+        if (hasErrors) {
+            throw DiagnosticError(std::move(diagnostics));
+        }
+        PrintMessage(FormatDiagnostics(diagnostics));
+    }
+
+    void SourceCompiler::FailStatement(std::string message) {
+        auto fullMessage = std::format("Compile Error({}): {}", m_TokenStream.GetApproxCurrentLocation(), message);
+        throw StatementError(m_TokenStream.GetCurrentSpan(), std::move(message), fullMessage);
+    }
+
+    void SourceCompiler::SkipFailedStatement(const SourceLocation &statementBegin) {
+        // a handler that failed before taking a token would otherwise be handed the same one again
+        if (auto next = m_TokenStream.PeekToken();
+            next && next->Span.Begin.Line == statementBegin.Line && next->Span.Begin.Column == statementBegin.Column) {
+            m_TokenStream.SkipCurrent();
+        }
+        m_TokenStream.SkipLine();
+        m_TokenStream.SetNewLine(true);
     }
 
     bool SourceCompiler::CompileOneLine() {
-        auto token = m_TokenStream.PeekCurrent();
+        auto token = m_TokenStream.PeekToken();
         if (!token)
             return true;
 
-        auto unwrapped = std::move(token.value());
-        auto lower = Lib::ToLowerCase(unwrapped);
-        if (!m_NameToFunctionMap->contains(lower)) {
-            m_NameToFunctionMap->at("Compiler@NonInstructionHandler")(*this);
-        } else {
-            m_TokenStream.SkipCurrent();
-            m_NameToFunctionMap->at(lower)(*this);
+        size_t errorCount = m_Diagnostics.GetErrorCount();
+        try {
+            if (auto opcode = m_Dispatch->Mnemonics.Find(token->Text)) {
+                m_TokenStream.SkipCurrent();
+                uint64_t begin = m_BitBuffer.Size();
+                m_Dispatch->Instructions[*opcode](*this);
+                if (m_Dispatch->DeadCodeRules &&
+                    std::ranges::contains(m_Dispatch->DeadCodeRules->PlacementDirectives, *opcode)) {
+                    m_Placements.push_back({begin / m_ImageLayout.WordWidth,
+                                            m_BitBuffer.Size() / m_ImageLayout.WordWidth});
+                }
+            } else {
+                m_Dispatch->NonInstruction(*this);
+            }
+        } catch (const StatementError &e) {
+            m_Diagnostics.Report(e.ToDiagnostic());
+        } catch (const Exceptions::CompileError &e) {
+            m_Diagnostics.Report(Severity::Error, m_TokenStream.GetCurrentSpan(), e.what());
         }
 
+        if (m_Diagnostics.GetErrorCount() != errorCount) {
+            SkipFailedStatement(token->Span.Begin);
+        }
         return false;
     }
 
+    void SourceCompiler::BeginCompile() {
+        m_Dispatch->BeforeCompile(*this);
+    }
+
+    void SourceCompiler::SetSourceRange(const SourceRange &range) {
+        m_TokenStream = TokenStream(m_TokenStream.GetSourceBuffer(), range);
+    }
+
     void SourceCompiler::CompileAll() {
-        m_NameToFunctionMap->at("Compiler@BeforeCompile")(*this);
+        Profiling::PhaseScope phase{m_Profiler.get(), "SourceCompiler::CompileAll"};
+        BeginCompile();
 
         while (!CompileOneLine()) {}
     }
 
     void SourceCompiler::Link() {
-        m_NameToFunctionMap->at("Compiler@BeforeLink")(*this);
-        m_NameToFunctionMap->at("Compiler@Linker")(*this);
-        m_NameToFunctionMap->at("Compiler@AfterLink")(*this);
+        Profiling::PhaseScope phase{m_Profiler.get(), "SourceCompiler::Link"};
+        // linked even after compile errors, so unresolved symbols are reported in the same run
+        try {
+            if (m_DeadCodeOptions.IsEnabled() && !m_Diagnostics.HasErrors()) {
+                EliminateDeadCode();
+            }
+            m_Dispatch->BeforeLink(*this);
+            m_Dispatch->Linker(*this);
+            m_Dispatch->AfterLink(*this);
+        } catch (const Exceptions::CompilerImplementationError &) {
+            // a program that failed to compile may be in a state the linker was never meant to see
+            if (!m_Diagnostics.HasErrors())
+                throw;
+        } catch (const Exceptions::EasyASMException &e) {
+            m_Diagnostics.Report(Severity::Error, std::nullopt, e.what());
+        }
+        ReportDiagnostics();
+    }
+
+    void SourceCompiler::EliminateDeadCode() {
+        Profiling::PhaseScope phase{m_Profiler.get(), "SourceCompiler::EliminateDeadCode"};
+        if (!m_Dispatch->DeadCodeRules) {
+            throw Exceptions::LinkError(
+                "The language has no 'DeadCodeElimination' section, so unused code cannot be found");
+        }
+
+        auto report = DeadCode::EliminateDeadCode(m_BitBuffer, m_SymbolTable, m_Placements, m_ImageLayout.WordWidth,
+                                                  *m_Dispatch->DeadCodeRules, m_DeadCodeOptions);
+        if (m_DeadCodeOptions.PrintReport) {
+            PrintMessage(DeadCode::FormatMemoryReport(report, m_ImageLayout.MemoryDepth));
+        }
+    }
+
+    void SourceCompiler::LinkSymbols() {
+        m_SymbolTable.Link(m_BitBuffer, [this](std::string problem) {
+            m_Diagnostics.Report(Severity::Error, std::nullopt, std::move(problem));
+        });
+    }
+
+    void SourceCompiler::LoadProgram(BitBuffer bitBuffer, SymbolTable symbolTable,
+                                     std::vector<DeadCode::Placement> placements) {
+        m_BitBuffer = std::move(bitBuffer);
+        m_SymbolTable = std::move(symbolTable);
+        m_Placements = std::move(placements);
     }
 
     void SourceCompiler::AlignStartAddress() {
-        while (m_BitBuffer.size() % m_StartAddressAlignment != 0) {
-            m_BitBuffer.push_back(false); // pad with zeros to align
+        size_t remainder = m_BitBuffer.Size() % m_StartAddressAlignment;
+        if (remainder != 0) {
+            m_BitBuffer.PushZeros(m_StartAddressAlignment - remainder); // pad with zeros to align
         }
     }
 
     std::string SourceCompiler::GenerateOutput() {
-        m_NameToFunctionMap->at("Compiler@Output")(*this);
+        Profiling::PhaseScope phase{m_Profiler.get(), "SourceCompiler::GenerateOutput"};
+        m_Dispatch->Output(*this);
 
         return m_Output.value();
     }
 
-    Compiler::Compiler(const std::filesystem::path &languageRootDir) {
-        YAML::Node config{};
+    void SourceCompiler::EmitOutput(Output::OutputFormat format, Output::OutputSink &sink,
+                                    std::string_view imageName) const {
+        Output::EmitImage(format, m_BitBuffer, m_ImageLayout, imageName, sink);
+    }
+
+    std::vector<std::filesystem::path> SourceCompiler::WriteOutputFiles(
+        std::span<const Output::OutputFormat> formats,
+        const std::filesystem::path &outputDir,
+        std::string_view stem) const {
+        Profiling::PhaseScope phase{m_Profiler.get(), "SourceCompiler::WriteOutputFiles"};
+        return Output::WriteImageFiles(formats, m_BitBuffer, m_ImageLayout, outputDir, stem);
+    }
+
+    std::filesystem::path GetSpecificationPath(const std::filesystem::path &languageRootDir) {
+        return languageRootDir / "Language_Specification.yaml";
+    }
+
+    YAML::Node LoadLanguageSpecification(const std::filesystem::path &languageRootDir) {
         try {
-            config = YAML::LoadFile((languageRootDir
-                                     / "Language_Specification.yaml").string());
+            return YAML::LoadFile(GetSpecificationPath(languageRootDir).string());
         } catch (std::exception &e) {
             throw std::runtime_error("Failed to load configuration file");
         }
+    }
 
-        m_SharedState = CreateSharedState();
-
-        m_StartAddressAlignment = ParseConfigOptional<size_t>(
-            config, "StartAddressAlignment").value_or(1);
-
+    std::filesystem::path GetLanguageLoadPath(const std::filesystem::path &languageRootDir, const YAML::Node &config) {
         std::string languageLoadPath =
-                ParseConfigOptional<std::string>(
+                Compiler::ParseConfigOptional<std::string>(
                     config, "LanguageLoadPath").value_or("LanguageInstructionLib");
+        return languageRootDir / languageLoadPath;
+    }
+
+    // A bundle shipped without its sources has nothing to be compared with, and is always current.
+    // Otherwise one stat per source decides, and only when one of them changed, e.g. was merely touched
+    // by a checkout, are the sources read and hashed.
+    bool IsBundleCurrent(const std::filesystem::path &languageRootDir, const YAML::Node &config,
+                         const Bundle::LanguageBundle &bundle) {
+        auto specificationPath = GetSpecificationPath(languageRootDir);
+        auto languageLoadPath = GetLanguageLoadPath(languageRootDir, config);
+        if (!std::filesystem::exists(specificationPath) || !std::filesystem::is_directory(languageLoadPath))
+            return true;
+        if (Bundle::SourcesUnchanged(languageRootDir, bundle.Sources))
+            return true;
+        return Bundle::ComputeSourceDigest(languageRootDir, specificationPath,
+                                           Bundle::CollectLuaSources(languageLoadPath)) == bundle.SourceDigest;
+    }
+
+    Compiler::Compiler(const std::filesystem::path &languageRootDir,
+                       std::shared_ptr<Profiling::Profiler> profiler)
+        : m_Profiler(std::move(profiler)) {
+        Profiling::PhaseScope phase{m_Profiler.get(), "Compiler::Compiler"};
+
+        // a prebuilt bundle replaces both the specification and the Lua sources
+        std::optional<Bundle::LanguageBundle> bundle;
+        YAML::Node config{};
+        {
+            Profiling::PhaseScope loadPhase{m_Profiler.get(), "Load language specification"};
+            auto bundlePath = languageRootDir / Bundle::BundleFileName;
+            bundle = Bundle::ReadBundle(bundlePath);
+            if (bundle) {
+                config = YAML::Load(bundle->Configuration);
+                if (!IsBundleCurrent(languageRootDir, config, *bundle)) {
+                    std::cerr << std::format("Warning: Language bundle '{}' does not match the language files "
+                                             "it was built from and is ignored, rebuild it with --build-bundle\n",
+                                             bundlePath.string());
+                    bundle.reset();
+                }
+            }
+            if (!bundle) {
+                config = LoadLanguageSpecification(languageRootDir);
+            }
+        }
+
+        {
+            Profiling::PhaseScope statePhase{m_Profiler.get(), "Create Lua state"};
+            m_SharedState = CreateSharedState();
+        }
 
-        InitParticularState(std::filesystem::directory_iterator(
-            languageRootDir / languageLoadPath));
+        InitOutputFormats(config);
 
-        InitNameToFunctionMap(config);
+        // by default every compile starts at a word boundary
+        m_StartAddressAlignment = ParseConfigOptional<size_t>(
+            config, "StartAddressAlignment").value_or(m_ImageLayout.WordWidth);
+
+        {
+            Profiling::PhaseScope scriptPhase{m_Profiler.get(), "Load Lua libraries"};
+            if (bundle) {
+                InitParticularState(*bundle);
+            } else {
+                InitParticularState(GetLanguageLoadPath(languageRootDir, config));
+            }
+        }
+
+        {
+            Profiling::PhaseScope dispatchPhase{m_Profiler.get(), "Build dispatch table"};
+            InitDispatchTable(config);
+        }
+
+        InitChunkingDirectives(config);
+        InitDeadCodeRules(config);
 
         m_SharedConfig = std::make_shared<YAML::Node>(std::move(config));
     }
 
     std::shared_ptr<sol::state> Compiler::CreateSharedState() {
         auto state = std::make_shared<sol::state>(sol::state{});
-        state->open_libraries(sol::lib::base, sol::lib::package, sol::lib::string, sol::lib::bit32);
+        state->open_libraries(sol::lib::base, sol::lib::package, sol::lib::string, sol::lib::table, sol::lib::bit32,
+                              sol::lib::ffi);
 
         SourceCompiler::AddLibToState(*state);
+        Ffi::AddLibToState(*state);
 
         return state;
     }
 
-    void Compiler::InitParticularState(std::filesystem::directory_iterator languageRootDir) {
-        for (const auto &luaSourceOrSubDir: languageRootDir) {
-            if (luaSourceOrSubDir.is_regular_file() && luaSourceOrSubDir.path().extension() == ".lua") {
-                m_SharedState->script_file(luaSourceOrSubDir.path().string());
-            } else if (luaSourceOrSubDir.is_directory()) {
-                // Recursively load Lua files in subdirectories
-                InitParticularState(std::filesystem::directory_iterator(luaSourceOrSubDir.path()));
+    void Compiler::InitParticularState(const std::filesystem::path &languageLoadPath) {
+        for (const auto &luaSource: Bundle::CollectLuaSources(languageLoadPath)) {
+            m_SharedState->script_file(luaSource.string());
+        }
+    }
+
+    void Compiler::InitParticularState(const Bundle::LanguageBundle &bundle) {
+        for (const auto &chunk: bundle.Chunks) {
+            m_SharedState->script(chunk.Bytecode, "@" + chunk.Name, sol::load_mode::binary);
+        }
+    }
+
+    std::filesystem::path Compiler::BuildBundle(const std::filesystem::path &languageRootDir) {
+        YAML::Node config = LoadLanguageSpecification(languageRootDir);
+        auto languageLoadPath = GetLanguageLoadPath(languageRootDir, config);
+        auto luaSources = Bundle::CollectLuaSources(languageLoadPath);
+
+        Bundle::LanguageBundle bundle;
+        bundle.Configuration = YAML::Dump(config);
+        auto specificationPath = GetSpecificationPath(languageRootDir);
+        bundle.SourceDigest = Bundle::ComputeSourceDigest(languageRootDir, specificationPath, luaSources);
+        bundle.Sources = Bundle::DescribeSources(languageRootDir, specificationPath, languageLoadPath, luaSources);
+
+        sol::state state;
+        for (const auto &luaSource: luaSources) {
+            auto name = std::filesystem::relative(luaSource, languageRootDir).generic_string();
+            sol::load_result loaded = state.load_file(luaSource.string());
+            if (!loaded.valid()) {
+                sol::error err = loaded;
+                throw std::runtime_error(std::format("Failed to compile '{}':\n{}", name, err.what()));
             }
+            sol::protected_function chunk = loaded;
+            sol::bytecode bytecode = chunk.dump();
+            bundle.Chunks.push_back({name, std::string(bytecode.as_string_view())});
         }
+
+        auto bundlePath = languageRootDir / Bundle::BundleFileName;
+        Bundle::WriteBundle(bundle, bundlePath);
+        return bundlePath;
     }
 
     void HandlePossibleLuaError(const auto &exception, const std::string &value) {
@@ -188,85 +455,129 @@ namespace Core {
         }
     }
 
-    void CheckFunctionValid(const sol::function &function) {
-        if (!function.valid()) {
-            throw Exceptions::CompilerImplementationError(
-                "Function not found in shared state, this is a compiler implementation error. Please report this to your compiler vendor.");
-        }
+    Exceptions::CompilerImplementationError MakeFunctionNotFoundError(const std::string &functionName) {
+        return Exceptions::CompilerImplementationError(
+            std::format(
+                "Function '{}' not found in shared state, this is a compiler implementation error. Please report this to your compiler vendor.",
+                functionName));
     }
 
-    void CheckResultValid(const auto &result, const std::string &functionName) {
-        if (!result.valid()) {
-            sol::error err = result;
-            throw Exceptions::CompilerImplementationError(
-                std::format(
-                    "Lua failed when executing function '{}', this is a compiler implementation error. Please report this to your compiler vendor:\n{}",
-                    functionName, err.what()));
+    sol::unsafe_function GetCheckedFunction(sol::state &state, const std::string &functionName) {
+        sol::object function = state[functionName];
+        if (function.get_type() != sol::type::function) {
+            throw MakeFunctionNotFoundError(functionName);
         }
+        return function.as<sol::unsafe_function>();
     }
 
-    void Compiler::InitNameToFunctionMap(const YAML::Node &config) {
-        std::unordered_map<std::string, std::string> instructionToLuaFunctionNameMap
-                = ParseConfigOrThrow<std::unordered_map<std::string, std::string>>(
-                    config, "InstructionToLuaFunctionNameMap");
+    // Handlers are only looked up and checked here, the call itself is unprotected and errors raised by
+    // Lua propagate as exceptions. A returned Diagnostic is recorded without unwinding.
+    DispatchTable::Handler Compiler::MakeLuaHandler(const std::string &functionName) const {
+        return InstrumentHandler(
+            functionName, "lua",
+            [functionName, function = GetCheckedFunction(*m_SharedState, functionName)](
+            SourceCompiler &compiler) {
+                    auto exception = function(compiler);
 
-        std::unordered_map<
-            std::string,
-            std::function<void(SourceCompiler &)>> instructionProcessorMap;
+                    if (exception.get_type() == sol::type::userdata) {
+                        if (auto diagnostic = exception.get<sol::optional<const Diagnostic &>>()) {
+                            compiler.GetDiagnostics().Report(*diagnostic);
+                            return;
+                        }
+                    }
+                    HandlePossibleLuaError(exception, functionName);
+                });
+    }
 
-        for (auto &&[key, value]: std::move(instructionToLuaFunctionNameMap)) {
-            instructionProcessorMap[Lib::ToLowerCase(key)] =
-                    [value, function = m_SharedState->get<sol::function>(value)](
-                SourceCompiler &compiler) {
-                        CheckFunctionValid(function);
+    // The Lua heap is sampled for native handlers as well, since they may still call into Lua (e.g. the
+    // register alias table). The state outlives the dispatch table, so a plain pointer is captured.
+    DispatchTable::Handler Compiler::InstrumentHandler(std::string_view name, std::string_view category,
+                                                       DispatchTable::Handler handler) const {
+        if (!m_Profiler) {
+            return handler;
+        }
 
-                        auto exception = function(compiler);
+        return [profiler = m_Profiler.get(), id = m_Profiler->RegisterHandler(name, category),
+                    state = m_SharedState.get(), handler = std::move(handler)](SourceCompiler &compiler) {
+                    Profiling::HandlerScope scope{*profiler, id, state->memory_used()};
+                    handler(compiler);
+                    scope.Stop(state->memory_used());
+                };
+    }
 
-                        CheckResultValid(exception, value);
+    void Compiler::InitDispatchTable(const YAML::Node &config) {
+        std::unordered_map<std::string, std::string> instructionToLuaFunctionNameMap
+                = ParseConfigOrThrow<std::unordered_map<std::string, std::string>>(
+                    config, "InstructionToLuaFunctionNameMap");
+        auto encodingTable = Encoder::ParseEncodingTable(config);
 
-                        HandlePossibleLuaError(exception, value);
-                    };
+        std::vector<std::string> mnemonics;
+        for (const auto &[mnemonic, functionName]: instructionToLuaFunctionNameMap) {
+            mnemonics.push_back(mnemonic);
+        }
+        if (encodingTable) {
+            for (const auto &encoding: encodingTable->Instructions) {
+                mnemonics.push_back(encoding.Mnemonic);
+            }
         }
 
-        std::string NonInstructionHandlerName =
-                ParseConfigOptional<std::string>(config, "NonInstructionHandlerName")
-                .value_or("ProcessNonInstruction");
-
-        instructionProcessorMap["Compiler@NonInstructionHandler"] =
-                [NonInstructionHandlerName, function = m_SharedState->get<sol::function>(NonInstructionHandlerName)](
-            SourceCompiler &compiler) {
-                    CheckFunctionValid(function);
-
-                    auto exception = function(compiler);
+        m_Dispatch = std::make_shared<DispatchTable>();
+        m_Dispatch->Mnemonics = MnemonicTable(std::move(mnemonics));
+        m_Dispatch->Instructions.resize(m_Dispatch->Mnemonics.Size());
 
-                    CheckResultValid(exception, NonInstructionHandlerName);
+        InitNativeEncoders(std::move(encodingTable));
 
-                    HandlePossibleLuaError(exception, NonInstructionHandlerName);
-                };
+        for (const auto &[mnemonic, functionName]: instructionToLuaFunctionNameMap) {
+            auto &handler = m_Dispatch->Instructions[*m_Dispatch->Mnemonics.Find(mnemonic)];
+            if (!handler) {
+                handler = MakeLuaHandler(functionName);
+            }
+        }
 
-        m_NameToFunctionMap =
-                std::make_shared<std::unordered_map<
-                    std::string,
-                    std::function<void(SourceCompiler &)>>>(std::move(instructionProcessorMap));
+        m_Dispatch->NonInstruction = MakeLuaHandler(
+            ParseConfigOptional<std::string>(config, "NonInstructionHandlerName")
+            .value_or("ProcessNonInstruction"));
 
         InitLinker(config);
         InitEventFunctions(config);
         InitOutputFunction(config);
     }
 
+    void Compiler::InitNativeEncoders(std::optional<Encoder::EncodingTable> table) {
+        if (!table) {
+            return;
+        }
+
+        // instructions with a declarative encoding skip their Lua handler, the rest keep it as fallback
+        auto sharedTable = std::make_shared<const Encoder::EncodingTable>(std::move(*table));
+        for (const auto &encoding: sharedTable->Instructions) {
+            m_Dispatch->Instructions[*m_Dispatch->Mnemonics.Find(encoding.Mnemonic)] = InstrumentHandler(
+                encoding.Mnemonic + " (native)", "native",
+                [sharedTable, &encoding](SourceCompiler &compiler) {
+                    Encoder::Encode(*sharedTable, encoding, compiler);
+                });
+        }
+    }
+
     void Compiler::InitOutputFunction(const YAML::Node &config) {
         auto outputFunctionName = ParseConfigOptional<std::string>(config, "OutputFunctionName")
                 .value_or("GenerateOutput");
 
-        (*m_NameToFunctionMap)["Compiler@Output"] =
-                [outputFunctionName, function = m_SharedState->get<sol::function>(outputFunctionName)](
-            SourceCompiler &compiler) {
-                    CheckFunctionValid(function);
+        // with native output formats the Lua output function is optional until something calls it
+        sol::object function = (*m_SharedState)[outputFunctionName];
+        if (function.get_type() != sol::type::function && !m_OutputFormats.empty()) {
+            m_Dispatch->Output = [outputFunctionName](SourceCompiler &) {
+                throw MakeFunctionNotFoundError(outputFunctionName);
+            };
+            return;
+        }
 
+        m_Dispatch->Output = InstrumentHandler(
+            outputFunctionName, "lua",
+                [outputFunctionName, function = GetCheckedFunction(*m_SharedState, outputFunctionName)](
+            SourceCompiler &compiler) {
                     auto result = function(compiler);
 
-                    CheckResultValid(result, outputFunctionName);
-
                     if (result.get_type() == sol::type::string) {
                         compiler.m_Output = result.get<std::string>();
                         return;
@@ -278,93 +589,142 @@ namespace Core {
                         std::format(
                             "Output function '{}' did not return a string, this is probably a bug in the implementation. Please report this issue to your compiler vendor.",
                             outputFunctionName));
-                };
+                });
     }
 
-    void Compiler::InitLinker(const YAML::Node &config) {
-        auto linkerName = ParseConfigOptional<std::string>(config, "LinkerName")
-                .value_or("Linker");
-
-        (*m_NameToFunctionMap)["Compiler@Linker"] =
-                [linkerName, function = m_SharedState->get<sol::function>(linkerName)](
-            SourceCompiler &compiler) {
-                    CheckFunctionValid(function);
+    void Compiler::InitOutputFormats(const YAML::Node &config) {
+        m_ImageLayout.WordWidth = ParseConfigOptional<size_t>(config, "WordWidth")
+                .value_or(m_ImageLayout.WordWidth);
+        m_ImageLayout.MemoryDepth = ParseConfigOptional<size_t>(config, "MemoryDepth")
+                .value_or(1024);
 
-                    auto exception = function(compiler);
+        if (m_ImageLayout.WordWidth == 0 || m_ImageLayout.WordWidth > BitBuffer::WordBits) {
+            throw std::runtime_error(std::format("Unsupported word width: {}", m_ImageLayout.WordWidth));
+        }
+        if (m_ImageLayout.MemoryDepth == 0) {
+            throw std::runtime_error("Unsupported memory depth: 0");
+        }
+        // by default just wide enough to address every word
+        m_ImageLayout.AddressWidth = ParseConfigOptional<size_t>(config, "AddressWidth")
+                .value_or(std::max<size_t>(std::bit_width(m_ImageLayout.MemoryDepth - 1), 1));
+        if (m_ImageLayout.AddressWidth == 0 || m_ImageLayout.AddressWidth >= BitBuffer::WordBits ||
+            ((m_ImageLayout.MemoryDepth - 1) >> m_ImageLayout.AddressWidth) != 0) {
+            throw std::runtime_error(std::format("A memory depth of {} does not fit an address width of {}",
+                                                 m_ImageLayout.MemoryDepth, m_ImageLayout.AddressWidth));
+        }
 
-                    CheckResultValid(exception, linkerName);
+        auto formatNames = ParseConfigOptional<std::vector<std::string>>(config, "OutputFormat");
+        if (!formatNames) {
+            if (auto single = ParseConfigOptional<std::string>(config, "OutputFormat")) {
+                formatNames = std::vector{*single};
+            }
+        }
 
-                    HandlePossibleLuaError(exception, linkerName);
-                };
+        for (const auto &name: formatNames.value_or(std::vector<std::string>{})) {
+            auto format = Output::ParseOutputFormat(name);
+            if (!format) {
+                throw std::runtime_error(std::format("Unknown output format '{}' in configuration", name));
+            }
+            m_OutputFormats.push_back(*format);
+        }
     }
 
-    void Compiler::InitEventFunctions(const YAML::Node &config) {
-        auto BeforeCompileFunctionName =
-                ParseConfigOptional<std::string>(config, "BeforeCompileFunctionName");
-
-        auto BeforeLinkFunctionName =
-                ParseConfigOptional<std::string>(config, "BeforeLinkFunctionName");
-
-        auto AfterLinkFunctionName =
-                ParseConfigOptional<std::string>(config, "AfterLinkFunctionName");
-
-        if (BeforeCompileFunctionName) {
-            (*m_NameToFunctionMap)["Compiler@BeforeCompile"] =
-                    [function = m_SharedState->get<sol::function>(*BeforeCompileFunctionName), BeforeCompileFunctionName
-                    ](
-                SourceCompiler &compiler) {
-                        CheckFunctionValid(function);
-
-                        auto exception = function(compiler);
+    void Compiler::InitDeadCodeRules(const YAML::Node &config) {
+        if (!config["DeadCodeElimination"]) {
+            return;
+        }
 
-                        CheckResultValid(exception, *BeforeCompileFunctionName);
+        DeadCode::Rules rules;
+        try {
+            for (const auto &terminator: config["DeadCodeElimination"]["Terminators"]) {
+                rules.Terminators.push_back({terminator["Mask"].as<uint64_t>(), terminator["Value"].as<uint64_t>()});
+            }
+        } catch (const YAML::Exception &e) {
+            throw std::runtime_error("Error parsing configuration: " + std::string(e.what()));
+        }
 
-                        HandlePossibleLuaError(exception, *BeforeCompileFunctionName);
-                    };
-        } else {
-            (*m_NameToFunctionMap)["Compiler@BeforeCompile"] = [](SourceCompiler &) {};
+        for (const auto &mnemonic: ParseConfigOptional<std::vector<std::string>>(
+                 config, "DeadCodeElimination", "PlacementDirectives").value_or(std::vector<std::string>{})) {
+            auto opcode = m_Dispatch->Mnemonics.Find(mnemonic);
+            if (!opcode) {
+                throw std::runtime_error(std::format(
+                    "DeadCodeElimination.PlacementDirectives names '{}', which is not an instruction", mnemonic));
+            }
+            rules.PlacementDirectives.push_back(*opcode);
         }
 
-        if (BeforeLinkFunctionName) {
-            (*m_NameToFunctionMap)["Compiler@BeforeLink"] =
-                    [function = m_SharedState->get<sol::function>(*BeforeLinkFunctionName), BeforeLinkFunctionName](
-                SourceCompiler &compiler) {
-                        CheckFunctionValid(function);
+        m_Dispatch->DeadCodeRules = std::move(rules);
+    }
 
-                        auto exception = function(compiler);
+    void Compiler::InitChunkingDirectives(const YAML::Node &config) {
+        if (!config["ParallelAssembly"]) {
+            return;
+        }
 
-                        CheckResultValid(exception, *BeforeLinkFunctionName);
+        auto resolve = [&](std::string_view key) {
+            std::vector<OpcodeId> directives;
+            for (const auto &mnemonic: ParseConfigOptional<std::vector<std::string>>(config, "ParallelAssembly", key)
+                 .value_or(std::vector<std::string>{})) {
+                auto opcode = m_Dispatch->Mnemonics.Find(mnemonic);
+                if (!opcode) {
+                    throw std::runtime_error(
+                        std::format("ParallelAssembly.{} names '{}', which is not an instruction", key, mnemonic));
+                }
+                directives.push_back(*opcode);
+            }
+            return directives;
+        };
 
-                        HandlePossibleLuaError(exception, *BeforeLinkFunctionName);
-                    };
-        } else {
-            (*m_NameToFunctionMap)["Compiler@BeforeLink"] = [](SourceCompiler &) {};
-        }
+        m_ChunkingDirectives = ChunkingDirectives{resolve("StateDirectives"), resolve("PlacementDirectives")};
+    }
 
-        if (AfterLinkFunctionName) {
-            (*m_NameToFunctionMap)["Compiler@AfterLink"] =
-                    [function = m_SharedState->get<sol::function>(*AfterLinkFunctionName), AfterLinkFunctionName](
-                SourceCompiler &compiler) {
-                        CheckFunctionValid(function);
+    void Compiler::InitLinker(const YAML::Node &config) {
+        m_Dispatch->Linker = MakeLuaHandler(
+            ParseConfigOptional<std::string>(config, "LinkerName").value_or("Linker"));
+    }
 
-                        auto exception = function(compiler);
+    void Compiler::InitEventFunctions(const YAML::Node &config) {
+        auto makeEventHandler = [&](std::string_view key) -> DispatchTable::Handler {
+            if (auto functionName = ParseConfigOptional<std::string>(config, key)) {
+                return MakeLuaHandler(*functionName);
+            }
+            return [](SourceCompiler &) {};
+        };
 
-                        CheckResultValid(exception, *AfterLinkFunctionName);
+        m_Dispatch->BeforeCompile = makeEventHandler("BeforeCompileFunctionName");
+        m_Dispatch->BeforeLink = makeEventHandler("BeforeLinkFunctionName");
+        m_Dispatch->AfterLink = makeEventHandler("AfterLinkFunctionName");
+    }
 
-                        HandlePossibleLuaError(exception, *AfterLinkFunctionName);
-                    };
-        } else {
-            (*m_NameToFunctionMap)["Compiler@AfterLink"] = [](SourceCompiler &) {};
-        }
+    void Compiler::SetPrintHandler(std::function<void(std::string_view)> handler) {
+        m_SharedState->set_function(
+            "print",
+            [handler = std::move(handler)](sol::variadic_args args, sol::this_state state) {
+                sol::state_view lua(state);
+                sol::function toString = lua["tostring"];
+                std::string line;
+                for (auto arg: args) {
+                    if (!line.empty())
+                        line += '\t';
+                    line += toString(arg).get<std::string>();
+                }
+                handler(line);
+            });
     }
 
     SourceCompiler Compiler::CreateSourceCompiler(std::string source) const {
+        return CreateSourceCompiler(SourceBuffer::FromString(std::move(source)));
+    }
+
+    SourceCompiler Compiler::CreateSourceCompiler(std::shared_ptr<const SourceBuffer> source) const {
         return SourceCompiler{
             m_SharedState,
-            m_NameToFunctionMap,
+            m_Dispatch,
             std::move(source),
             m_StartAddressAlignment,
-            m_SharedConfig
+            m_ImageLayout,
+            m_SharedConfig,
+            m_Profiler
         };
     }
 }
@@ -6,30 +6,57 @@ import std;
 import Vendor.yaml;
 import Vendor.sol;
 import Core.Parser;
+import Core.BitBuffer;
+import Core.Output;
+import Core.Bundle;
+import Core.Encoder;
+import Core.MnemonicTable;
+import Core.SymbolTable;
+import Core.Profiler;
+import Core.SourceBuffer;
 import Core.Exceptions;
+import Core.Diagnostics;
+import Core.DeadCode;
 
 namespace Core {
     export class SourceCompiler;
     export class Compiler;
 
+    // Every handler a SourceCompiler calls, resolved once when the Compiler is constructed. Instruction
+    // handlers are indexed by the opcode ID the mnemonic table interns for them.
+    struct DispatchTable {
+        using Handler = std::function<void(SourceCompiler &)>;
+
+        MnemonicTable Mnemonics;
+        std::vector<Handler> Instructions;
+        Handler NonInstruction;
+        Handler BeforeCompile;
+        Handler BeforeLink;
+        Handler Linker;
+        Handler AfterLink;
+        Handler Output;
+        std::optional<DeadCode::Rules> DeadCodeRules; // its placement directives are recorded as they compile
+    };
+
     class SourceCompiler {
     private:
         friend class Compiler;
 
     public:
         SourceCompiler(std::shared_ptr<sol::state> sharedState,
-                       std::shared_ptr<const std::unordered_map<std::string,
-                           std::function<
-                               void(SourceCompiler &)
-                           >>> instructionProcessorMap,
-                       std::string source,
+                       std::shared_ptr<const DispatchTable> dispatchTable,
+                       std::shared_ptr<const SourceBuffer> source,
                        size_t startAddressAlignment,
-                       std::shared_ptr<YAML::Node> sharedConfig)
+                       Output::ImageLayout imageLayout,
+                       std::shared_ptr<YAML::Node> sharedConfig,
+                       std::shared_ptr<Profiling::Profiler> profiler = nullptr)
             : m_SharedState(std::move(sharedState)),
-              m_NameToFunctionMap(std::move(instructionProcessorMap)),
+              m_Dispatch(std::move(dispatchTable)),
               m_TokenStream(std::move(source)),
               m_StartAddressAlignment(startAddressAlignment),
-              m_SharedConfig(std::move(sharedConfig)) {
+              m_ImageLayout(imageLayout),
+              m_SharedConfig(std::move(sharedConfig)),
+              m_Profiler(std::move(profiler)) {
             m_CompilerContext = m_SharedState->create_table();
             m_LinkerContext = m_SharedState->create_table();
         }
@@ -49,8 +76,36 @@ namespace Core {
             return m_TokenStream;
         }
 
+        SymbolTable &GetSymbolTable() {
+            return m_SymbolTable;
+        }
+
+        DiagnosticSink &GetDiagnostics() {
+            return m_Diagnostics;
+        }
+
+        // Where placement directives put code, in words, recorded if the language has DeadCodeRules.
+        std::vector<DeadCode::Placement> &GetPlacements() {
+            return m_Placements;
+        }
+
+        // Makes Link remove unreachable code and/or print a memory report before linking.
+        void SetDeadCodeOptions(DeadCode::Options options) {
+            m_DeadCodeOptions = std::move(options);
+        }
+
+        // Records a problem at the current token without ending the handler, as the Diagnostic a Lua
+        // handler returns does.
+        void ReportError(std::string message);
+
+        void ReportWarning(std::string message);
+
+        // Throws a DiagnosticError with everything reported so far if any of it is an error, otherwise
+        // prints the warnings. The sink is empty afterwards either way.
+        void ReportDiagnostics();
+
     public:
-        std::vector<uint8_t> &GetBitBuffer() {
+        BitBuffer &GetBitBuffer() {
             return m_BitBuffer;
         }
 
@@ -66,45 +121,111 @@ namespace Core {
 
         size_t GetBitBufferSize() const;
 
+        // Used by the native instruction encoders, these mirror Lib.ParseRegister, the relocation requests of
+        // Util.WriteDummyAddress and Util.WriteDummyConstantData, and Lua's print.
+        std::optional<size_t> ResolveRegister(const Encoder::RegisterSpec &spec, std::string_view token) const;
+
+        void RequestLink(RelocationKind kind, std::string_view symbol, size_t start, size_t bits);
+
+        void PrintMessage(std::string_view message) const;
+
+        // Compiles one statement. An error in it is recorded and the rest of its line skipped, so the
+        // next call goes on with the next line.
         bool CompileOneLine();
 
+        // Runs the language's before-compile event, CompileAll starts with it.
+        void BeginCompile();
+
+        // Continues compiling with the given part of the source, the rest of the compile state is kept.
+        void SetSourceRange(const SourceRange &range);
+
+        // Compiles every line, errors are collected rather than thrown, see ReportDiagnostics.
         void CompileAll();
 
+        // Runs the language's linker and reports every diagnostic of the compile and the link together.
+        // Dead code is eliminated first if the DeadCodeOptions ask for it, see DeadCode::EliminateDeadCode.
         void Link();
 
+        // Resolves every relocation in the symbol table against the bit buffer, see SymbolTable::Link.
+        void LinkSymbols();
+
+        // Takes the program of already compiled objects in place of compiling a source, see
+        // Object::MergeObjects. Link and output then run as usual.
+        void LoadProgram(BitBuffer bitBuffer, SymbolTable symbolTable,
+                         std::vector<DeadCode::Placement> placements = {});
+
         void AlignStartAddress();
 
         std::string GenerateOutput();
 
+        void EmitOutput(Output::OutputFormat format, Output::OutputSink &sink, std::string_view imageName) const;
+
+        std::vector<std::filesystem::path> WriteOutputFiles(std::span<const Output::OutputFormat> formats,
+                                                            const std::filesystem::path &outputDir,
+                                                            std::string_view stem) const;
+
+        const Output::ImageLayout &GetImageLayout() const {
+            return m_ImageLayout;
+        }
+
     private:
+        [[noreturn]] void FailStatement(std::string message);
+
+        void SkipFailedStatement(const SourceLocation &statementBegin);
+
+        void EliminateDeadCode();
+
         std::shared_ptr<sol::state> m_SharedState;
 
-        std::shared_ptr<const std::unordered_map<
-            std::string,
-            std::function<void(SourceCompiler &)>>> m_NameToFunctionMap;
+        std::shared_ptr<const DispatchTable> m_Dispatch;
 
         sol::table m_CompilerContext;
         sol::table m_LinkerContext;
         TokenStream m_TokenStream;
+        SymbolTable m_SymbolTable;
+        DiagnosticSink m_Diagnostics;
+        std::vector<DeadCode::Placement> m_Placements;
+        DeadCode::Options m_DeadCodeOptions;
 
-        std::vector<uint8_t> m_BitBuffer;
+        BitBuffer m_BitBuffer;
         size_t m_StartAddressAlignment; // default alignment
+        Output::ImageLayout m_ImageLayout;
         std::shared_ptr<YAML::Node> m_SharedConfig;
         std::optional<std::string> m_Output;
+        std::shared_ptr<Profiling::Profiler> m_Profiler;
+    };
+
+    // Directives whose effect reaches past their own statement, from 'ParallelAssembly' in the language
+    // specification. Chunked compilation needs them to split a source, see Chunked::CompileChunked.
+    export struct ChunkingDirectives {
+        std::vector<OpcodeId> State;     // change how later lines are encoded, replayed before every later chunk
+        std::vector<OpcodeId> Placement; // set the absolute position, always start a chunk
     };
 
     class Compiler {
     public:
-        Compiler(const std::filesystem::path &languageRootDir);
+        // With a profiler, construction phases, SourceCompiler phases and every dispatched handler are timed.
+        Compiler(const std::filesystem::path &languageRootDir,
+                 std::shared_ptr<Profiling::Profiler> profiler = nullptr);
 
         friend class SourceCompiler;
 
     private:
         static std::shared_ptr<sol::state> CreateSharedState();
 
-        void InitParticularState(std::filesystem::directory_iterator languageRootDir);
+        void InitParticularState(const std::filesystem::path &languageLoadPath);
+
+        void InitParticularState(const Bundle::LanguageBundle &bundle);
+
+        DispatchTable::Handler MakeLuaHandler(const std::string &functionName) const;
+
+        // Returns the handler unchanged unless profiling, then wraps it to record its calls under 'name'.
+        DispatchTable::Handler InstrumentHandler(std::string_view name, std::string_view category,
+                                                 DispatchTable::Handler handler) const;
+
+        void InitDispatchTable(const YAML::Node &config);
 
-        void InitNameToFunctionMap(const YAML::Node &config);
+        void InitNativeEncoders(std::optional<Encoder::EncodingTable> table);
 
         void InitLinker(const YAML::Node &config);
 
@@ -112,6 +233,12 @@ namespace Core {
 
         void InitOutputFunction(const YAML::Node &config);
 
+        void InitOutputFormats(const YAML::Node &config);
+
+        void InitChunkingDirectives(const YAML::Node &config);
+
+        void InitDeadCodeRules(const YAML::Node &config);
+
     public:
         template<typename ExpectedType>
         static ExpectedType ParseConfig(const YAML::Node &config,
@@ -128,15 +255,53 @@ namespace Core {
 
         [[nodiscard]] SourceCompiler CreateSourceCompiler(std::string) const;
 
+        // Compiles the buffer in place, it stays alive as long as the SourceCompiler does.
+        [[nodiscard]] SourceCompiler CreateSourceCompiler(std::shared_ptr<const SourceBuffer> source) const;
+
+        // Precompiles the language libraries and specification into '<languageRootDir>/Language.bundle',
+        // which later Compilers load instead of the sources. Returns the path of the bundle.
+        static std::filesystem::path BuildBundle(const std::filesystem::path &languageRootDir);
+
+        // Replaces Lua's global 'print', e.g. to keep library output off a stdout protocol channel.
+        void SetPrintHandler(std::function<void(std::string_view)> handler);
+
+        // Formats selected by 'OutputFormat' in the language specification, empty if output is left to Lua.
+        [[nodiscard]] const std::vector<Output::OutputFormat> &GetOutputFormats() const {
+            return m_OutputFormats;
+        }
+
+        [[nodiscard]] Profiling::Profiler *GetProfiler() const {
+            return m_Profiler.get();
+        }
+
+        [[nodiscard]] const std::shared_ptr<Profiling::Profiler> &GetSharedProfiler() const {
+            return m_Profiler;
+        }
+
+        [[nodiscard]] const MnemonicTable &GetMnemonics() const {
+            return m_Dispatch->Mnemonics;
+        }
+
+        // Without a 'ParallelAssembly' section a language is always compiled sequentially.
+        [[nodiscard]] const std::optional<ChunkingDirectives> &GetChunkingDirectives() const {
+            return m_ChunkingDirectives;
+        }
+
+        [[nodiscard]] const Output::ImageLayout &GetImageLayout() const {
+            return m_ImageLayout;
+        }
+
     private:
+        std::shared_ptr<Profiling::Profiler> m_Profiler;
+
         std::shared_ptr<sol::state> m_SharedState;
 
-        std::shared_ptr<std::unordered_map<
-            std::string,
-            std::function<void(SourceCompiler &)>>>
-        m_NameToFunctionMap;
+        std::shared_ptr<DispatchTable> m_Dispatch;
 
         size_t m_StartAddressAlignment; // default alignment
+        Output::ImageLayout m_ImageLayout;
+        std::vector<Output::OutputFormat> m_OutputFormats;
+        std::optional<ChunkingDirectives> m_ChunkingDirectives;
         std::shared_ptr<YAML::Node> m_SharedConfig;
     };
 
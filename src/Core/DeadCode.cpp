@@ -0,0 +1,258 @@
+module Core.DeadCode;
+
+import std;
+import Core.BitBuffer;
+import Core.SymbolTable;
+import Core.Exceptions;
+
+namespace Core::DeadCode {
+    namespace {
+        struct BlockInfo {
+            uint64_t Begin = 0;
+            uint64_t End = 0;
+            bool Padding = false; // inside a placement's padding, never kept as it is written anew
+            bool Placed = false;  // starts at placed code
+            bool Reachable = false;
+            std::vector<std::string_view> Labels;
+            std::vector<size_t> Successors;
+            uint64_t NewBegin = 0;
+        };
+
+        class BlockMap {
+        public:
+            BlockMap(std::vector<uint64_t> starts, uint64_t wordCount) : m_Starts(std::move(starts)) {
+                std::ranges::sort(m_Starts);
+                auto [first, last] = std::ranges::unique(m_Starts);
+                m_Starts.erase(first, last);
+                m_Blocks.resize(m_Starts.size());
+                for (size_t i = 0; i < m_Starts.size(); ++i) {
+                    m_Blocks[i].Begin = m_Starts[i];
+                    m_Blocks[i].End = i + 1 < m_Starts.size() ? m_Starts[i + 1] : wordCount;
+                }
+            }
+
+            // The block a word lies in, blocks cover [0, wordCount) without gaps.
+            [[nodiscard]] size_t Find(uint64_t word) const {
+                return static_cast<size_t>(std::ranges::upper_bound(m_Starts, word) - m_Starts.begin()) - 1;
+            }
+
+            std::vector<BlockInfo> &GetBlocks() {
+                return m_Blocks;
+            }
+
+        private:
+            std::vector<uint64_t> m_Starts;
+            std::vector<BlockInfo> m_Blocks;
+        };
+
+        bool IsTerminator(const Rules &rules, uint64_t word) {
+            return std::ranges::any_of(rules.Terminators, [&](const WordPattern &pattern) {
+                return (word & pattern.Mask) == pattern.Value;
+            });
+        }
+
+        std::string GetBlockName(const BlockInfo &block) {
+            if (!block.Labels.empty()) {
+                std::string name;
+                for (auto label: block.Labels) {
+                    if (!name.empty())
+                        name += ", ";
+                    name += label;
+                }
+                return name;
+            }
+            return block.Begin == 0 ? "(start)" : "(placed)";
+        }
+
+        void MarkReachable(std::vector<BlockInfo> &blocks, std::vector<size_t> roots) {
+            while (!roots.empty()) {
+                size_t index = roots.back();
+                roots.pop_back();
+                if (blocks[index].Reachable || blocks[index].Padding)
+                    continue;
+                blocks[index].Reachable = true;
+                roots.insert(roots.end(), blocks[index].Successors.begin(), blocks[index].Successors.end());
+            }
+        }
+
+        // Writes the kept blocks one after another, padding up to every placement as its directive did.
+        template<typename Width>
+        BitBuffer Compact(const BitBuffer &bitBuffer, Width wordWidth, std::vector<BlockInfo> &blocks,
+                          std::vector<Placement> &placements) {
+            BitBuffer compacted;
+            compacted.Reserve(bitBuffer.Size());
+            std::vector<Placement> movedPlacements;
+            auto placement = placements.begin();
+
+            for (auto &block: blocks) {
+                uint64_t position = compacted.Size() / wordWidth;
+                while (placement != placements.end() && placement->To <= block.Begin) {
+                    compacted.PushZeros((placement->To - position) * wordWidth);
+                    movedPlacements.push_back({position, placement->To});
+                    position = placement->To;
+                    ++placement;
+                }
+
+                block.NewBegin = position;
+                if (block.Padding || !block.Reachable)
+                    continue;
+                for (uint64_t word = block.Begin; word < block.End; ++word) {
+                    compacted.PushBits(bitBuffer.ReadWord(word, wordWidth), wordWidth);
+                }
+            }
+
+            placements = std::move(movedPlacements); // a placement with nothing after it only padded the end
+            return compacted;
+        }
+
+        // Interns the names in the same order, so symbol IDs are kept.
+        SymbolTable MoveSymbols(const SymbolTable &symbolTable, size_t wordWidth, const BlockMap &map,
+                                const std::vector<BlockInfo> &blocks, uint64_t wordCount, uint64_t newWordCount) {
+            SymbolTable moved;
+            for (SymbolId id = 0; id < symbolTable.GetSymbolCount(); ++id) {
+                const auto &name = symbolTable.GetName(id);
+                const auto &definition = symbolTable.GetDefinition(id);
+                moved.Intern(name);
+                if (definition.Value) {
+                    moved.DefineConstant(name, *definition.Value);
+                }
+                if (!definition.Address)
+                    continue;
+                if (*definition.Address >= wordCount) {
+                    moved.DefineLabel(name, newWordCount); // at the very end
+                    continue;
+                }
+                const auto &block = blocks[map.Find(*definition.Address)];
+                if (block.Padding) {
+                    moved.DefineLabel(name, block.NewBegin);
+                } else if (block.Reachable) {
+                    moved.DefineLabel(name, block.NewBegin + (*definition.Address - block.Begin));
+                }
+            }
+
+            for (const auto &relocation: symbolTable.GetRelocations()) {
+                const auto &block = blocks[map.Find(relocation.Offset / wordWidth)];
+                if (!block.Reachable)
+                    continue;
+                uint64_t offset = relocation.Offset - block.Begin * wordWidth + block.NewBegin * wordWidth;
+                moved.AddRelocation(relocation.Kind, relocation.Symbol, offset, relocation.Width);
+            }
+            return moved;
+        }
+    }
+
+    MemoryReport EliminateDeadCode(BitBuffer &bitBuffer, SymbolTable &symbolTable,
+                                   std::vector<Placement> &placements, size_t wordWidth,
+                                   const Rules &rules, const Options &options) {
+        if (wordWidth == 0 || wordWidth > BitBuffer::WordBits || bitBuffer.Size() % wordWidth != 0) {
+            throw Exceptions::CompilerImplementationError(
+                std::format("A program of {} bits cannot be split into {}-bit words", bitBuffer.Size(), wordWidth));
+        }
+        uint64_t wordCount = bitBuffer.Size() / wordWidth;
+        MemoryReport report;
+        if (wordCount == 0)
+            return report;
+
+        std::ranges::sort(placements, {}, &Placement::To);
+        std::vector<uint64_t> starts{0};
+        for (SymbolId id = 0; id < symbolTable.GetSymbolCount(); ++id) {
+            auto address = symbolTable.GetDefinition(id).Address;
+            if (address && *address < wordCount) {
+                starts.push_back(*address);
+            }
+        }
+        for (const auto &placement: placements) {
+            for (auto start: {placement.From, placement.To}) {
+                if (start < wordCount) {
+                    starts.push_back(start);
+                }
+            }
+        }
+
+        BlockMap map(std::move(starts), wordCount);
+        auto &blocks = map.GetBlocks();
+        for (const auto &placement: placements) {
+            for (auto &block: blocks) {
+                block.Padding |= block.Begin >= placement.From && block.Begin < placement.To;
+                block.Placed |= block.Begin == placement.To;
+            }
+        }
+        for (SymbolId id = 0; id < symbolTable.GetSymbolCount(); ++id) {
+            auto address = symbolTable.GetDefinition(id).Address;
+            if (address && *address < wordCount) {
+                blocks[map.Find(*address)].Labels.push_back(symbolTable.GetName(id));
+            }
+        }
+
+        for (const auto &relocation: symbolTable.GetRelocations()) {
+            if (relocation.Kind != RelocationKind::Address)
+                continue;
+            auto target = symbolTable.GetDefinition(relocation.Symbol).Address;
+            if (!target || *target >= wordCount)
+                continue; // left for the link to report
+            blocks[map.Find(relocation.Offset / wordWidth)].Successors.push_back(map.Find(*target));
+        }
+        for (size_t i = 0; i + 1 < blocks.size(); ++i) {
+            if (!IsTerminator(rules, bitBuffer.ReadWord(blocks[i].End - 1, wordWidth))) {
+                blocks[i].Successors.push_back(i + 1);
+            }
+        }
+
+        std::vector<size_t> roots{0};
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (blocks[i].Placed) {
+                roots.push_back(i);
+            }
+        }
+        for (const auto &label: options.KeepLabels) {
+            auto address = symbolTable.GetLabel(label);
+            if (!address) {
+                throw Exceptions::LinkError(std::format("Label '{}' to keep is not defined", label));
+            }
+            if (*address < wordCount) {
+                roots.push_back(map.Find(*address));
+            }
+        }
+        MarkReachable(blocks, std::move(roots));
+
+        for (const auto &block: blocks) {
+            if (block.Padding)
+                continue;
+            uint64_t size = block.End - block.Begin;
+            report.Blocks.push_back({GetBlockName(block), block.Begin, size, block.Reachable});
+            report.UsedWords += size;
+            if (!block.Reachable) {
+                report.RemovedWords += size;
+            }
+        }
+
+        if (!options.RemoveUnused || report.RemovedWords == 0) {
+            report.RemovedWords = 0;
+            report.ImageWords = wordCount;
+            return report;
+        }
+
+        auto compacted = DispatchWordWidth(wordWidth, [&](auto width) {
+            return Compact(bitBuffer, width, blocks, placements);
+        });
+        symbolTable = MoveSymbols(symbolTable, wordWidth, map, blocks, wordCount, compacted.Size() / wordWidth);
+        bitBuffer = std::move(compacted);
+        report.ImageWords = bitBuffer.Size() / wordWidth;
+        return report;
+    }
+
+    std::string FormatMemoryReport(const MemoryReport &report, size_t memoryDepth) {
+        uint64_t usedAfter = report.UsedWords - report.RemovedWords;
+        std::string text = std::format("Program memory: {} of {} words used ({:.1f}%)", usedAfter, memoryDepth,
+                                       memoryDepth == 0 ? 0.0 : 100.0 * usedAfter / memoryDepth);
+        if (report.RemovedWords != 0) {
+            text += std::format(", {} unused words removed", report.RemovedWords);
+        }
+        text += "\n  Address  Words  Label";
+        for (const auto &block: report.Blocks) {
+            text += std::format("\n  {:05X}    {:>5}  {}{}", block.Address, block.Size, block.Name,
+                                block.Reachable ? "" : report.RemovedWords != 0 ? " (removed)" : " (unused)");
+        }
+        return text;
+    }
+}
@@ -0,0 +1,62 @@
+export module Core.DeadCode;
+
+import std;
+import Core.BitBuffer;
+import Core.SymbolTable;
+import Core.MnemonicTable;
+
+namespace Core::DeadCode {
+    // Matches a word if (word & Mask) == Value.
+    export struct WordPattern {
+        uint64_t Mask = 0;
+        uint64_t Value = 0;
+    };
+
+    // From 'DeadCodeElimination' in the language specification.
+    export struct Rules {
+        std::vector<WordPattern> Terminators;      // words execution never continues after, e.g. an unconditional jump
+        std::vector<OpcodeId> PlacementDirectives; // set the absolute position, the code they place stays there
+    };
+
+    // Words [From, To) are the padding a placement directive wrote to put the next word at To.
+    export struct Placement {
+        uint64_t From = 0;
+        uint64_t To = 0;
+    };
+
+    export struct Options {
+        bool RemoveUnused = false;
+        bool PrintReport = false;
+        std::vector<std::string> KeepLabels; // roots besides address 0 and placed code
+
+        [[nodiscard]] bool IsEnabled() const {
+            return RemoveUnused || PrintReport;
+        }
+    };
+
+    // The code from a label, the start of the program or placed code up to the next of them.
+    export struct Block {
+        std::string Name; // its labels, or how it was reached without one
+        uint64_t Address = 0;
+        uint64_t Size = 0; // in words
+        bool Reachable = false;
+    };
+
+    export struct MemoryReport {
+        std::vector<Block> Blocks; // by address, padding is not a block
+        uint64_t UsedWords = 0;    // by blocks, before removal
+        uint64_t RemovedWords = 0;
+        uint64_t ImageWords = 0;   // of the program afterwards, with padding
+    };
+
+    // Finds the blocks no root reaches. Roots are address 0, placed code and the kept labels; a block reaches
+    // the labels its address relocations refer to, and the next block unless its last word is a terminator.
+    // With RemoveUnused the unreachable blocks are dropped: later code moves down, placed code keeps its
+    // address, and labels and relocations move with their code, so the link that follows patches every
+    // reference as before. A jump to a literal address has no relocation and is not followed.
+    export MemoryReport EliminateDeadCode(BitBuffer &bitBuffer, SymbolTable &symbolTable,
+                                          std::vector<Placement> &placements, size_t wordWidth,
+                                          const Rules &rules, const Options &options);
+
+    export std::string FormatMemoryReport(const MemoryReport &report, size_t memoryDepth);
+}
@@ -0,0 +1,95 @@
+module Core.Diagnostics;
+
+import std;
+
+namespace Core {
+    namespace {
+        bool IsBefore(const Diagnostic &lhs, const Diagnostic &rhs) {
+            if (!lhs.Span || !rhs.Span)
+                return lhs.Span.has_value() && !rhs.Span.has_value();
+            const auto &a = lhs.Span->Begin;
+            const auto &b = rhs.Span->Begin;
+            return std::tie(a.Line, a.Column) < std::tie(b.Line, b.Column);
+        }
+
+        size_t CountOf(std::span<const Diagnostic> diagnostics, Severity severity) {
+            return std::ranges::count(diagnostics, severity, &Diagnostic::Level);
+        }
+    }
+
+    std::string_view GetSeverityName(Severity severity) {
+        return severity == Severity::Error ? "error" : "warning";
+    }
+
+    void DiagnosticSink::Report(Diagnostic diagnostic) {
+        if (diagnostic.Level == Severity::Error) {
+            ++m_ErrorCount;
+        }
+        m_Diagnostics.push_back(std::move(diagnostic));
+    }
+
+    std::vector<Diagnostic> DiagnosticSink::GetSorted() const {
+        auto sorted = m_Diagnostics;
+        std::ranges::stable_sort(sorted, IsBefore);
+        return sorted;
+    }
+
+    void DiagnosticSink::Clear() {
+        m_Diagnostics.clear();
+        m_ErrorCount = 0;
+    }
+
+    std::string FormatDiagnostics(std::span<const Diagnostic> diagnostics, std::string_view sourceName) {
+        std::string text;
+        for (const auto &diagnostic: diagnostics) {
+            if (!text.empty())
+                text += '\n';
+            std::string location{sourceName};
+            if (diagnostic.Span) {
+                location += std::format("{}{}:{}", sourceName.empty() ? "" : ":", diagnostic.Span->Begin.Line,
+                                        diagnostic.Span->Begin.Column);
+            }
+            text += location.empty()
+                        ? std::format("{}: {}", GetSeverityName(diagnostic.Level), diagnostic.Message)
+                        : std::format("{}: {}: {}", location, GetSeverityName(diagnostic.Level), diagnostic.Message);
+        }
+
+        size_t errors = CountOf(diagnostics, Severity::Error);
+        size_t warnings = CountOf(diagnostics, Severity::Warning);
+        text += std::format("\n{} error{}, {} warning{}", errors, errors == 1 ? "" : "s", warnings,
+                            warnings == 1 ? "" : "s");
+        return text;
+    }
+
+    void WriteDiagnosticsJson(Json::JsonWriter &writer, std::span<const Diagnostic> diagnostics,
+                              std::string_view sourceName) {
+        writer.BeginObject()
+                .Member("source", sourceName)
+                .Member("errors", CountOf(diagnostics, Severity::Error))
+                .Member("warnings", CountOf(diagnostics, Severity::Warning));
+        writer.Key("diagnostics").BeginArray();
+        for (const auto &diagnostic: diagnostics) {
+            writer.BeginObject().Member("severity", GetSeverityName(diagnostic.Level));
+            if (diagnostic.Span) {
+                writer.Member("line", diagnostic.Span->Begin.Line)
+                        .Member("column", diagnostic.Span->Begin.Column)
+                        .Member("endLine", diagnostic.Span->End.Line)
+                        .Member("endColumn", diagnostic.Span->End.Column);
+            }
+            writer.Member("message", diagnostic.Message).EndObject();
+        }
+        writer.EndArray().EndObject();
+    }
+
+    DiagnosticError::DiagnosticError(std::vector<Diagnostic> diagnostics)
+        : CompileError(FormatDiagnostics(diagnostics)), m_Diagnostics(std::move(diagnostics)) {}
+
+    void AddDiagnosticsLibToState(sol::state &state) {
+        state.new_usertype<Diagnostic>(
+            "Diagnostic", sol::no_constructor,
+            "MakeError", [](TokenStream &tokenStream, std::string message) {
+                return Diagnostic{Severity::Error, tokenStream.GetCurrentSpan(), std::move(message)};
+            },
+            "GetMessage", [](const Diagnostic &diagnostic) { return diagnostic.Message; });
+    }
+}
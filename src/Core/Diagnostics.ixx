@@ -0,0 +1,95 @@
+export module Core.Diagnostics;
+
+import std;
+import Vendor.sol;
+import Core.Parser;
+import Core.Exceptions;
+import Core.Json;
+
+namespace Core {
+    export enum class Severity {
+        Warning,
+        Error
+    };
+
+    export std::string_view GetSeverityName(Severity severity);
+
+    export struct Diagnostic {
+        Severity Level = Severity::Error;
+        std::optional<SourceSpan> Span; // none for problems of the whole program, e.g. unresolved symbols
+        std::string Message;
+    };
+
+    // Collects the problems of one compile as plain values, so reporting one neither allocates an exception
+    // nor unwinds. Kept in report order, sorted only when they are read out.
+    export class DiagnosticSink {
+    public:
+        void Report(Diagnostic diagnostic);
+
+        void Report(Severity level, std::optional<SourceSpan> span, std::string message) {
+            Report(Diagnostic{level, span, std::move(message)});
+        }
+
+        [[nodiscard]] bool HasErrors() const {
+            return m_ErrorCount != 0;
+        }
+
+        [[nodiscard]] size_t GetErrorCount() const {
+            return m_ErrorCount;
+        }
+
+        [[nodiscard]] bool IsEmpty() const {
+            return m_Diagnostics.empty();
+        }
+
+        // By location, problems without one last; equal locations keep their report order.
+        [[nodiscard]] std::vector<Diagnostic> GetSorted() const;
+
+        void Clear();
+
+    private:
+        std::vector<Diagnostic> m_Diagnostics;
+        size_t m_ErrorCount = 0;
+    };
+
+    // 'source:line:column: error: message', one per line. Without a source name the line starts at 'line'.
+    export std::string FormatDiagnostics(std::span<const Diagnostic> diagnostics, std::string_view sourceName = {});
+
+    // {"source": ..., "errors": n, "warnings": n, "diagnostics": [{"severity", "line", "column", "endLine",
+    // "endColumn", "message"}]}, locations are omitted for diagnostics without one.
+    export void WriteDiagnosticsJson(Json::JsonWriter &writer, std::span<const Diagnostic> diagnostics,
+                                     std::string_view sourceName);
+
+    // The error of one statement, thrown by native code that cannot return it. The compiler records it and
+    // carries on with the next line; what() reads as the message of a plain CompileError.
+    export class StatementError : public Exceptions::CompileError {
+    public:
+        StatementError(SourceSpan span, std::string message, const std::string &fullMessage)
+            : CompileError(fullMessage), m_Span(span), m_Message(std::move(message)) {}
+
+        [[nodiscard]] Diagnostic ToDiagnostic() const {
+            return {Severity::Error, m_Span, m_Message};
+        }
+
+    private:
+        SourceSpan m_Span;
+        std::string m_Message;
+    };
+
+    // Ends a compile that reported errors, with every diagnostic of it in sorted order.
+    export class DiagnosticError : public Exceptions::CompileError {
+    public:
+        explicit DiagnosticError(std::vector<Diagnostic> diagnostics);
+
+        [[nodiscard]] std::span<const Diagnostic> GetDiagnostics() const {
+            return m_Diagnostics;
+        }
+
+    private:
+        std::vector<Diagnostic> m_Diagnostics;
+    };
+
+    // Lua handlers return 'Diagnostic.MakeError(tokenStream, message)' instead of an exception to report an
+    // error at the current token, see SourceCompiler::ReportError for errors that do not end the handler.
+    export void AddDiagnosticsLibToState(sol::state &state);
+}
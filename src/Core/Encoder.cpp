@@ -0,0 +1,178 @@
+module Core.Encoder;
+
+import std;
+import Vendor.yaml;
+import Core.Lib;
+
+namespace Core::Encoder {
+    namespace {
+        std::optional<OperandPattern> ParseOperandPattern(std::string_view name) {
+            static constexpr std::array<std::pair<std::string_view, OperandPattern>, 6> patterns{
+                {
+                    {"RegisterOrImmediate", OperandPattern::RegisterOrImmediate},
+                    {"RegisterOrIndirect", OperandPattern::RegisterOrIndirect},
+                    {"ConditionalAddress", OperandPattern::ConditionalAddress},
+                    {"OptionalCondition", OperandPattern::OptionalCondition},
+                    {"Register", OperandPattern::Register},
+                    {"Keyword", OperandPattern::Keyword}
+                }
+            };
+
+            for (const auto &[patternName, pattern]: patterns) {
+                if (Lib::EqualsIgnoreCase(patternName, name))
+                    return pattern;
+            }
+            return std::nullopt;
+        }
+
+        template<typename ExpectedType>
+        ExpectedType ReadOr(const YAML::Node &node, std::string_view key, ExpectedType fallback) {
+            if (!node.IsDefined()) {
+                return fallback;
+            }
+            if (auto value = node[key]; value.IsDefined()) {
+                return value.as<ExpectedType>();
+            }
+            return fallback;
+        }
+
+        bool FitsIn(uint64_t value, size_t bits) {
+            return bits >= 64 || value < (uint64_t{1} << bits);
+        }
+
+        size_t EncodedWidth(const FieldWidths &widths, const InstructionEncoding &encoding) {
+            switch (encoding.Pattern) {
+                case OperandPattern::RegisterOrImmediate:
+                case OperandPattern::RegisterOrIndirect:
+                    return widths.Immediate + widths.Register + 1 + encoding.OpcodeWidth;
+                case OperandPattern::ConditionalAddress:
+                case OperandPattern::OptionalCondition:
+                    return widths.Address + widths.Condition + encoding.OpcodeWidth;
+                case OperandPattern::Register:
+                    return widths.Immediate + widths.Register + encoding.OpcodeWidth;
+                case OperandPattern::Keyword:
+                    return widths.Word;
+            }
+            return 0;
+        }
+
+        InstructionEncoding ParseInstruction(const std::string &mnemonic, const YAML::Node &node,
+                                             const FieldWidths &widths) {
+            InstructionEncoding encoding;
+            encoding.Mnemonic = mnemonic;
+
+            auto patternName = node["Pattern"].as<std::string>();
+            auto pattern = ParseOperandPattern(patternName);
+            if (!pattern) {
+                throw std::runtime_error(
+                    std::format("Unknown operand pattern '{}' for instruction '{}'", patternName, mnemonic));
+            }
+            encoding.Pattern = *pattern;
+            encoding.Opcode = ReadOr<uint64_t>(node, "Opcode", 0);
+            encoding.OpcodeWidth = ReadOr<size_t>(node, "OpcodeWidth", widths.Opcode);
+            encoding.Function = ReadOr<uint64_t>(node, "Function", 0);
+
+            if (encoding.Pattern == OperandPattern::Keyword) {
+                for (const auto &keyword: node["Keywords"]) {
+                    encoding.Keywords.emplace_back(Lib::ToLowerCase(keyword.first.as<std::string>()),
+                                                   keyword.second.as<uint64_t>());
+                }
+                if (encoding.Keywords.empty()) {
+                    throw std::runtime_error(std::format("Instruction '{}' has no keywords", mnemonic));
+                }
+            }
+
+            bool fits = FitsIn(encoding.Opcode, encoding.OpcodeWidth) && FitsIn(encoding.Function, widths.Immediate);
+            for (const auto &[keyword, word]: encoding.Keywords) {
+                fits = fits && FitsIn(word, widths.Word);
+            }
+            if (!fits) {
+                throw std::runtime_error(std::format("Encoding of instruction '{}' does not fit its fields", mnemonic));
+            }
+
+            if (auto width = EncodedWidth(widths, encoding); width != widths.Word) {
+                throw std::runtime_error(
+                    std::format("Encoding of instruction '{}' is {} bits wide, but the word width is {}",
+                                mnemonic, width, widths.Word));
+            }
+            return encoding;
+        }
+    }
+
+    std::optional<EncodingTable> ParseEncodingTable(const YAML::Node &config) {
+        auto instructions = config["InstructionEncodings"];
+        if (!instructions.IsDefined()) {
+            return std::nullopt;
+        }
+
+        try {
+            EncodingTable table;
+
+            auto fields = config["EncodingFieldWidths"];
+            table.Widths.Register = ReadOr(fields, "Register", table.Widths.Register);
+            table.Widths.Immediate = ReadOr(fields, "Immediate", table.Widths.Immediate);
+            table.Widths.Address = ReadOr(fields, "Address", ReadOr(config, "AddressWidth", table.Widths.Address));
+            table.Widths.Condition = ReadOr(fields, "Condition", table.Widths.Condition);
+            table.Widths.Opcode = ReadOr(fields, "Opcode", table.Widths.Opcode);
+            table.Widths.Word = ReadOr(config, "WordWidth", table.Widths.Word);
+
+            auto registers = config["Registers"];
+            table.Registers.Prefix = ReadOr(registers, "Prefix", table.Registers.Prefix);
+            table.Registers.Count = ReadOr(registers, "Count", table.Registers.Count);
+            table.Registers.AliasTable = ReadOr(registers, "AliasTable", table.Registers.AliasTable);
+            if (table.Registers.Count == 0 || !FitsIn(table.Registers.Count - 1, table.Widths.Register)) {
+                throw std::runtime_error(std::format("{} registers do not fit in a {} bit register field",
+                                                     table.Registers.Count, table.Widths.Register));
+            }
+
+            for (const auto &condition: config["Conditions"]) {
+                table.Conditions.emplace_back(Lib::ToLowerCase(condition.first.as<std::string>()),
+                                              condition.second.as<uint64_t>());
+            }
+
+            for (const auto &instruction: instructions) {
+                table.Instructions.push_back(
+                    ParseInstruction(instruction.first.as<std::string>(), instruction.second, table.Widths));
+            }
+            return table;
+        } catch (const YAML::Exception &e) {
+            throw std::runtime_error("Error parsing configuration: " + std::string(e.what()));
+        }
+    }
+
+    std::optional<int64_t> ParseHexNumber(std::string_view token) {
+        bool negative = false;
+        if (!token.empty() && (token.front() == '-' || token.front() == '+')) {
+            negative = token.front() == '-';
+            token.remove_prefix(1);
+        }
+        if (token.empty()) {
+            return std::nullopt;
+        }
+
+        uint64_t value = 0;
+        auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value, 16);
+        if (end != token.data() + token.size()) {
+            return std::nullopt;
+        }
+        if (error == std::errc::result_out_of_range || value > static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+            value = std::numeric_limits<int64_t>::max(); // saturates like strtoul, still out of any field's range
+        }
+        return negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+    }
+
+    std::optional<size_t> ParseRegisterName(const RegisterSpec &spec, std::string_view token) {
+        if (token.size() <= spec.Prefix.size() || !Lib::EqualsIgnoreCase(token.substr(0, spec.Prefix.size()), spec.Prefix))
+            return std::nullopt;
+
+        auto digits = token.substr(spec.Prefix.size());
+        size_t maxDigits = std::format("{:x}", spec.Count - 1).size();
+        if (digits.size() > maxDigits || digits.front() == '+' || digits.front() == '-')
+            return std::nullopt;
+
+        auto index = ParseHexNumber(digits);
+        if (!index || static_cast<uint64_t>(*index) >= spec.Count)
+            return std::nullopt;
+        return static_cast<size_t>(*index);
+    }
+}
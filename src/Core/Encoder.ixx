@@ -0,0 +1,272 @@
+export module Core.Encoder;
+
+import std;
+import Vendor.yaml;
+import Core.Parser;
+import Core.Diagnostics;
+import Core.Lib;
+import Core.SymbolTable;
+
+namespace Core::Encoder {
+    // Operand shapes of the 'InstructionEncodings' section of the language specification. Fields are
+    // written LSB first in the order listed, so every pattern produces exactly one instruction word.
+    export enum class OperandPattern {
+        RegisterOrImmediate, // operand | sX | flag | opcode, the operand is 'kk' or '0000 sY'
+        RegisterOrIndirect,  // same fields, the register operand is written as '(sY)'
+        ConditionalAddress,  // address | condition | opcode
+        OptionalCondition,   // zero address | optional condition | opcode
+        Register,            // function | sX | opcode
+        Keyword              // one complete word per accepted keyword
+    };
+
+    export struct FieldWidths {
+        size_t Register = 4;
+        size_t Immediate = 8;
+        size_t Address = 10;
+        size_t Condition = 3;
+        size_t Opcode = 5;
+        size_t Word = 18;
+    };
+
+    export struct RegisterSpec {
+        std::string Prefix = "s";
+        size_t Count = 16;
+        std::string AliasTable = "RegNameArray"; // compiler context table filled by the NAMEREG handler
+    };
+
+    export struct InstructionEncoding {
+        std::string Mnemonic;
+        OperandPattern Pattern = OperandPattern::Register;
+        uint64_t Opcode = 0;
+        size_t OpcodeWidth = 0;
+        uint64_t Function = 0;
+        std::vector<std::pair<std::string, uint64_t>> Keywords; // lower case keyword and its word
+    };
+
+    export struct EncodingTable {
+        FieldWidths Widths;
+        RegisterSpec Registers;
+        std::vector<std::pair<std::string, uint64_t>> Conditions; // lower case name and its code
+        std::vector<InstructionEncoding> Instructions;
+
+        [[nodiscard]] std::optional<uint64_t> FindCondition(std::string_view token) const {
+            for (const auto &[name, code]: Conditions) {
+                if (Lib::EqualsIgnoreCase(name, token))
+                    return code;
+            }
+            return std::nullopt;
+        }
+    };
+
+    // nullopt if the specification has no 'InstructionEncodings' section.
+    export std::optional<EncodingTable> ParseEncodingTable(const YAML::Node &config);
+
+    // Same rules as Lua's tonumber(token, 16): an optional sign followed by hex digits only.
+    export std::optional<int64_t> ParseHexNumber(std::string_view token);
+
+    // Index of a built-in register name such as 's7', ignoring aliases.
+    export std::optional<size_t> ParseRegisterName(const RegisterSpec &spec, std::string_view token);
+
+    // Target is the SourceCompiler, it provides the token stream, bit output, register resolution and
+    // link requests. Errors are thrown as StatementError with the same messages the Lua handlers produce.
+    template<typename Target>
+    class InstructionEncoder {
+    public:
+        InstructionEncoder(const EncodingTable &table, const InstructionEncoding &encoding, Target &target)
+            : m_Table(table), m_Encoding(encoding), m_Target(target), m_TokenStream(target.GetTokenStream()) {}
+
+        void Encode() {
+            const auto &widths = m_Table.Widths;
+            switch (m_Encoding.Pattern) {
+                case OperandPattern::RegisterOrImmediate:
+                case OperandPattern::RegisterOrIndirect: {
+                    size_t start = m_Target.GetBitBufferSize();
+                    auto first = ExpectRegister();
+                    ExpectToken(",", "Expected ',' after first register, but found '{}' instead.");
+                    auto [operand, isRegister] = m_Encoding.Pattern == OperandPattern::RegisterOrImmediate
+                                                     ? ParseRegisterOrImmediate(start)
+                                                     : ParseIndirectRegisterOrImmediate(start);
+                    uint64_t word = operand;
+                    word |= first << widths.Immediate;
+                    word |= uint64_t{isRegister} << (widths.Immediate + widths.Register);
+                    word |= m_Encoding.Opcode << (widths.Immediate + widths.Register + 1);
+                    m_Target.WriteUnsignedNumber(word, widths.Word);
+                    break;
+                }
+                case OperandPattern::ConditionalAddress: {
+                    size_t start = m_Target.GetBitBufferSize();
+                    auto token = ExpectAnyToken();
+                    uint64_t condition = 0;
+                    if (auto code = m_Table.FindCondition(token)) {
+                        condition = *code;
+                        ExpectToken(",", std::format("Expected ',' after '{}', but found '{{}}' instead.",
+                                                     Lib::ToUpperCase(std::string(token))));
+                        token = ExpectAnyToken();
+                    }
+                    uint64_t address = ParseAddress(token, start);
+                    m_Target.WriteUnsignedNumber(
+                        address | condition << widths.Address | m_Encoding.Opcode << (widths.Address + widths.Condition),
+                        widths.Word);
+                    break;
+                }
+                case OperandPattern::OptionalCondition: {
+                    uint64_t condition = 0;
+                    if (!m_TokenStream.IsNewLine()) {
+                        if (auto token = m_TokenStream.PeekCurrent()) {
+                            auto code = m_Table.FindCondition(*token);
+                            if (!code) {
+                                Fail(std::format("Invalid condition '{}' for '{}'.", *token, m_Encoding.Mnemonic));
+                            }
+                            m_TokenStream.SkipCurrent();
+                            condition = *code;
+                        }
+                    }
+                    m_Target.WriteUnsignedNumber(
+                        condition << widths.Address | m_Encoding.Opcode << (widths.Address + widths.Condition),
+                        widths.Word);
+                    break;
+                }
+                case OperandPattern::Register: {
+                    auto first = ExpectRegister();
+                    uint64_t word = m_Encoding.Function;
+                    word |= first << widths.Immediate;
+                    word |= m_Encoding.Opcode << (widths.Immediate + widths.Register);
+                    m_Target.WriteUnsignedNumber(word, widths.Word);
+                    break;
+                }
+                case OperandPattern::Keyword: {
+                    auto token = ExpectAnyToken();
+                    for (const auto &[keyword, word]: m_Encoding.Keywords) {
+                        if (Lib::EqualsIgnoreCase(keyword, token)) {
+                            m_Target.WriteUnsignedNumber(word, widths.Word);
+                            return;
+                        }
+                    }
+                    Fail(DescribeExpectedKeywords(token));
+                }
+            }
+        }
+
+    private:
+        [[noreturn]] void Fail(std::string_view message) {
+            auto fullMessage = std::format("Compile Error {}: {}", m_TokenStream.GetApproxCurrentLocation(), message);
+            throw StatementError(m_TokenStream.GetCurrentSpan(), std::string(message), fullMessage);
+        }
+
+        std::string_view ExpectAnyToken() {
+            auto token = m_TokenStream.ParseCurrent();
+            if (!token) {
+                Fail("No token found in the token stream.");
+            }
+            return *token;
+        }
+
+        void ExpectToken(std::string_view expected, std::string_view messageFormat) {
+            auto token = ExpectAnyToken();
+            if (token != expected) {
+                Fail(std::vformat(messageFormat, std::make_format_args(token)));
+            }
+        }
+
+        uint64_t ExpectRegister() {
+            auto token = ExpectAnyToken();
+            auto reg = m_Target.ResolveRegister(m_Table.Registers, token);
+            if (!reg) {
+                Fail(std::format("Invalid register name: '{}'. Expected '{}0' to '{}{}' or a valid register name.",
+                                 token, m_Table.Registers.Prefix, m_Table.Registers.Prefix,
+                                 m_Table.Registers.Count - 1));
+            }
+            return *reg;
+        }
+
+        // Lib.ParseSimpleUnsigned: a '0x' prefix is tolerated with a warning
+        std::optional<int64_t> ParseUnsigned(std::string_view token) {
+            if (token.starts_with("0x") || token.starts_with("0X")) {
+                m_Target.PrintMessage(std::format("Warning: Immediate value should not include '0x' prefix: {}", token));
+                token.remove_prefix(2);
+            }
+            return ParseHexNumber(token);
+        }
+
+        uint64_t ParseImmediate(std::string_view token, size_t start) {
+            auto value = ParseUnsigned(token);
+            size_t width = m_Table.Widths.Immediate;
+            if (!value || *value < 0 || static_cast<uint64_t>(*value) >= (uint64_t{1} << width)) {
+                // not a literal, resolved as a constant by the linker
+                m_Target.RequestLink(RelocationKind::Constant, token, start, width);
+                return 0;
+            }
+            return static_cast<uint64_t>(*value);
+        }
+
+        std::pair<uint64_t, bool> ParseRegisterOrImmediate(size_t start) {
+            auto token = ExpectAnyToken();
+            if (auto second = m_Target.ResolveRegister(m_Table.Registers, token)) {
+                return {*second << m_Table.Widths.Register, true};
+            }
+            return {ParseImmediate(token, start), false};
+        }
+
+        std::pair<uint64_t, bool> ParseIndirectRegisterOrImmediate(size_t start) {
+            auto next = m_TokenStream.PeekCurrent();
+            if (!next) {
+                Fail("No token found in the token stream.");
+            }
+            if (*next != "(") {
+                return {ParseImmediate(ExpectAnyToken(), start), false};
+            }
+
+            m_TokenStream.SkipCurrent();
+            auto second = ExpectRegister();
+            auto close = m_TokenStream.PeekCurrent();
+            if (!close) {
+                Fail("No token found in the token stream.");
+            }
+            if (*close != ")") {
+                Fail(std::format("Expected ')', but found '{}' instead.", *close));
+            }
+            m_TokenStream.SkipCurrent();
+            return {second << m_Table.Widths.Register, true};
+        }
+
+        uint64_t ParseAddress(std::string_view token, size_t start) {
+            auto value = ParseUnsigned(token);
+            size_t width = m_Table.Widths.Address;
+            uint64_t maxAddress = (uint64_t{1} << width) - 1;
+            if (!value) {
+                // a label, the dummy is all ones until the linker patches it
+                m_Target.RequestLink(RelocationKind::Address, token, start, width);
+                return maxAddress;
+            }
+            if (*value < 0 || static_cast<uint64_t>(*value) > maxAddress) {
+                Fail(std::format("Address value '{}' is out of range. Expected a value between 0 and {}.",
+                                 *value, maxAddress));
+            }
+            return static_cast<uint64_t>(*value);
+        }
+
+        std::string DescribeExpectedKeywords(std::string_view token) const {
+            auto mnemonic = Lib::ToLowerCase(m_Encoding.Mnemonic);
+            if (m_Encoding.Keywords.size() == 1) {
+                return std::format("Expected '{}' keyword after '{}', but found '{}'.",
+                                   m_Encoding.Keywords.front().first, mnemonic, token);
+            }
+            std::string expected;
+            for (const auto &[keyword, word]: m_Encoding.Keywords) {
+                expected += expected.empty() ? "" : ", ";
+                expected += std::format("'{}'", keyword);
+            }
+            return std::format("Expected one of {} after '{}', but found '{}'.", expected, mnemonic, token);
+        }
+
+        const EncodingTable &m_Table;
+        const InstructionEncoding &m_Encoding;
+        Target &m_Target;
+        TokenStream &m_TokenStream;
+    };
+
+    export template<typename Target>
+    void Encode(const EncodingTable &table, const InstructionEncoding &encoding, Target &target) {
+        InstructionEncoder<Target>(table, encoding, target).Encode();
+    }
+}
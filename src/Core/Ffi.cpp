@@ -0,0 +1,207 @@
+module Core.Ffi;
+
+import std;
+import Vendor.sol;
+import Core.Compiler;
+import Core.Parser;
+import Core.Diagnostics;
+import Core.Exceptions;
+
+// The C ABI, declared again in the Lua prelude below. LuaJIT reaches it through function pointers handed to
+// the prelude, not by symbol lookup, so nothing has to be exported from the executable. Nothing may unwind
+// through an FFI frame: errors are reported to the compiler's diagnostics and signalled by returning 0.
+extern "C" {
+    struct EasyASM_Token {
+        const char *Text; // into the source, or the decoded string of the token, valid until the next parse
+        size_t Length;
+        size_t Line;
+        size_t Column;
+    };
+}
+
+namespace Core::Ffi {
+    namespace {
+        template<typename Function>
+        int ReportFailure(SourceCompiler &compiler, Function &&function) noexcept {
+            try {
+                function();
+                return 1;
+            } catch (const StatementError &e) {
+                compiler.GetDiagnostics().Report(e.ToDiagnostic());
+            } catch (const std::exception &e) {
+                compiler.ReportError(e.what());
+            } catch (...) {
+                compiler.ReportError("Unknown error in a native call");
+            }
+            return 0;
+        }
+
+        int FillToken(const std::optional<Token> &token, EasyASM_Token *out) {
+            if (!token)
+                return 0;
+            *out = {token->Text.data(), token->Text.size(), token->Span.Begin.Line, token->Span.Begin.Column};
+            return 1;
+        }
+    }
+}
+
+extern "C" {
+    const uint64_t *EasyASM_GetBitBufferWords(Core::SourceCompiler *compiler) noexcept {
+        return compiler->GetBitBuffer().GetWords().data();
+    }
+
+    size_t EasyASM_GetBitBufferSize(Core::SourceCompiler *compiler) noexcept {
+        return compiler->GetBitBufferSize();
+    }
+
+    int EasyASM_WriteUnsigned(Core::SourceCompiler *compiler, uint64_t number, size_t bits) noexcept {
+        return Core::Ffi::ReportFailure(*compiler, [&] {
+            compiler->WriteUnsignedNumber(number, bits);
+        });
+    }
+
+    int EasyASM_ReplaceUnsigned(Core::SourceCompiler *compiler, uint64_t number, size_t bits,
+                                size_t startIndex) noexcept {
+        return Core::Ffi::ReportFailure(*compiler, [&] {
+            compiler->ReplaceUnsignedNumber(number, bits, startIndex);
+        });
+    }
+
+    int EasyASM_ParseToken(Core::SourceCompiler *compiler, EasyASM_Token *token) noexcept {
+        return Core::Ffi::FillToken(compiler->GetTokenStream().ParseToken(), token);
+    }
+
+    int EasyASM_PeekToken(Core::SourceCompiler *compiler, EasyASM_Token *token) noexcept {
+        return Core::Ffi::FillToken(compiler->GetTokenStream().PeekToken(), token);
+    }
+}
+
+namespace Core::Ffi {
+    namespace {
+        // Runs with the function pointers and the ABI version, returns the 'Native' table.
+        constexpr std::string_view Prelude = R"lua(
+local functions, abiVersion = ...
+local ffi = require("ffi")
+local bit = require("bit")
+
+ffi.cdef[[
+typedef struct EasyASM_Compiler EasyASM_Compiler;
+typedef struct EasyASM_Token {
+    const char *Text;
+    size_t Length;
+    size_t Line;
+    size_t Column;
+} EasyASM_Token;
+]]
+
+local C = {
+    GetBitBufferWords = ffi.cast("const uint64_t *(*)(EasyASM_Compiler *)", functions.GetBitBufferWords),
+    GetBitBufferSize = ffi.cast("size_t (*)(EasyASM_Compiler *)", functions.GetBitBufferSize),
+    WriteUnsigned = ffi.cast("int (*)(EasyASM_Compiler *, uint64_t, size_t)", functions.WriteUnsigned),
+    ReplaceUnsigned = ffi.cast("int (*)(EasyASM_Compiler *, uint64_t, size_t, size_t)", functions.ReplaceUnsigned),
+    ParseToken = ffi.cast("int (*)(EasyASM_Compiler *, EasyASM_Token *)", functions.ParseToken),
+    PeekToken = ffi.cast("int (*)(EasyASM_Compiler *, EasyASM_Token *)", functions.PeekToken),
+}
+
+local Native = { AbiVersion = abiVersion, C = C, Token = ffi.new("EasyASM_Token") }
+local token = Native.Token
+
+-- A handle of the compiler for the functions below, valid while the handler it was made in runs.
+function Native.Bind(compiler)
+    return ffi.cast("EasyASM_Compiler *", compiler:GetNativeHandle())
+end
+
+-- The packed words of the bit buffer, bit i is bit i % 64 of word i / 64, and its size in bits.
+-- Any write may move the words.
+function Native.GetBits(handle)
+    return C.GetBitBufferWords(handle), tonumber(C.GetBitBufferSize(handle))
+end
+
+function Native.GetBitBufferSize(handle)
+    return tonumber(C.GetBitBufferSize(handle))
+end
+
+-- Bits [start, start + width) of the words GetBits returned, as a number up to 53 bits and a uint64_t above.
+function Native.ReadBits(words, size, start, width)
+    if width < 0 or width > 64 or start < 0 or start + width > size then
+        error("BitBuffer read out of range", 2)
+    end
+    if width == 0 then
+        return 0
+    end
+    local index = math.floor(start / 64)
+    local offset = start % 64
+    local value = bit.rshift(words[index], offset)
+    if offset + width > 64 then
+        value = bit.bor(value, bit.lshift(words[index + 1], 64 - offset))
+    end
+    if width < 64 then
+        value = bit.band(value, bit.lshift(1ULL, width) - 1)
+    end
+    if width <= 53 then
+        return tonumber(value)
+    end
+    return value
+end
+
+function Native.ReadWord(words, size, index, wordWidth)
+    return Native.ReadBits(words, size, index * wordWidth, wordWidth)
+end
+
+-- As compiler:WriteUnsignedNumber and ReplaceUnsignedNumber, but an error is reported rather than thrown.
+-- They return false after one, and the handler should return.
+function Native.WriteUnsigned(handle, number, bits)
+    return C.WriteUnsigned(handle, number, bits) ~= 0
+end
+
+function Native.ReplaceUnsigned(handle, number, bits, startIndex)
+    return C.ReplaceUnsigned(handle, number, bits, startIndex) ~= 0
+end
+
+-- As tokenStream:ParseCurrent and PeekCurrent. Native.Token keeps the last token until the next call, e.g.
+-- to look at its first byte without making a string of it.
+function Native.ParseCurrent(handle)
+    if C.ParseToken(handle, token) == 0 then
+        return nil
+    end
+    return ffi.string(token.Text, token.Length)
+end
+
+function Native.PeekCurrent(handle)
+    if C.PeekToken(handle, token) == 0 then
+        return nil
+    end
+    return ffi.string(token.Text, token.Length)
+end
+
+return Native
+)lua";
+    }
+
+    void AddLibToState(sol::state &state) {
+        auto functions = state.create_table();
+        functions["GetBitBufferWords"] = reinterpret_cast<void *>(&EasyASM_GetBitBufferWords);
+        functions["GetBitBufferSize"] = reinterpret_cast<void *>(&EasyASM_GetBitBufferSize);
+        functions["WriteUnsigned"] = reinterpret_cast<void *>(&EasyASM_WriteUnsigned);
+        functions["ReplaceUnsigned"] = reinterpret_cast<void *>(&EasyASM_ReplaceUnsigned);
+        functions["ParseToken"] = reinterpret_cast<void *>(&EasyASM_ParseToken);
+        functions["PeekToken"] = reinterpret_cast<void *>(&EasyASM_PeekToken);
+
+        sol::load_result prelude = state.load(Prelude, "=EasyASM.Native");
+        if (!prelude.valid()) {
+            sol::error error = prelude;
+            throw Exceptions::CompilerImplementationError(
+                std::format("Failed to load the FFI library: {}", error.what()));
+        }
+        sol::protected_function_result native = prelude.get<sol::protected_function>()(functions, AbiVersion);
+        if (!native.valid()) {
+            sol::error error = native;
+            throw Exceptions::CompilerImplementationError(
+                std::format("Failed to load the FFI library: {}", error.what()));
+        }
+
+        sol::table nativeTable = native;
+        state["Native"] = nativeTable;
+        state["package"]["loaded"]["EasyASM.Native"] = nativeTable;
+    }
+}
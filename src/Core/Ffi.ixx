@@ -0,0 +1,15 @@
+export module Core.Ffi;
+
+import std;
+import Vendor.sol;
+
+namespace Core::Ffi {
+    // Version of the C ABI behind the 'Native' table, bumped on any change to its declarations. Language
+    // libraries that declare the functions themselves can check it against Native.AbiVersion.
+    export constexpr uint32_t AbiVersion = 1;
+
+    // Declares the C ABI to LuaJIT's FFI and sets up the global 'Native' table on top of it, so the hot loops
+    // of a language library can read the bit buffer, write fields and parse tokens without going through
+    // the sol2 bindings. The state needs the 'ffi' and 'bit' libraries open.
+    export void AddLibToState(sol::state &state);
+}
@@ -0,0 +1,386 @@
+module Core.Incremental;
+
+import std;
+import Core.Compiler;
+import Core.Parser;
+import Core.BitBuffer;
+import Core.SymbolTable;
+import Core.SourceBuffer;
+import Core.Diagnostics;
+
+namespace Core::Incremental {
+    namespace {
+        using Definitions = std::vector<std::pair<std::string, uint64_t>>;
+
+        void AppendBits(BitBuffer &destination, const BitBuffer &source, size_t from, size_t to) {
+            for (size_t bit = from; bit < to;) {
+                size_t bits = std::min(BitBuffer::WordBits, to - bit);
+                destination.PushBits(source.ReadBits(bit, bits), bits);
+                bit += bits;
+            }
+        }
+
+        void MoveSpan(std::optional<SourceSpan> &span, std::ptrdiff_t lines) {
+            if (!span)
+                return;
+            span->Begin.Line += lines;
+            span->End.Line += lines;
+        }
+
+        // For a line that kept its text but not its line number.
+        void MoveLine(SourceLine &line, std::ptrdiff_t lines) {
+            MoveSpan(line.Span, lines);
+            for (auto &diagnostic: line.Diagnostics) {
+                MoveSpan(diagnostic.Span, lines);
+            }
+        }
+
+        // Punctuation never names anything, and would make every line depend on every other.
+        bool IsName(std::string_view token) {
+            return std::ranges::any_of(token, [](char c) {
+                return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+            });
+        }
+
+        // As in Chunked::PlanChunks, the statement is the first token or the one after a leading 'label:'.
+        size_t GetStatementIndex(const std::vector<std::string> &tokens) {
+            return tokens.size() >= 3 && tokens[1] == ":" ? 2 : 0;
+        }
+
+        // The names a state directive directs, its operands: not its mnemonic, which every other directive
+        // of its kind shares.
+        void AddOperandNames(std::unordered_set<std::string> &changed, const std::vector<std::string> &tokens) {
+            for (size_t i = GetStatementIndex(tokens) + 1; i < tokens.size(); ++i) {
+                if (IsName(tokens[i])) {
+                    changed.insert(tokens[i]);
+                }
+            }
+        }
+
+        void AddChangedLabels(std::unordered_set<std::string> &changed, const Definitions &before,
+                              const Definitions &after) {
+            // a label that only moved is patched by the link, the lines using it stay as they are
+            for (const auto &[lhs, rhs]: {std::pair{&before, &after}, std::pair{&after, &before}}) {
+                for (const auto &[name, address]: *lhs) {
+                    if (!std::ranges::contains(*rhs, name, &Definitions::value_type::first)) {
+                        changed.insert(name);
+                    }
+                }
+            }
+        }
+
+        void AddChangedConstants(std::unordered_set<std::string> &changed, const Definitions &before,
+                                 const Definitions &after) {
+            for (const auto &[lhs, rhs]: {std::pair{&before, &after}, std::pair{&after, &before}}) {
+                for (const auto &constant: *lhs) {
+                    if (!std::ranges::contains(*rhs, constant)) {
+                        changed.insert(constant.first);
+                    }
+                }
+            }
+        }
+    }
+
+    class IncrementalAssembler::EncodeRun {
+    public:
+        // Sets up the compile state a full compile would have at the start of the line.
+        EncodeRun(IncrementalAssembler &assembler, size_t firstLine, uint64_t position)
+            : m_Assembler(assembler),
+              m_SourceCompiler(assembler.m_Compiler.CreateSourceCompiler(assembler.m_Source)),
+              m_WordWidth(assembler.m_Compiler.GetImageLayout().WordWidth) {
+            m_SourceCompiler.BeginCompile();
+            for (size_t i = 0; i < firstLine; ++i) {
+                if (assembler.m_Lines[i].State) {
+                    m_SourceCompiler.SetSourceRange(assembler.GetRange(i));
+                    while (!m_SourceCompiler.CompileOneLine()) {}
+                }
+            }
+            m_SourceCompiler.GetBitBuffer().Clear();
+            m_SourceCompiler.GetSymbolTable().Clear();
+            m_SourceCompiler.GetDiagnostics().Clear();
+            m_SourceCompiler.GetPlacements().clear();
+
+            m_SourceCompiler.GetBitBuffer().PushZeros(position);
+            for (size_t i = 0; i < firstLine; ++i) {
+                Define(assembler.m_Lines[i]);
+            }
+        }
+
+        // Moves past a line that keeps its encoding, so the run can go on with the next line to encode.
+        void Replay(size_t index) {
+            const auto &line = m_Assembler.m_Lines[index];
+            if (line.State) {
+                // only a compile updates what it directs; unchanged, it writes and defines what it did before
+                m_SourceCompiler.SetSourceRange(m_Assembler.GetRange(index));
+                while (!m_SourceCompiler.CompileOneLine()) {}
+                m_SourceCompiler.GetDiagnostics().Clear();
+                m_SourceCompiler.GetPlacements().clear();
+                return;
+            }
+            AppendBits(m_SourceCompiler.GetBitBuffer(), line.Bits, 0, line.Bits.Size());
+            Define(line);
+        }
+
+        void Encode(size_t index) {
+            auto &line = m_Assembler.m_Lines[index];
+            auto &symbolTable = m_SourceCompiler.GetSymbolTable();
+            uint64_t begin = m_SourceCompiler.GetBitBufferSize();
+            size_t firstRelocation = symbolTable.GetRelocations().size();
+
+            // whatever a line defines is named by one of its tokens
+            std::vector<std::pair<bool, bool>> definedBefore;
+            definedBefore.reserve(line.Tokens.size());
+            for (const auto &token: line.Tokens) {
+                definedBefore.emplace_back(symbolTable.GetLabel(token).has_value(),
+                                           symbolTable.GetConstant(token).has_value());
+            }
+
+            m_SourceCompiler.SetSourceRange(m_Assembler.GetRange(index));
+            while (!m_SourceCompiler.CompileOneLine()) {}
+
+            line.BitBegin = begin;
+            line.Bits.Clear();
+            AppendBits(line.Bits, m_SourceCompiler.GetBitBuffer(), begin, m_SourceCompiler.GetBitBufferSize());
+
+            line.Labels.clear();
+            line.Constants.clear();
+            for (size_t i = 0; i < line.Tokens.size(); ++i) {
+                const auto &token = line.Tokens[i];
+                auto address = symbolTable.GetLabel(token);
+                if (address && !definedBefore[i].first &&
+                    !std::ranges::contains(line.Labels, token, &Definitions::value_type::first)) {
+                    line.Labels.emplace_back(token, *address - begin / m_WordWidth);
+                }
+                auto value = symbolTable.GetConstant(token);
+                if (value && !definedBefore[i].second &&
+                    !std::ranges::contains(line.Constants, token, &Definitions::value_type::first)) {
+                    line.Constants.emplace_back(token, *value);
+                }
+            }
+
+            line.Relocations.clear();
+            for (const auto &relocation: symbolTable.GetRelocations().subspan(firstRelocation)) {
+                line.Relocations.push_back({
+                    symbolTable.GetName(relocation.Symbol), relocation.Offset - begin, relocation.Width,
+                    relocation.Kind
+                });
+            }
+
+            line.Diagnostics = m_SourceCompiler.GetDiagnostics().GetSorted();
+            m_SourceCompiler.GetDiagnostics().Clear();
+            m_SourceCompiler.GetPlacements().clear();
+            line.Encoded = true;
+        }
+
+    private:
+        void Define(const SourceLine &line) {
+            auto &symbolTable = m_SourceCompiler.GetSymbolTable();
+            for (const auto &[name, address]: line.Labels) {
+                symbolTable.DefineLabel(name, line.BitBegin / m_WordWidth + address);
+            }
+            for (const auto &[name, value]: line.Constants) {
+                symbolTable.DefineConstant(name, value);
+            }
+        }
+
+        IncrementalAssembler &m_Assembler;
+        SourceCompiler m_SourceCompiler;
+        size_t m_WordWidth;
+    };
+
+    IncrementalAssembler::IncrementalAssembler(const Compiler &compiler)
+        : m_Compiler(compiler), m_Source(SourceBuffer::FromString(std::string{})) {
+        SourceCompiler sourceCompiler{compiler.CreateSourceCompiler(m_Source)};
+        sourceCompiler.BeginCompile();
+        m_Prologue = std::move(sourceCompiler.GetBitBuffer());
+    }
+
+    UpdateResult IncrementalAssembler::Update(std::string text) {
+        m_Source = SourceBuffer::FromString(std::move(text));
+        auto view = m_Source->GetText();
+        std::vector<size_t> offsets;
+        std::vector<std::string_view> texts;
+        for (size_t offset = 0;;) {
+            size_t end = view.find('\n', offset);
+            offsets.push_back(offset);
+            texts.push_back(view.substr(offset, end == std::string_view::npos ? end : end - offset));
+            if (end == std::string_view::npos)
+                break;
+            offset = end + 1;
+        }
+        m_LineOffsets = std::move(offsets);
+
+        // the lines that changed are those between the unchanged beginning and end
+        size_t oldCount = m_Lines.size();
+        size_t newCount = texts.size();
+        size_t prefix = 0;
+        while (prefix < std::min(oldCount, newCount) && m_Lines[prefix].Text == texts[prefix]) {
+            ++prefix;
+        }
+        size_t suffix = 0;
+        while (suffix < std::min(oldCount, newCount) - prefix &&
+               m_Lines[oldCount - 1 - suffix].Text == texts[newCount - 1 - suffix]) {
+            ++suffix;
+        }
+        if (prefix == oldCount && prefix == newCount && std::ranges::all_of(m_Lines, &SourceLine::Encoded))
+            return {{}, !HasErrors()};
+
+        std::unordered_set<std::string> changed;
+        for (size_t i = prefix; i < oldCount - suffix; ++i) {
+            const auto &removed = m_Lines[i];
+            for (const auto &[name, address]: removed.Labels) {
+                changed.insert(name);
+            }
+            for (const auto &[name, value]: removed.Constants) {
+                changed.insert(name);
+            }
+            if (removed.State) {
+                AddOperandNames(changed, removed.Tokens);
+            }
+        }
+
+        std::vector<SourceLine> lines(newCount);
+        std::ranges::move(m_Lines.begin(), m_Lines.begin() + prefix, lines.begin());
+        std::ranges::move(m_Lines.end() - suffix, m_Lines.end(), lines.end() - suffix);
+        auto lineShift = static_cast<std::ptrdiff_t>(newCount) - static_cast<std::ptrdiff_t>(oldCount);
+        if (lineShift != 0) {
+            for (auto &line: std::span(lines).last(suffix)) {
+                MoveLine(line, lineShift);
+            }
+        }
+        m_Lines = std::move(lines);
+        for (size_t i = prefix; i < newCount - suffix; ++i) {
+            m_Lines[i].Text = texts[i];
+            ScanLine(i);
+        }
+
+        UpdateResult result;
+        bool encodeAll = !m_Compiler.GetChunkingDirectives();
+        std::optional<EncodeRun> run;
+        uint64_t position = m_Prologue.Size();
+        size_t i = 0;
+        try {
+            for (; i < m_Lines.size(); ++i) {
+                auto &line = m_Lines[i];
+                bool dependent = i >= prefix && std::ranges::any_of(line.Tokens, [&](const std::string &token) {
+                    return changed.contains(token);
+                });
+                if (!encodeAll && line.Encoded && !dependent && !(line.Placement && line.BitBegin != position)) {
+                    line.BitBegin = position;
+                    position = line.GetBitEnd();
+                    if (run) {
+                        run->Replay(i);
+                    }
+                    continue;
+                }
+
+                line.Encoded = false; // its labels and constants are gone until it encoded
+                if (!run) {
+                    run.emplace(*this, i, position);
+                }
+                auto labels = std::move(line.Labels);
+                auto constants = std::move(line.Constants);
+                run->Encode(i);
+                AddChangedLabels(changed, labels, line.Labels);
+                AddChangedConstants(changed, constants, line.Constants);
+                if (line.State) {
+                    AddOperandNames(changed, line.Tokens);
+                }
+                result.EncodedLines.push_back(i + 1);
+                position = line.GetBitEnd();
+            }
+        } catch (...) {
+            // the lines after it may depend on what changed, which the next update no longer knows
+            for (auto &line: std::span(m_Lines).subspan(i)) {
+                line.Encoded = false;
+            }
+            throw;
+        }
+
+        Link();
+        result.Success = !HasErrors();
+        return result;
+    }
+
+    bool IncrementalAssembler::HasErrors() const {
+        return std::ranges::contains(m_Diagnostics, Severity::Error, &Diagnostic::Level);
+    }
+
+    SourceRange IncrementalAssembler::GetRange(size_t index) const {
+        size_t end = index + 1 < m_LineOffsets.size() ? m_LineOffsets[index + 1] : m_Source->GetText().size();
+        return {m_LineOffsets[index], end, {index + 1, 1}};
+    }
+
+    void IncrementalAssembler::ScanLine(size_t index) {
+        auto &line = m_Lines[index];
+        line.Tokens.clear();
+        line.Span.reset();
+        line.State = false;
+        line.Placement = false;
+        line.Encoded = false;
+
+        TokenStream stream(m_Source, GetRange(index));
+        while (auto token = stream.ParseToken()) {
+            if (!line.Span) {
+                line.Span = token->Span;
+            }
+            line.Span->End = token->Span.End;
+            line.Tokens.emplace_back(token->Text);
+        }
+
+        const auto &directives = m_Compiler.GetChunkingDirectives();
+        if (!directives)
+            return;
+        size_t statement = GetStatementIndex(line.Tokens);
+        if (statement >= line.Tokens.size())
+            return;
+        if (auto opcode = m_Compiler.GetMnemonics().Find(line.Tokens[statement])) {
+            line.State = std::ranges::contains(directives->State, *opcode);
+            line.Placement = std::ranges::contains(directives->Placement, *opcode);
+        }
+    }
+
+    void IncrementalAssembler::Link() {
+        size_t wordWidth = m_Compiler.GetImageLayout().WordWidth;
+        BitBuffer bitBuffer;
+        bitBuffer.Reserve(m_Lines.empty() ? m_Prologue.Size() : m_Lines.back().GetBitEnd());
+        AppendBits(bitBuffer, m_Prologue, 0, m_Prologue.Size());
+
+        SourceCompiler sourceCompiler{m_Compiler.CreateSourceCompiler(m_Source)};
+        auto &sink = sourceCompiler.GetDiagnostics();
+        DiagnosticSink diagnostics; // the warnings are kept out of the link, which would print them
+        SymbolTable symbolTable;
+        for (const auto &line: m_Lines) {
+            AppendBits(bitBuffer, line.Bits, 0, line.Bits.Size());
+            uint64_t baseAddress = line.BitBegin / wordWidth;
+            for (const auto &[name, address]: line.Labels) {
+                if (!symbolTable.DefineLabel(name, baseAddress + address)) {
+                    sink.Report(Severity::Error, line.Span, std::format("Label '{}' is already defined", name));
+                }
+            }
+            for (const auto &[name, value]: line.Constants) {
+                if (!symbolTable.DefineConstant(name, value)) {
+                    sink.Report(Severity::Error, line.Span, std::format("Constant '{}' is already defined", name));
+                }
+            }
+            for (const auto &relocation: line.Relocations) {
+                symbolTable.AddRelocation(relocation.Kind, relocation.Symbol, line.BitBegin + relocation.Offset,
+                                          relocation.Width);
+            }
+            for (const auto &diagnostic: line.Diagnostics) {
+                (diagnostic.Level == Severity::Error ? sink : diagnostics).Report(diagnostic);
+            }
+        }
+
+        sourceCompiler.LoadProgram(std::move(bitBuffer), std::move(symbolTable));
+        try {
+            sourceCompiler.Link();
+        } catch (const DiagnosticError &e) {
+            for (const auto &diagnostic: e.GetDiagnostics()) {
+                diagnostics.Report(diagnostic);
+            }
+        }
+        m_Diagnostics = diagnostics.GetSorted();
+        m_Image = std::move(sourceCompiler.GetBitBuffer());
+    }
+}
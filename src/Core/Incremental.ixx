@@ -0,0 +1,104 @@
+export module Core.Incremental;
+
+import std;
+import Core.Compiler;
+import Core.Parser;
+import Core.BitBuffer;
+import Core.SymbolTable;
+import Core.SourceBuffer;
+import Core.Diagnostics;
+
+namespace Core::Incremental {
+    // A relocation of one line, its offset relative to the line's first bit.
+    export struct LineRelocation {
+        std::string Symbol;
+        uint64_t Offset = 0;
+        uint16_t Width = 0;
+        RelocationKind Kind = RelocationKind::Address;
+    };
+
+    // What one source line compiled to, as of the last update.
+    export struct SourceLine {
+        std::string Text;                   // without the line break
+        std::vector<std::string> Tokens;    // every token of it, what a change of a symbol is looked up in
+        std::optional<SourceSpan> Span;     // from its first token to its last, none without tokens
+        uint64_t BitBegin = 0;              // its bits in the image
+        BitBuffer Bits;
+        std::vector<std::pair<std::string, uint64_t>> Labels;    // defined here, word address relative to the line
+        std::vector<std::pair<std::string, uint64_t>> Constants; // defined here, with their values
+        std::vector<LineRelocation> Relocations;
+        std::vector<Diagnostic> Diagnostics; // of encoding it, the link's are in GetDiagnostics only
+        bool State = false;     // a state directive, e.g. NAMEREG
+        bool Placement = false; // a placement directive, e.g. ADDRESS
+        bool Encoded = false;
+
+        [[nodiscard]] uint64_t GetBitEnd() const {
+            return BitBegin + Bits.Size();
+        }
+    };
+
+    export struct UpdateResult {
+        std::vector<size_t> EncodedLines; // 1-based, in source order
+        bool Success = false;             // no errors in the encode or the link
+    };
+
+    // Keeps a source assembled while it is edited, for editors and language servers that show the machine
+    // code and the errors of every keystroke. Each update diffs the new text against the last one by line,
+    // and encodes again only the lines that changed and the lines after them that depend on what changed:
+    // lines using a name whose label or constant appeared, disappeared or changed its value, lines using an
+    // operand of a changed state directive (a NAMEREG alias), and placed code whose position moved. Every
+    // other line keeps its bits, labels and relocations and only moves; the whole program is then linked
+    // again, which is cheap next to running the handlers.
+    //
+    // A run of lines to encode starts as a chunk of Chunked::CompileChunked does: it replays the state
+    // directives before it and sees the labels and constants of the lines before it, so a line encodes
+    // exactly as in a full compile. The run then goes on to the end: lines that keep their encoding are
+    // replayed into it, which is cheaper than setting up another. Languages without a 'ParallelAssembly'
+    // section name no state directives, so every update of those encodes all lines again.
+    //
+    // The Compiler must outlive it, and its handlers must not be used from another thread meanwhile.
+    export class IncrementalAssembler {
+    public:
+        explicit IncrementalAssembler(const Compiler &compiler);
+
+        // Replaces the whole text, as an editor sends it after each change.
+        UpdateResult Update(std::string text);
+
+        [[nodiscard]] std::span<const SourceLine> GetLines() const {
+            return m_Lines;
+        }
+
+        // The linked image, only partially patched if the link failed.
+        [[nodiscard]] const BitBuffer &GetImage() const {
+            return m_Image;
+        }
+
+        // Of every line and the link, sorted by location.
+        [[nodiscard]] std::span<const Diagnostic> GetDiagnostics() const {
+            return m_Diagnostics;
+        }
+
+        [[nodiscard]] bool HasErrors() const;
+
+    private:
+        // Encodes lines one after another in a SourceCompiler set up for the first of them, and replays the
+        // lines in between.
+        class EncodeRun;
+
+        [[nodiscard]] SourceRange GetRange(size_t index) const;
+
+        // Lexes a line that changed, without running any handler, for its tokens and what kind of directive
+        // it is.
+        void ScanLine(size_t index);
+
+        void Link();
+
+        const Compiler &m_Compiler;
+        std::shared_ptr<const SourceBuffer> m_Source;
+        std::vector<size_t> m_LineOffsets;
+        std::vector<SourceLine> m_Lines;
+        BitBuffer m_Prologue; // what the before-compile event writes, ahead of the first line
+        BitBuffer m_Image;
+        std::vector<Diagnostic> m_Diagnostics;
+    };
+}
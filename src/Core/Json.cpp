@@ -0,0 +1,30 @@
+module Core.Json;
+
+import std;
+
+namespace Core::Json {
+    void AppendEscapedString(std::string &output, std::string_view value) {
+        constexpr std::string_view hexDigits = "0123456789abcdef";
+        output += '"';
+        for (char c: value) {
+            switch (c) {
+                case '"': output += "\\\""; break;
+                case '\\': output += "\\\\"; break;
+                case '\n': output += "\\n"; break;
+                case '\r': output += "\\r"; break;
+                case '\t': output += "\\t"; break;
+                case '\b': output += "\\b"; break;
+                case '\f': output += "\\f"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        output += "\\u00";
+                        output += hexDigits[(c >> 4) & 0xF];
+                        output += hexDigits[c & 0xF];
+                    } else {
+                        output += c;
+                    }
+            }
+        }
+        output += '"';
+    }
+}
@@ -0,0 +1,112 @@
+export module Core.Json;
+
+import std;
+
+namespace Core::Json {
+    export void AppendEscapedString(std::string &output, std::string_view value);
+
+    // Minimal streaming JSON writer, commas between members and elements are inserted automatically.
+    export class JsonWriter {
+    public:
+        JsonWriter &BeginObject() {
+            BeforeValue();
+            m_Output += '{';
+            m_NeedsComma.push_back(false);
+            return *this;
+        }
+
+        JsonWriter &EndObject() {
+            m_NeedsComma.pop_back();
+            m_Output += '}';
+            return *this;
+        }
+
+        JsonWriter &BeginArray() {
+            BeforeValue();
+            m_Output += '[';
+            m_NeedsComma.push_back(false);
+            return *this;
+        }
+
+        JsonWriter &EndArray() {
+            m_NeedsComma.pop_back();
+            m_Output += ']';
+            return *this;
+        }
+
+        JsonWriter &Key(std::string_view key) {
+            BeforeValue();
+            AppendEscapedString(m_Output, key);
+            m_Output += ':';
+            m_AfterKey = true;
+            return *this;
+        }
+
+        JsonWriter &String(std::string_view value) {
+            BeforeValue();
+            AppendEscapedString(m_Output, value);
+            return *this;
+        }
+
+        JsonWriter &Number(std::integral auto value) {
+            BeforeValue();
+            m_Output += std::to_string(value);
+            return *this;
+        }
+
+        JsonWriter &Number(double value) {
+            BeforeValue();
+            m_Output += std::format("{}", std::isfinite(value) ? value : 0.0);
+            return *this;
+        }
+
+        JsonWriter &Bool(bool value) {
+            BeforeValue();
+            m_Output += value ? "true" : "false";
+            return *this;
+        }
+
+        JsonWriter &Null() {
+            BeforeValue();
+            m_Output += "null";
+            return *this;
+        }
+
+        template<typename Value>
+        JsonWriter &Member(std::string_view key, const Value &value) {
+            Key(key);
+            if constexpr (std::is_same_v<Value, bool>) {
+                return Bool(value);
+            } else if constexpr (std::is_arithmetic_v<Value>) {
+                return Number(value);
+            } else {
+                return String(value);
+            }
+        }
+
+        [[nodiscard]] const std::string &GetOutput() const {
+            return m_Output;
+        }
+
+        [[nodiscard]] std::string TakeOutput() {
+            return std::move(m_Output);
+        }
+
+    private:
+        void BeforeValue() {
+            if (m_AfterKey) {
+                m_AfterKey = false;
+                return;
+            }
+            if (!m_NeedsComma.empty()) {
+                if (m_NeedsComma.back())
+                    m_Output += ',';
+                m_NeedsComma.back() = true;
+            }
+        }
+
+        std::string m_Output;
+        std::vector<bool> m_NeedsComma;
+        bool m_AfterKey = false;
+    };
+}
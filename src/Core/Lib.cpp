@@ -21,4 +21,10 @@ namespace Core::Lib {
                                [](unsigned char c) { return std::toupper(c); });
         return str;
     }
+
+    bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+        return std::ranges::equal(lhs, rhs, [](unsigned char l, unsigned char r) {
+            return std::tolower(l) == std::tolower(r);
+        });
+    }
 }
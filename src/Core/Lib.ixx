@@ -8,4 +8,6 @@ namespace Core::Lib {
 
     export std::string ToLowerCase(std::string str);
     export std::string ToUpperCase(std::string str);
+
+    export bool EqualsIgnoreCase(std::string_view lhs, std::string_view rhs);
 }
@@ -0,0 +1,94 @@
+module;
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+module Core.MappedFile;
+
+import std;
+
+namespace Core {
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::filesystem::path &path) {
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error(std::format("Failed to open '{}'", path.string()));
+        }
+
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            throw std::runtime_error(std::format("Failed to get the size of '{}'", path.string()));
+        }
+        if (size.QuadPart == 0) {
+            CloseHandle(file);
+            return;
+        }
+
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping) {
+            throw std::runtime_error(std::format("Failed to map '{}'", path.string()));
+        }
+        void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping); // the view keeps the mapping alive
+        if (!view) {
+            throw std::runtime_error(std::format("Failed to map '{}'", path.string()));
+        }
+
+        m_Data = static_cast<const char *>(view);
+        m_Size = static_cast<size_t>(size.QuadPart);
+    }
+
+    void MappedFile::Unmap() noexcept {
+        if (m_Data) {
+            UnmapViewOfFile(m_Data);
+            m_Data = nullptr;
+            m_Size = 0;
+        }
+    }
+#else
+    MappedFile::MappedFile(const std::filesystem::path &path) {
+        int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0) {
+            throw std::runtime_error(std::format("Failed to open '{}'", path.string()));
+        }
+
+        struct stat status{};
+        if (fstat(file, &status) != 0) {
+            close(file);
+            throw std::runtime_error(std::format("Failed to get the size of '{}'", path.string()));
+        }
+        if (status.st_size == 0) {
+            close(file);
+            return;
+        }
+
+        void *view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file); // the mapping keeps the file alive
+        if (view == MAP_FAILED) {
+            throw std::runtime_error(std::format("Failed to map '{}'", path.string()));
+        }
+
+        m_Data = static_cast<const char *>(view);
+        m_Size = static_cast<size_t>(status.st_size);
+    }
+
+    void MappedFile::Unmap() noexcept {
+        if (m_Data) {
+            munmap(const_cast<char *>(m_Data), m_Size);
+            m_Data = nullptr;
+            m_Size = 0;
+        }
+    }
+#endif
+}
@@ -0,0 +1,46 @@
+export module Core.MappedFile;
+
+import std;
+
+namespace Core {
+    // A whole file mapped read-only into memory. The view stays valid until the MappedFile is destroyed
+    // or moved from; an empty file maps to an empty view.
+    export class MappedFile {
+    public:
+        explicit MappedFile(const std::filesystem::path &path);
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        MappedFile(MappedFile &&other) noexcept
+            : m_Data(std::exchange(other.m_Data, nullptr)), m_Size(std::exchange(other.m_Size, 0)) {}
+
+        MappedFile &operator=(MappedFile &&other) noexcept {
+            if (this != &other) {
+                Unmap();
+                m_Data = std::exchange(other.m_Data, nullptr);
+                m_Size = std::exchange(other.m_Size, 0);
+            }
+            return *this;
+        }
+
+        ~MappedFile() {
+            Unmap();
+        }
+
+        [[nodiscard]] std::string_view GetView() const {
+            return {m_Data, m_Size};
+        }
+
+        [[nodiscard]] size_t Size() const {
+            return m_Size;
+        }
+
+    private:
+        void Unmap() noexcept;
+
+        const char *m_Data = nullptr;
+        size_t m_Size = 0;
+    };
+}
@@ -0,0 +1,72 @@
+module Core.MnemonicTable;
+
+import std;
+
+namespace Core {
+    namespace {
+        constexpr char FoldCase(char c) noexcept {
+            return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+    }
+
+    MnemonicTable::MnemonicTable(std::vector<std::string> mnemonics) {
+        for (auto &mnemonic: mnemonics) {
+            std::ranges::transform(mnemonic, mnemonic.begin(), FoldCase);
+        }
+        std::ranges::sort(mnemonics);
+        auto [first, last] = std::ranges::unique(mnemonics);
+        mnemonics.erase(first, last);
+
+        m_Names = std::move(mnemonics);
+        for (const auto &name: m_Names) {
+            m_MaxLength = std::max(m_MaxLength, name.size());
+        }
+
+        // a few hundred seeds at twice the key count practically always succeed, grow the table if not
+        for (size_t slotCount = std::bit_ceil(std::max<size_t>(m_Names.size() * 2, 1));; slotCount *= 2) {
+            for (uint32_t seed = 1; seed <= 1024; ++seed) {
+                if (TryBuildSlots(slotCount, seed))
+                    return;
+            }
+        }
+    }
+
+    std::optional<OpcodeId> MnemonicTable::Find(std::string_view token) const noexcept {
+        if (m_Names.empty() || token.size() > m_MaxLength)
+            return std::nullopt;
+
+        OpcodeId id = m_Slots[Hash(token, m_Seed) & m_Mask];
+        if (id == EmptySlot)
+            return std::nullopt;
+
+        const auto &name = m_Names[id];
+        bool equal = std::ranges::equal(name, token, {}, {}, FoldCase);
+        return equal ? std::optional{id} : std::nullopt;
+    }
+
+    uint32_t MnemonicTable::Hash(std::string_view text, uint32_t seed) noexcept {
+        uint32_t hash = 2166136261u ^ seed; // FNV-1a
+        for (char c: text) {
+            hash ^= static_cast<uint8_t>(FoldCase(c));
+            hash *= 16777619u;
+        }
+        return hash ^ (hash >> 15);
+    }
+
+    bool MnemonicTable::TryBuildSlots(size_t slotCount, uint32_t seed) {
+        std::vector<OpcodeId> slots(slotCount, EmptySlot);
+        auto mask = static_cast<uint32_t>(slotCount - 1);
+
+        for (OpcodeId id = 0; id < m_Names.size(); ++id) {
+            auto &slot = slots[Hash(m_Names[id], seed) & mask];
+            if (slot != EmptySlot)
+                return false;
+            slot = id;
+        }
+
+        m_Slots = std::move(slots);
+        m_Seed = seed;
+        m_Mask = mask;
+        return true;
+    }
+}
@@ -0,0 +1,40 @@
+export module Core.MnemonicTable;
+
+import std;
+
+namespace Core {
+    export using OpcodeId = uint32_t;
+
+    // Case-insensitive set of the language's mnemonics with dense IDs. Lookup is a perfect hash over the
+    // fixed set followed by one comparison, so it neither allocates nor probes.
+    export class MnemonicTable {
+    public:
+        MnemonicTable() = default;
+
+        // IDs follow the sorted, lower-cased and deduplicated mnemonics.
+        explicit MnemonicTable(std::vector<std::string> mnemonics);
+
+        [[nodiscard]] std::optional<OpcodeId> Find(std::string_view token) const noexcept;
+
+        [[nodiscard]] size_t Size() const noexcept {
+            return m_Names.size();
+        }
+
+        [[nodiscard]] const std::string &GetName(OpcodeId id) const {
+            return m_Names.at(id);
+        }
+
+    private:
+        static constexpr OpcodeId EmptySlot = std::numeric_limits<OpcodeId>::max();
+
+        static uint32_t Hash(std::string_view text, uint32_t seed) noexcept;
+
+        bool TryBuildSlots(size_t slotCount, uint32_t seed);
+
+        std::vector<std::string> m_Names;
+        std::vector<OpcodeId> m_Slots;
+        uint32_t m_Seed = 0;
+        uint32_t m_Mask = 0;
+        size_t m_MaxLength = 0;
+    };
+}
@@ -0,0 +1,275 @@
+module Core.Object;
+
+import std;
+import Core.BitBuffer;
+import Core.SymbolTable;
+import Core.MappedFile;
+import Core.Exceptions;
+
+namespace Core::Object {
+    namespace {
+        constexpr std::string_view objectMagic = "EASMOBJT";
+        constexpr uint32_t objectVersion = 1;
+
+        constexpr size_t headerSize = 72;
+        constexpr size_t symbolRecordSize = 32;
+        constexpr size_t relocationRecordSize = 16;
+
+        constexpr uint32_t symbolHasAddress = 1;
+        constexpr uint32_t symbolHasValue = 2;
+
+        template<std::unsigned_integral Integer>
+        void AppendInteger(std::string &output, Integer value) {
+            for (size_t i = 0; i < sizeof(Integer); ++i) {
+                output += static_cast<char>((value >> (8 * i)) & 0xFF); // little endian
+            }
+        }
+
+        void PadToAlignment(std::string &output) {
+            output.resize((output.size() + 7) / 8 * 8, '\0');
+        }
+
+        template<std::unsigned_integral Integer>
+        Integer LoadInteger(std::string_view data, size_t offset) {
+            Integer value = 0;
+            for (size_t i = 0; i < sizeof(Integer); ++i) {
+                value |= static_cast<Integer>(static_cast<uint8_t>(data[offset + i])) << (8 * i);
+            }
+            return value;
+        }
+
+        std::string DisplayName(const std::filesystem::path &path) {
+            return path.filename().string();
+        }
+    }
+
+    void WriteObjectFile(const BitBuffer &bitBuffer, const SymbolTable &symbolTable, size_t wordWidth,
+                         const std::filesystem::path &path) {
+        std::string strings;
+        std::string symbols;
+        for (SymbolId id = 0; id < symbolTable.GetSymbolCount(); ++id) {
+            const auto &name = symbolTable.GetName(id);
+            const auto &definition = symbolTable.GetDefinition(id);
+            uint32_t flags = (definition.Address ? symbolHasAddress : 0) | (definition.Value ? symbolHasValue : 0);
+
+            AppendInteger<uint32_t>(symbols, static_cast<uint32_t>(strings.size()));
+            AppendInteger<uint32_t>(symbols, static_cast<uint32_t>(name.size()));
+            AppendInteger<uint32_t>(symbols, flags);
+            AppendInteger<uint32_t>(symbols, 0);
+            AppendInteger<uint64_t>(symbols, definition.Address.value_or(0));
+            AppendInteger<uint64_t>(symbols, definition.Value.value_or(0));
+            strings += name;
+        }
+
+        std::string relocations;
+        for (const auto &relocation: symbolTable.GetRelocations()) {
+            AppendInteger<uint64_t>(relocations, relocation.Offset);
+            AppendInteger<uint32_t>(relocations, relocation.Symbol);
+            AppendInteger<uint16_t>(relocations, relocation.Width);
+            AppendInteger<uint8_t>(relocations, static_cast<uint8_t>(relocation.Kind));
+            AppendInteger<uint8_t>(relocations, 0);
+        }
+
+        auto words = bitBuffer.GetWords();
+        uint64_t wordsOffset = headerSize;
+        uint64_t symbolsOffset = wordsOffset + words.size() * sizeof(uint64_t);
+        uint64_t relocationsOffset = symbolsOffset + symbols.size();
+        uint64_t stringsOffset = relocationsOffset + relocations.size();
+
+        std::string data(objectMagic);
+        AppendInteger<uint32_t>(data, objectVersion);
+        AppendInteger<uint32_t>(data, static_cast<uint32_t>(wordWidth));
+        AppendInteger<uint64_t>(data, bitBuffer.Size());
+        AppendInteger<uint32_t>(data, static_cast<uint32_t>(symbolTable.GetSymbolCount()));
+        AppendInteger<uint32_t>(data, static_cast<uint32_t>(symbolTable.GetRelocations().size()));
+        AppendInteger<uint64_t>(data, wordsOffset);
+        AppendInteger<uint64_t>(data, symbolsOffset);
+        AppendInteger<uint64_t>(data, relocationsOffset);
+        AppendInteger<uint64_t>(data, stringsOffset);
+        AppendInteger<uint64_t>(data, strings.size());
+
+        data.reserve(stringsOffset + strings.size());
+        for (uint64_t word: words) {
+            AppendInteger<uint64_t>(data, word);
+        }
+        data += symbols;
+        data += relocations;
+        data += strings;
+        PadToAlignment(data);
+
+        // write next to the target and rename, so a concurrent link never maps half an object
+        auto temporaryPath = path;
+        temporaryPath += ".tmp";
+        {
+            std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+            output.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (!output) {
+                throw std::runtime_error(std::format("Failed to write object file '{}'", temporaryPath.string()));
+            }
+        }
+        std::filesystem::rename(temporaryPath, path);
+    }
+
+    ObjectFile::ObjectFile(const std::filesystem::path &path)
+        : m_Path(path), m_File(path) {
+        auto data = m_File.GetView();
+        auto fail = [&](std::string_view reason) {
+            return std::runtime_error(std::format("Object file '{}' {}", path.string(), reason));
+        };
+
+        if (data.size() < headerSize || data.substr(0, objectMagic.size()) != objectMagic) {
+            throw fail("is not an object file");
+        }
+        if (auto version = LoadInteger<uint32_t>(data, 8); version != objectVersion) {
+            throw fail(std::format("has unsupported version {}, recompile it", version));
+        }
+
+        m_WordWidth = LoadInteger<uint32_t>(data, 12);
+        m_BitCount = LoadInteger<uint64_t>(data, 16);
+        m_SymbolCount = LoadInteger<uint32_t>(data, 24);
+        m_RelocationCount = LoadInteger<uint32_t>(data, 28);
+
+        // offsets and sizes are checked against the file before any view is taken
+        auto section = [&](size_t offsetField, uint64_t size) {
+            uint64_t offset = LoadInteger<uint64_t>(data, offsetField);
+            if (offset > data.size() || size > data.size() - offset) {
+                throw fail("is truncated");
+            }
+            return data.substr(offset, size);
+        };
+        uint64_t wordCount = (m_BitCount + BitBuffer::WordBits - 1) / BitBuffer::WordBits;
+        if (wordCount > data.size()) {
+            throw fail("is truncated");
+        }
+        m_Words = section(32, wordCount * sizeof(uint64_t));
+        m_Symbols = section(40, uint64_t{m_SymbolCount} * symbolRecordSize);
+        m_Relocations = section(48, uint64_t{m_RelocationCount} * relocationRecordSize);
+        m_Strings = section(56, LoadInteger<uint64_t>(data, 64));
+
+        for (size_t i = 0; i < m_SymbolCount; ++i) {
+            size_t record = i * symbolRecordSize;
+            uint64_t nameOffset = LoadInteger<uint32_t>(m_Symbols, record);
+            uint64_t nameLength = LoadInteger<uint32_t>(m_Symbols, record + 4);
+            if (nameOffset + nameLength > m_Strings.size()) {
+                throw fail("has a symbol name outside its string table");
+            }
+        }
+        for (size_t i = 0; i < m_RelocationCount; ++i) {
+            auto relocation = GetRelocation(i);
+            if (relocation.Symbol >= m_SymbolCount || relocation.Width == 0 ||
+                relocation.Width > BitBuffer::WordBits || relocation.Offset + relocation.Width > m_BitCount ||
+                relocation.Kind > RelocationKind::Constant) {
+                throw fail("has an invalid relocation");
+            }
+        }
+    }
+
+    uint64_t ObjectFile::GetWord(size_t index) const {
+        return LoadInteger<uint64_t>(m_Words, index * sizeof(uint64_t));
+    }
+
+    ObjectSymbol ObjectFile::GetSymbol(size_t index) const {
+        size_t record = index * symbolRecordSize;
+        uint32_t flags = LoadInteger<uint32_t>(m_Symbols, record + 8);
+
+        ObjectSymbol symbol;
+        symbol.Name = m_Strings.substr(LoadInteger<uint32_t>(m_Symbols, record),
+                                       LoadInteger<uint32_t>(m_Symbols, record + 4));
+        if (flags & symbolHasAddress) {
+            symbol.Definition.Address = LoadInteger<uint64_t>(m_Symbols, record + 16);
+        }
+        if (flags & symbolHasValue) {
+            symbol.Definition.Value = LoadInteger<uint64_t>(m_Symbols, record + 24);
+        }
+        return symbol;
+    }
+
+    Relocation ObjectFile::GetRelocation(size_t index) const {
+        size_t record = index * relocationRecordSize;
+        return {
+            LoadInteger<uint64_t>(m_Relocations, record),
+            LoadInteger<uint32_t>(m_Relocations, record + 8),
+            LoadInteger<uint16_t>(m_Relocations, record + 12),
+            static_cast<RelocationKind>(LoadInteger<uint8_t>(m_Relocations, record + 14))
+        };
+    }
+
+    void MergeObjects(std::span<const ObjectFile> objects, size_t wordWidth,
+                      BitBuffer &bitBuffer, SymbolTable &symbolTable) {
+        std::vector<std::string> problems;
+        std::unordered_map<SymbolId, size_t> labelOwners; // for naming both objects of a duplicate label
+
+        uint64_t totalBits = 0;
+        for (const auto &object: objects) {
+            totalBits += object.GetBitCount();
+        }
+        bitBuffer.Reserve(bitBuffer.Size() + totalBits);
+
+        for (size_t objectIndex = 0; objectIndex < objects.size(); ++objectIndex) {
+            const auto &object = objects[objectIndex];
+            if (object.GetWordWidth() != wordWidth) {
+                problems.push_back(std::format("'{}' was compiled for {}-bit words, the language uses {}",
+                                               DisplayName(object.GetPath()), object.GetWordWidth(), wordWidth));
+                continue;
+            }
+            if (object.GetBitCount() % wordWidth != 0) {
+                problems.push_back(std::format("'{}' does not end on a word boundary",
+                                               DisplayName(object.GetPath())));
+                continue;
+            }
+
+            uint64_t baseBit = bitBuffer.Size();
+            uint64_t baseAddress = baseBit / wordWidth;
+            for (uint64_t remaining = object.GetBitCount(), word = 0; remaining != 0; ++word) {
+                size_t bits = std::min<uint64_t>(remaining, BitBuffer::WordBits);
+                bitBuffer.PushBits(object.GetWord(word), bits);
+                remaining -= bits;
+            }
+
+            std::vector<SymbolId> localToMerged(object.GetSymbolCount());
+            for (size_t i = 0; i < object.GetSymbolCount(); ++i) {
+                auto symbol = object.GetSymbol(i);
+                auto id = symbolTable.Intern(symbol.Name);
+                localToMerged[i] = id;
+
+                if (auto address = symbol.Definition.Address) {
+                    if (symbolTable.DefineLabel(symbol.Name, baseAddress + *address)) {
+                        labelOwners.emplace(id, objectIndex);
+                    } else {
+                        auto owner = labelOwners.find(id);
+                        problems.push_back(std::format(
+                            "label '{}' is defined in both '{}' and '{}'", symbol.Name,
+                            owner != labelOwners.end() ? DisplayName(objects[owner->second].GetPath()) : "?",
+                            DisplayName(object.GetPath())));
+                    }
+                }
+                if (auto value = symbol.Definition.Value) {
+                    auto existing = symbolTable.GetDefinition(id).Value;
+                    if (!existing) {
+                        symbolTable.DefineConstant(symbol.Name, *value);
+                    } else if (*existing != *value) {
+                        problems.push_back(std::format("constant '{}' is {} in '{}' but {} in an earlier object",
+                                                       symbol.Name, *value, DisplayName(object.GetPath()),
+                                                       *existing));
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < object.GetRelocationCount(); ++i) {
+                auto relocation = object.GetRelocation(i);
+                symbolTable.AddRelocation(relocation.Kind, localToMerged[relocation.Symbol],
+                                          baseBit + relocation.Offset, relocation.Width);
+            }
+        }
+
+        if (problems.empty())
+            return;
+
+        std::string message = std::format("Link Error: {} problem{} while merging objects:",
+                                          problems.size(), problems.size() == 1 ? "" : "s");
+        for (const auto &problem: problems) {
+            message += "\n  " + problem;
+        }
+        throw Exceptions::LinkError(message);
+    }
+}
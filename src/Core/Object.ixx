@@ -0,0 +1,81 @@
+export module Core.Object;
+
+import std;
+import Core.BitBuffer;
+import Core.SymbolTable;
+import Core.MappedFile;
+
+namespace Core::Object {
+    export constexpr std::string_view ObjectFileExtension = ".eo";
+
+    export struct ObjectSymbol {
+        std::string_view Name;
+        SymbolDefinition Definition;
+    };
+
+    // Writes a compiled but unlinked source: the packed bit buffer, every label (as an address relative to
+    // the start of the object, in words) and constant, and every pending relocation.
+    //
+    // Layout, all integers little endian and every section 8-byte aligned:
+    //   header      magic, version, word width, bit count, symbol and relocation counts, section offsets
+    //   words       the bit buffer, 64-bit words, LSB first
+    //   symbols     32 bytes each: name offset, name length, flags, address, value
+    //   relocations 16 bytes each: bit offset, symbol index, width, kind
+    //   strings     symbol names, referenced by offset and length
+    export void WriteObjectFile(const BitBuffer &bitBuffer, const SymbolTable &symbolTable, size_t wordWidth,
+                                const std::filesystem::path &path);
+
+    // A mapped object file. Sections are validated once when opened and then read in place, without
+    // copying the file into memory.
+    export class ObjectFile {
+    public:
+        explicit ObjectFile(const std::filesystem::path &path);
+
+        [[nodiscard]] const std::filesystem::path &GetPath() const {
+            return m_Path;
+        }
+
+        [[nodiscard]] size_t GetWordWidth() const {
+            return m_WordWidth;
+        }
+
+        [[nodiscard]] uint64_t GetBitCount() const {
+            return m_BitCount;
+        }
+
+        [[nodiscard]] uint64_t GetWord(size_t index) const;
+
+        [[nodiscard]] size_t GetSymbolCount() const {
+            return m_SymbolCount;
+        }
+
+        [[nodiscard]] ObjectSymbol GetSymbol(size_t index) const;
+
+        [[nodiscard]] size_t GetRelocationCount() const {
+            return m_RelocationCount;
+        }
+
+        // The symbol of the relocation is an index into this object's symbols.
+        [[nodiscard]] Relocation GetRelocation(size_t index) const;
+
+    private:
+        std::filesystem::path m_Path;
+        MappedFile m_File;
+        size_t m_WordWidth = 0;
+        uint64_t m_BitCount = 0;
+        size_t m_SymbolCount = 0;
+        size_t m_RelocationCount = 0;
+        std::string_view m_Words;
+        std::string_view m_Symbols;
+        std::string_view m_Relocations;
+        std::string_view m_Strings;
+    };
+
+    // Places the objects one after another in the given order and merges them into one program: the bit
+    // buffers are concatenated, labels are moved by the address their object starts at, constants are
+    // shared (a constant may be defined by several objects if they agree on its value) and relocations
+    // are moved with their object. The relocations are left for SymbolTable::Link to apply. Duplicate
+    // labels, conflicting constants and objects of another word width are reported in one LinkError.
+    export void MergeObjects(std::span<const ObjectFile> objects, size_t wordWidth,
+                             BitBuffer &bitBuffer, SymbolTable &symbolTable);
+}
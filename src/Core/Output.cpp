@@ -0,0 +1,389 @@
+module Core.Output;
+
+import std;
+import Core.BitBuffer;
+import Core.Exceptions;
+import Core.Lib;
+
+namespace Core::Output {
+    std::optional<OutputFormat> ParseOutputFormat(std::string_view name) {
+        auto lower = Lib::ToLowerCase(std::string(name));
+        if (lower == "mem")
+            return OutputFormat::Mem;
+        if (lower == "hex" || lower == "ihex")
+            return OutputFormat::IntelHex;
+        if (lower == "bin")
+            return OutputFormat::Binary;
+        if (lower == "coe")
+            return OutputFormat::Coe;
+        if (lower == "vhd" || lower == "vhdl")
+            return OutputFormat::Vhdl;
+        if (lower == "v" || lower == "verilog")
+            return OutputFormat::Verilog;
+        return std::nullopt;
+    }
+
+    std::string_view GetFileExtension(OutputFormat format) {
+        switch (format) {
+            case OutputFormat::Mem: return ".mem";
+            case OutputFormat::IntelHex: return ".hex";
+            case OutputFormat::Binary: return ".bin";
+            case OutputFormat::Coe: return ".coe";
+            case OutputFormat::Vhdl: return ".vhd";
+            case OutputFormat::Verilog: return ".v";
+        }
+        return ".out";
+    }
+
+    FileSink::FileSink(const std::filesystem::path &path)
+        : m_Stream(path, std::ios::binary | std::ios::trunc), m_Path(path) {
+        if (!m_Stream) {
+            throw std::runtime_error(std::format("Failed to open output file '{}'", path.string()));
+        }
+    }
+
+    void FileSink::Write(std::string_view data) {
+        m_Stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!m_Stream) {
+            throw std::runtime_error(std::format("Failed to write output file '{}'", m_Path.string()));
+        }
+    }
+
+    void BufferedWriter::Put(std::string_view text) {
+        if (text.size() >= BufferSize) {
+            Flush();
+            m_Sink.Write(text);
+            return;
+        }
+        std::ranges::copy(text, Reserve(text.size()));
+    }
+
+    void BufferedWriter::PutHex(uint64_t value, size_t digits) {
+        constexpr std::string_view hexDigits = "0123456789ABCDEF";
+        char *out = Reserve(digits);
+        for (size_t i = digits; i > 0; --i) {
+            out[i - 1] = hexDigits[value & 0xF];
+            value >>= 4;
+        }
+    }
+
+    void BufferedWriter::PutBinary(uint64_t value, size_t bits) {
+        char *out = Reserve(bits);
+        for (size_t i = bits; i > 0; --i) {
+            out[i - 1] = (value & 1) ? '1' : '0';
+            value >>= 1;
+        }
+    }
+
+    void BufferedWriter::PutDecimal(uint64_t value) {
+        std::array<char, 20> digits{};
+        auto [end, ec] = std::to_chars(digits.data(), digits.data() + digits.size(), value);
+        Put(std::string_view(digits.data(), end));
+    }
+
+    void BufferedWriter::Flush() {
+        if (m_Used != 0) {
+            m_Sink.Write(std::string_view(m_Buffer.get(), m_Used));
+            m_Used = 0;
+        }
+    }
+
+    void ValidateImage(const BitBuffer &bitBuffer, const ImageLayout &layout) {
+        if (bitBuffer.Size() % layout.WordWidth != 0) {
+            throw Exceptions::CompilerImplementationError(
+                std::format("The number of bits in the instruction buffer is not a multiple of {}.",
+                            layout.WordWidth));
+        }
+
+        if (bitBuffer.Size() > layout.WordWidth * layout.MemoryDepth) {
+            throw Exceptions::CompileError(
+                std::format(
+                    "The number of bits in the instruction buffer exceeds the maximum allowed size of {} * {} bits.",
+                    layout.WordWidth, layout.MemoryDepth));
+        }
+    }
+
+    namespace {
+        size_t HexDigitsFor(size_t bits) {
+            return (bits + 3) / 4;
+        }
+
+        size_t BytesFor(size_t bits) {
+            return (bits + 7) / 8;
+        }
+
+        // Words past the end of the program are emitted as zero so every image covers the whole memory.
+        template<typename Callback>
+        void ForEachWord(const BitBuffer &bitBuffer, const ImageLayout &layout, Callback &&callback) {
+            DispatchWordWidth(layout.WordWidth, [&](auto wordWidth) {
+                bitBuffer.ForEachWord(wordWidth, callback);
+            });
+            for (size_t index = bitBuffer.GetWordCount(layout.WordWidth); index < layout.MemoryDepth; ++index) {
+                callback(index, uint64_t{0});
+            }
+        }
+
+        // Reserved in VHDL-2008 or Verilog-2005, and the names the emitted files declare themselves, in lower case
+        // as VHDL ignores case.
+        constexpr auto hdlReservedWords = std::to_array<std::string_view>({
+            "abs", "access", "address", "after", "alias", "all", "always", "and", "architecture", "array",
+            "assert", "assign", "assume", "assume_guarantee", "attribute", "automatic", "begin", "behavioral",
+            "block", "body", "buf", "buffer", "bufif0", "bufif1", "bus", "case", "casex", "casez", "cell", "clk",
+            "cmos", "component", "config", "configuration", "constant", "context", "cover", "deassign", "default",
+            "defparam", "design", "disable", "disconnect", "downto", "edge", "else", "elsif", "end", "endcase",
+            "endconfig", "endfunction", "endgenerate", "endmodule", "endprimitive", "endspecify", "endtable",
+            "endtask", "entity", "event", "exit", "fairness", "file", "for", "force", "forever", "fork",
+            "function", "generate", "generic", "genvar", "group", "guarded", "highz0", "highz1", "if", "ifnone",
+            "impure", "in", "incdir", "include", "inertial", "initial", "inout", "input", "instance",
+            "instruction", "integer", "is", "join", "label", "large", "liblist", "library", "linkage", "literal",
+            "localparam", "loop", "macromodule", "map", "medium", "mod", "module", "nand", "negedge", "new",
+            "next", "nmos", "nor", "noshowcancelled", "not", "notif0", "notif1", "null", "of", "on", "open", "or",
+            "others", "out", "output", "package", "parameter", "pmos", "port", "posedge", "postponed", "primitive",
+            "procedure", "process", "property", "protected", "pull0", "pull1", "pulldown", "pullup",
+            "pulsestyle_ondetect", "pulsestyle_onevent", "pure", "range", "rcmos", "real", "realtime", "record",
+            "reg", "register", "reject", "release", "rem", "repeat", "report", "restrict", "restrict_guarantee",
+            "return", "rnmos", "rol", "rom", "rom_type", "ror", "rpmos", "rtran", "rtranif0", "rtranif1",
+            "scalared", "select", "sequence", "severity", "shared", "showcancelled", "signal", "signed", "sla",
+            "sll", "small", "specify", "specparam", "sra", "srl", "strong", "strong0", "strong1", "subtype",
+            "supply0", "supply1", "table", "task", "then", "time", "to", "tran", "tranif0", "tranif1", "transport",
+            "tri", "tri0", "tri1", "triand", "trior", "trireg", "type", "unaffected", "units", "unsigned", "until",
+            "use", "uwire", "variable", "vectored", "vmode", "vprop", "vunit", "wait", "wand", "weak0", "weak1",
+            "when", "while", "wire", "with", "wor", "xnor", "xor"
+        });
+        static_assert(std::ranges::is_sorted(hdlReservedWords));
+
+        // A name both VHDL and Verilog accept: letters, digits and single underscores, starting with a letter
+        // and not ending with an underscore.
+        std::string MakeHdlIdentifier(std::string_view name) {
+            std::string identifier;
+            identifier.reserve(name.size() + 1);
+            for (unsigned char c: name) {
+                char next = std::isalnum(c) ? static_cast<char>(c) : '_';
+                if (next != '_' || identifier.empty() || identifier.back() != '_') {
+                    identifier += next;
+                }
+            }
+            while (!identifier.empty() && identifier.back() == '_') {
+                identifier.pop_back();
+            }
+            if (identifier.empty() || !std::isalpha(static_cast<unsigned char>(identifier.front()))) {
+                identifier.insert(identifier.begin(), 'r');
+            }
+            auto isReserved = [](std::string_view candidate) {
+                std::string lower(candidate);
+                std::ranges::transform(lower, lower.begin(), [](unsigned char c) {
+                    return static_cast<char>(std::tolower(c));
+                });
+                return std::ranges::binary_search(hdlReservedWords, lower);
+            };
+            while (isReserved(identifier)) {
+                identifier.insert(identifier.begin(), 'r'); // 'tran' becomes 'rtran', which is reserved too
+            }
+            return identifier;
+        }
+
+        void EmitMem(const BitBuffer &bitBuffer, const ImageLayout &layout, BufferedWriter &writer) {
+            size_t digits = HexDigitsFor(layout.WordWidth);
+            writer.Put("@00000000\n");
+            ForEachWord(bitBuffer, layout, [&](size_t, uint64_t word) {
+                writer.PutHex(word, digits);
+                writer.Put('\n');
+            });
+        }
+
+        class IntelHexRecordWriter {
+        public:
+            static constexpr size_t RecordBytes = 16;
+
+            explicit IntelHexRecordWriter(BufferedWriter &writer) : m_Writer(writer) {}
+
+            void PutByte(uint8_t byte) {
+                if (m_Count == 0 && (m_Address >> 16) != m_UpperAddress) {
+                    m_UpperAddress = m_Address >> 16;
+                    uint8_t upper[2] = {
+                        static_cast<uint8_t>(m_UpperAddress >> 8), static_cast<uint8_t>(m_UpperAddress)
+                    };
+                    WriteRecord(0x04, 0, upper);
+                }
+                m_Record[m_Count++] = byte;
+                if (m_Count == RecordBytes || ((m_Address + m_Count) & 0xFFFF) == 0) {
+                    FlushRecord();
+                }
+            }
+
+            void Finish() {
+                FlushRecord();
+                WriteRecord(0x01, 0, {});
+            }
+
+        private:
+            void FlushRecord() {
+                if (m_Count == 0)
+                    return;
+                WriteRecord(0x00, static_cast<uint16_t>(m_Address & 0xFFFF), std::span(m_Record.data(), m_Count));
+                m_Address += m_Count;
+                m_Count = 0;
+            }
+
+            void WriteRecord(uint8_t type, uint16_t address, std::span<const uint8_t> data) {
+                uint8_t checksum = static_cast<uint8_t>(data.size()) + static_cast<uint8_t>(address >> 8)
+                                   + static_cast<uint8_t>(address) + type;
+                m_Writer.Put(':');
+                m_Writer.PutHex(data.size(), 2);
+                m_Writer.PutHex(address, 4);
+                m_Writer.PutHex(type, 2);
+                for (uint8_t byte: data) {
+                    m_Writer.PutHex(byte, 2);
+                    checksum += byte;
+                }
+                m_Writer.PutHex(static_cast<uint8_t>(-checksum), 2);
+                m_Writer.Put('\n');
+            }
+
+            BufferedWriter &m_Writer;
+            std::array<uint8_t, RecordBytes> m_Record{};
+            size_t m_Count = 0;
+            size_t m_Address = 0;
+            size_t m_UpperAddress = 0;
+        };
+
+        // Words are stored big-endian, each padded up to a whole number of bytes.
+        void EmitIntelHex(const BitBuffer &bitBuffer, const ImageLayout &layout, BufferedWriter &writer) {
+            size_t bytesPerWord = BytesFor(layout.WordWidth);
+            IntelHexRecordWriter records(writer);
+            ForEachWord(bitBuffer, layout, [&](size_t, uint64_t word) {
+                for (size_t i = bytesPerWord; i > 0; --i) {
+                    records.PutByte(static_cast<uint8_t>(word >> (8 * (i - 1))));
+                }
+            });
+            records.Finish();
+        }
+
+        void EmitBinary(const BitBuffer &bitBuffer, const ImageLayout &layout, BufferedWriter &writer) {
+            size_t bytesPerWord = BytesFor(layout.WordWidth);
+            ForEachWord(bitBuffer, layout, [&](size_t, uint64_t word) {
+                for (size_t i = bytesPerWord; i > 0; --i) {
+                    writer.Put(static_cast<char>(static_cast<uint8_t>(word >> (8 * (i - 1)))));
+                }
+            });
+        }
+
+        void EmitCoe(const BitBuffer &bitBuffer, const ImageLayout &layout, BufferedWriter &writer) {
+            size_t digits = HexDigitsFor(layout.WordWidth);
+            writer.Put("memory_initialization_radix=16;\nmemory_initialization_vector=\n");
+            ForEachWord(bitBuffer, layout, [&](size_t index, uint64_t word) {
+                writer.PutHex(word, digits);
+                writer.Put(index + 1 == layout.MemoryDepth ? ";\n" : ",\n");
+            });
+        }
+
+        void EmitVhdl(const BitBuffer &bitBuffer, const ImageLayout &layout, std::string_view imageName,
+                      BufferedWriter &writer) {
+            auto entity = MakeHdlIdentifier(imageName);
+
+            writer.Put(std::format(
+                "library IEEE;\n"
+                "use IEEE.STD_LOGIC_1164.ALL;\n"
+                "use IEEE.NUMERIC_STD.ALL;\n"
+                "\n"
+                "entity {0} is\n"
+                "    port (\n"
+                "        clk         : in  std_logic;\n"
+                "        address     : in  std_logic_vector({1} downto 0);\n"
+                "        instruction : out std_logic_vector({2} downto 0)\n"
+                "    );\n"
+                "end {0};\n"
+                "\n"
+                "architecture Behavioral of {0} is\n"
+                "    type rom_type is array (0 to {3}) of std_logic_vector({2} downto 0);\n"
+                "    constant rom : rom_type := (\n",
+                entity, layout.AddressWidth - 1, layout.WordWidth - 1, layout.MemoryDepth - 1));
+
+            ForEachWord(bitBuffer, layout, [&](size_t index, uint64_t word) {
+                writer.Put("        \"");
+                writer.PutBinary(word, layout.WordWidth);
+                writer.Put(index + 1 == layout.MemoryDepth ? "\"\n" : "\",\n");
+            });
+
+            writer.Put(
+                "    );\n"
+                "begin\n"
+                "    process (clk)\n"
+                "    begin\n"
+                "        if rising_edge(clk) then\n"
+                "            instruction <= rom(to_integer(unsigned(address)));\n"
+                "        end if;\n"
+                "    end process;\n"
+                "end Behavioral;\n");
+        }
+
+        void EmitVerilog(const BitBuffer &bitBuffer, const ImageLayout &layout, std::string_view imageName,
+                         BufferedWriter &writer) {
+            auto module = MakeHdlIdentifier(imageName);
+            size_t digits = HexDigitsFor(layout.WordWidth);
+
+            writer.Put(std::format(
+                "module {0} (\n"
+                "    input  wire clk,\n"
+                "    input  wire [{1}:0] address,\n"
+                "    output reg  [{2}:0] instruction\n"
+                ");\n"
+                "    reg [{2}:0] rom [0:{3}];\n"
+                "\n"
+                "    initial begin\n",
+                module, layout.AddressWidth - 1, layout.WordWidth - 1, layout.MemoryDepth - 1));
+
+            ForEachWord(bitBuffer, layout, [&](size_t index, uint64_t word) {
+                writer.Put("        rom[");
+                writer.PutDecimal(index);
+                writer.Put("] = ");
+                writer.PutDecimal(layout.WordWidth);
+                writer.Put("'h");
+                writer.PutHex(word, digits);
+                writer.Put(";\n");
+            });
+
+            writer.Put(
+                "    end\n"
+                "\n"
+                "    always @(posedge clk)\n"
+                "        instruction <= rom[address];\n"
+                "endmodule\n");
+        }
+    }
+
+    void EmitImage(OutputFormat format,
+                   const BitBuffer &bitBuffer,
+                   const ImageLayout &layout,
+                   std::string_view imageName,
+                   OutputSink &sink) {
+        ValidateImage(bitBuffer, layout);
+
+        BufferedWriter writer(sink);
+        switch (format) {
+            case OutputFormat::Mem: EmitMem(bitBuffer, layout, writer); break;
+            case OutputFormat::IntelHex: EmitIntelHex(bitBuffer, layout, writer); break;
+            case OutputFormat::Binary: EmitBinary(bitBuffer, layout, writer); break;
+            case OutputFormat::Coe: EmitCoe(bitBuffer, layout, writer); break;
+            case OutputFormat::Vhdl: EmitVhdl(bitBuffer, layout, imageName, writer); break;
+            case OutputFormat::Verilog: EmitVerilog(bitBuffer, layout, imageName, writer); break;
+        }
+        writer.Flush();
+    }
+
+    std::vector<std::filesystem::path> WriteImageFiles(std::span<const OutputFormat> formats,
+                                                       const BitBuffer &bitBuffer,
+                                                       const ImageLayout &layout,
+                                                       const std::filesystem::path &outputDir,
+                                                       std::string_view stem) {
+        std::vector<std::filesystem::path> written;
+        written.reserve(formats.size());
+        for (auto format: formats) {
+            auto path = outputDir / (std::string(stem) + std::string(GetFileExtension(format)));
+            FileSink sink(path);
+            EmitImage(format, bitBuffer, layout, stem, sink);
+            written.push_back(std::move(path));
+        }
+        return written;
+    }
+}
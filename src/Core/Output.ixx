@@ -0,0 +1,114 @@
+export module Core.Output;
+
+import std;
+import Core.BitBuffer;
+
+namespace Core::Output {
+    export enum class OutputFormat {
+        Mem,
+        IntelHex,
+        Binary,
+        Coe,
+        Vhdl,
+        Verilog
+    };
+
+    export std::optional<OutputFormat> ParseOutputFormat(std::string_view name);
+
+    export std::string_view GetFileExtension(OutputFormat format);
+
+    export struct ImageLayout {
+        size_t WordWidth = 18;
+        size_t AddressWidth = 10; // of the program memory, at least enough for MemoryDepth
+        size_t MemoryDepth = 1024;
+    };
+
+    export class OutputSink {
+    public:
+        virtual ~OutputSink() = default;
+
+        virtual void Write(std::string_view data) = 0;
+    };
+
+    export class FileSink : public OutputSink {
+    public:
+        explicit FileSink(const std::filesystem::path &path);
+
+        void Write(std::string_view data) override;
+
+    private:
+        std::ofstream m_Stream;
+        std::filesystem::path m_Path;
+    };
+
+    export class StringSink : public OutputSink {
+    public:
+        void Write(std::string_view data) override {
+            m_Output.append(data);
+        }
+
+        std::string &GetOutput() {
+            return m_Output;
+        }
+
+    private:
+        std::string m_Output;
+    };
+
+    // Fixed-size staging buffer in front of an OutputSink, so emitters can format one character
+    // at a time without touching the sink (or allocating) until the buffer fills up.
+    export class BufferedWriter {
+    public:
+        static constexpr size_t BufferSize = 1 << 16;
+
+        explicit BufferedWriter(OutputSink &sink)
+            : m_Sink(sink), m_Buffer(std::make_unique<char[]>(BufferSize)) {}
+
+        BufferedWriter(const BufferedWriter &) = delete;
+        BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+        void Put(char c) {
+            if (m_Used == BufferSize)
+                Flush();
+            m_Buffer[m_Used++] = c;
+        }
+
+        void Put(std::string_view text);
+
+        void PutHex(uint64_t value, size_t digits);
+
+        void PutBinary(uint64_t value, size_t bits);
+
+        void PutDecimal(uint64_t value);
+
+        void Flush();
+
+    private:
+        char *Reserve(size_t count) {
+            if (BufferSize - m_Used < count)
+                Flush();
+            char *result = m_Buffer.get() + m_Used;
+            m_Used += count;
+            return result;
+        }
+
+        OutputSink &m_Sink;
+        std::unique_ptr<char[]> m_Buffer;
+        size_t m_Used = 0;
+    };
+
+    // Checks that the buffer holds a whole number of words that fit in the memory.
+    export void ValidateImage(const BitBuffer &bitBuffer, const ImageLayout &layout);
+
+    export void EmitImage(OutputFormat format,
+                          const BitBuffer &bitBuffer,
+                          const ImageLayout &layout,
+                          std::string_view imageName,
+                          OutputSink &sink);
+
+    export std::vector<std::filesystem::path> WriteImageFiles(std::span<const OutputFormat> formats,
+                                                              const BitBuffer &bitBuffer,
+                                                              const ImageLayout &layout,
+                                                              const std::filesystem::path &outputDir,
+                                                              std::string_view stem);
+}
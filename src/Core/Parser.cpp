@@ -3,80 +3,114 @@ module Core.Parser;
 import <cassert>;
 
 namespace Core {
-    const static std::unordered_set<char> whitespace = {' ', '\t', '\n', '\r'};
-    const static std::unordered_set<char> delimiters = {'(', ')', '{', '}', '[', ']', ',', ';', ':', '\"', '\''};
-
-    std::optional<std::string> TokenStream::ParseCurrent() {
-        if (m_Current == m_Source.end()) {
-            return std::nullopt; // no more tokens
+    namespace {
+        enum CharClass : uint8_t {
+            Whitespace = 1 << 0,
+            NewLine = 1 << 1,
+            Delimiter = 1 << 2,
+            Comment = 1 << 3,
+            Quote = 1 << 4,
+        };
+
+        constexpr std::array<uint8_t, 256> MakeCharClassTable() {
+            std::array<uint8_t, 256> table{};
+            for (unsigned char c: std::string_view(" \t\r\n")) {
+                table[c] |= Whitespace;
+            }
+            table['\n'] |= NewLine;
+            for (unsigned char c: std::string_view("(){}[],;:\"'")) {
+                table[c] |= Delimiter;
+            }
+            table[';'] |= Comment;
+            table['\"'] |= Quote;
+            return table;
         }
 
-        assert(!whitespace.contains(*m_Current) && "Current character should not be whitespace");
-
-        m_IsNewLine = false; // reset newline state
-        m_PreviousNumberOfLines = m_NumberOfLines; // save the previous line count
-
-        if (*m_Current == '\"') {
-            return m_LastToken = ParseString();
-        }
+        constexpr std::array<uint8_t, 256> charClass = MakeCharClassTable();
 
-        if (delimiters.contains(*m_Current)) {
-            std::string delimiter(1, *m_Current); // create a string from the single character
-            ++m_Current; // move past the delimiter
-            SkipToNextToken(); // skip to the next token
-            return delimiter; // return the parsed delimiter
+        bool HasClass(char c, uint8_t mask) {
+            return (charClass[static_cast<unsigned char>(c)] & mask) != 0;
         }
 
-        std::string buffer; // small string optimization should be enough for most tokens
+        constexpr size_t maxDecodedStrings = 2; // the last parsed token and the cached peek
+    }
 
-        while (m_Current != m_Source.end() && !whitespace.contains(*m_Current) && !delimiters.contains(*m_Current)) {
-            buffer += *m_Current;
-            ++m_Current;
-        }
+    std::optional<std::string_view> TokenStream::ParseCurrent() {
+        auto token = ParseToken();
+        if (!token)
+            return std::nullopt;
+        return token->Text;
+    }
 
-        assert(!buffer.empty() && "Buffer should not be empty after parsing a token");
+    std::optional<std::string_view> TokenStream::PeekCurrent() {
+        auto token = PeekToken();
+        if (!token)
+            return std::nullopt;
+        return token->Text;
+    }
 
-        SkipToNextToken();
+    std::optional<Token> TokenStream::ParseToken() {
+        LexResult result = m_Peeked ? std::move(*m_Peeked) : Lex(m_Cursor);
+        m_Peeked.reset();
 
-        return m_LastToken = std::move(buffer); // return the parsed token
+        auto token = result.LexedToken;
+        Commit(std::move(result));
+        return token;
     }
 
-    std::optional<std::string> TokenStream::PeekCurrent() {
-        auto savedCurrent = m_Current; // save the current position
-        auto savedNumberOfLines = m_NumberOfLines; // save the current line count
-        auto savedIsNewLine = m_IsNewLine; // save the current newline state
-        auto savedLastToken = m_LastToken; // save the last token
-        auto savedPreviousNumberOfLines = m_PreviousNumberOfLines; // save the previous line count
-        auto token = ParseCurrent(); // parse the current token
-        m_PreviousNumberOfLines = savedPreviousNumberOfLines; // restore the previous line count
-        m_LastToken = savedLastToken; // restore the last token
-        m_IsNewLine = savedIsNewLine; // restore the newline state
-        m_NumberOfLines = savedNumberOfLines; // restore the line count
-        m_Current = savedCurrent; // restore the current position
-        return token; // return the parsed token
+    std::optional<Token> TokenStream::PeekToken() {
+        // Peeks are cached, so a PeekCurrent followed by ParseCurrent lexes the token only once
+        if (!m_Peeked) {
+            m_Peeked = Lex(m_Cursor);
+        }
+        return m_Peeked->LexedToken;
     }
 
     void TokenStream::SkipCurrent() {
-        // Could find a better way.
-        (void) ParseCurrent(); // simply call ParseCurrent to skip the current token
+        (void) ParseToken();
+    }
+
+    void TokenStream::SkipLine() {
+        while (!m_IsNewLine && PeekToken()) {
+            SkipCurrent();
+        }
+    }
+
+    void TokenStream::Commit(LexResult &&result) {
+        m_Cursor = result.Next;
+        if (!result.LexedToken)
+            return; // no more tokens, or an unterminated string
+
+        m_IsNewLine = result.CrossedNewLine;
+        m_LastToken = std::move(result.LexedToken);
     }
 
     std::string TokenStream::GetApproxCurrentLocation() {
-        // Approximate location is the number of lines and the current position in the source
-        std::optional<std::string> TokenToDisplay = m_LastToken ? m_LastToken : PeekCurrent();
-        if (TokenToDisplay) {
-            return std::format("at line {}, near token '{}'",
-                               m_PreviousNumberOfLines,
-                               *TokenToDisplay);
+        std::optional<Token> tokenToDisplay = m_LastToken ? m_LastToken : PeekToken();
+        if (tokenToDisplay) {
+            return std::format("at line {}, column {}, near token '{}'",
+                               tokenToDisplay->Span.Begin.Line,
+                               tokenToDisplay->Span.Begin.Column,
+                               tokenToDisplay->Text);
         }
-        return std::format("at line {}, no valid token near this place", m_PreviousNumberOfLines);
+        return std::format("at line {}, no valid token near this place", m_Cursor.Line);
+    }
+
+    SourceSpan TokenStream::GetCurrentSpan() {
+        if (m_LastToken)
+            return m_LastToken->Span;
+        if (auto token = PeekToken())
+            return token->Span;
+        auto location = m_Cursor.GetLocation();
+        return {location, location};
     }
 
     std::optional<Exceptions::WrappedGenericException> TokenStream::AssertIsNewLine() {
         if (!m_IsNewLine) {
+            auto next = PeekCurrent();
             return Exceptions::MakeCompilerImplementationError(
                 std::format("Expected a newline at line {}, but found '{}'",
-                            m_NumberOfLines, *m_Current));
+                            m_Cursor.Line, next.value_or("")));
         }
 
         return std::nullopt; // no exception, we are at a newline
@@ -86,66 +120,117 @@ namespace Core {
         m_IsNewLine = isNewLine;
     }
 
-    void TokenStream::SkipWhitespace() {
-        while (m_Current != m_Source.end() && whitespace.contains(*m_Current)) {
-            if (*m_Current == '\n') {
-                ++m_NumberOfLines; // increment line count on newline
-                m_IsNewLine = true; // set newline state
+    bool TokenStream::SkipToNextToken(Cursor &cursor) const {
+        bool crossedNewLine = false;
+        while (cursor.Position < m_Source.size()) {
+            char c = m_Source[cursor.Position];
+            if (HasClass(c, Whitespace)) {
+                if (HasClass(c, NewLine)) {
+                    ++cursor.Line;
+                    cursor.LineStart = cursor.Position + 1;
+                    crossedNewLine = true;
+                }
+                ++cursor.Position;
+            } else if (HasClass(c, Comment)) {
+                // a ';' comments out the rest of the line
+                auto lineEnd = m_Source.find('\n', cursor.Position);
+                cursor.Position = lineEnd == std::string_view::npos ? m_Source.size() : lineEnd;
+            } else {
+                break;
             }
-            ++m_Current;
         }
+        return crossedNewLine;
     }
 
-    void TokenStream::SkipToNextToken() {
-        SkipWhitespace();
-        // detect if a ; is presented, if so, skip to the next line
-        while (m_Current != m_Source.end()) {
-            assert(!whitespace.contains(*m_Current) && "Whitespace should not be present here");
-
-            if (m_Current == m_Source.end() || *m_Current != ';') {
-                return;
-            }
+    TokenStream::LexResult TokenStream::Lex(Cursor from) {
+        LexResult result{std::nullopt, from, false};
+        if (from.Position >= m_Source.size()) {
+            return result; // no more tokens
+        }
 
-            while (m_Current != m_Source.end() && *m_Current != '\n') {
-                ++m_Current;
+        Cursor &cursor = result.Next;
+        SourceLocation begin = cursor.GetLocation();
+        std::optional<std::string_view> text;
+        char first = m_Source[cursor.Position];
+
+        assert(!HasClass(first, Whitespace) && "Current character should not be whitespace");
+
+        if (HasClass(first, Quote)) {
+            text = LexString(cursor);
+        } else if (HasClass(first, Delimiter)) {
+            text = m_Source.substr(cursor.Position, 1);
+            ++cursor.Position;
+        } else {
+            size_t end = cursor.Position;
+            while (end < m_Source.size() && !HasClass(m_Source[end], Whitespace | Delimiter)) {
+                ++end;
             }
+            text = m_Source.substr(cursor.Position, end - cursor.Position);
+            cursor.Position = end;
+        }
 
-            // this should now be at the end of a line
-            SkipWhitespace();
+        if (!text) {
+            return result; // unterminated string, the stream is exhausted
         }
+
+        assert(!text->empty() && "Token should not be empty after lexing");
+
+        result.LexedToken = Token{*text, SourceSpan{begin, cursor.GetLocation()}};
+        result.CrossedNewLine = SkipToNextToken(cursor);
+        return result;
     }
 
-    std::optional<std::string> TokenStream::ParseString() {
-        assert(*m_Current == '\"' && "Current character should be a quote for string parsing");
-        std::string buffer = "\""; // start with the opening quote
-        ++m_Current; // move past the opening quote
-        // parsed string should contain the qoutes
-        while (m_Current != m_Source.end() && *m_Current != '\"') {
-            if (*m_Current == '\\') {
-                // handle escape sequences
-                ++m_Current; // move past the backslash
-                if (m_Current == m_Source.end()) {
-                    return std::nullopt; // unterminated string
-                }
-                switch (*m_Current) {
-                    case 'n': buffer += '\n'; break;
-                    case 't': buffer += '\t'; break;
-                    case '\"': buffer += '\"'; break;
-                    case '\\': buffer += '\\'; break;
-                    default: buffer += *m_Current; break; // just add the character
-                }
-            } else {
-                buffer += *m_Current; // add the character to the buffer
+    std::optional<std::string_view> TokenStream::LexString(Cursor &cursor) {
+        assert(m_Source[cursor.Position] == '\"' && "Current character should be a quote for string parsing");
+        // the token keeps its opening quote but not the closing one
+        size_t start = cursor.Position;
+        size_t current = start + 1;
+        bool hasEscapes = false;
+
+        while (current < m_Source.size() && m_Source[current] != '\"') {
+            if (m_Source[current] == '\\') {
+                hasEscapes = true;
+                ++current;
+                if (current == m_Source.size())
+                    break;
+            }
+            if (m_Source[current] == '\n') {
+                ++cursor.Line;
+                cursor.LineStart = current + 1;
             }
+            ++current;
+        }
 
-            ++m_Current; // move to the next character
+        if (current >= m_Source.size()) {
+            cursor.Position = m_Source.size();
+            return std::nullopt; // unterminated string
         }
 
-        assert(m_Current != m_Source.end() && *m_Current == '\"' && "Current character should be a closing quote for string parsing");
-        ++m_Current; // move past the closing quote
+        cursor.Position = current + 1; // move past the closing quote
+        std::string_view raw = m_Source.substr(start, current - start);
+        if (!hasEscapes) {
+            return raw;
+        }
 
-        SkipToNextToken(); // skip to the next token after the string
+        std::string buffer;
+        buffer.reserve(raw.size());
+        for (size_t i = 0; i < raw.size(); ++i) {
+            if (raw[i] != '\\') {
+                buffer += raw[i];
+                continue;
+            }
+            switch (raw[++i]) {
+                case 'n': buffer += '\n'; break;
+                case 't': buffer += '\t'; break;
+                case '\"': buffer += '\"'; break;
+                case '\\': buffer += '\\'; break;
+                default: buffer += raw[i]; break; // just add the character
+            }
+        }
 
-        return  buffer; // return the parsed string
+        if (m_DecodedStrings.size() >= maxDecodedStrings) {
+            m_DecodedStrings.pop_front();
+        }
+        return m_DecodedStrings.emplace_back(std::move(buffer));
     }
 }
@@ -3,13 +3,50 @@ export module Core.Parser;
 import std;
 import Vendor.sol;
 import Core.Exceptions;
+import Core.SourceBuffer;
 
 namespace Core {
+    export struct SourceLocation {
+        size_t Line = 1;
+        size_t Column = 1;
+    };
+
+    export struct SourceSpan {
+        SourceLocation Begin;
+        SourceLocation End;
+    };
+
+    // A part of a source buffer to lex on its own. Offsets are into the whole buffer, so locations of the
+    // tokens stay those of the whole source.
+    export struct SourceRange {
+        size_t Begin = 0;
+        size_t End = 0;
+        SourceLocation Location; // of Begin
+    };
+
+    // Text views into the source buffer the TokenStream holds, valid as long as the stream is.
+    export struct Token {
+        std::string_view Text;
+        SourceSpan Span;
+    };
+
     export class TokenStream {
     public:
-        TokenStream(const std::string& source)
-            : m_Source(source), m_Current(this->m_Source.begin()) {
-            SkipToNextToken();
+        TokenStream(std::string source)
+            : TokenStream(SourceBuffer::FromString(std::move(source))) {}
+
+        // Lexes the buffer in place, without copying it.
+        explicit TokenStream(std::shared_ptr<const SourceBuffer> source)
+            : m_SourceBuffer(std::move(source)),
+              m_Source(m_SourceBuffer->GetText()) {
+            SkipToNextToken(m_Cursor);
+        }
+
+        TokenStream(std::shared_ptr<const SourceBuffer> source, const SourceRange &range)
+            : m_SourceBuffer(std::move(source)),
+              m_Source(m_SourceBuffer->GetText().substr(0, range.End)),
+              m_Cursor{range.Begin, range.Location.Line, range.Begin - (range.Location.Column - 1)} {
+            SkipToNextToken(m_Cursor);
         }
 
         TokenStream(const TokenStream&) = delete;
@@ -17,21 +54,30 @@ namespace Core {
         TokenStream(TokenStream&&) = default;
         TokenStream& operator=(TokenStream&&) = default;
 
-        std::optional<std::string> ParseCurrent();
-        std::optional<std::string> PeekCurrent();
+        std::optional<std::string_view> ParseCurrent();
+        std::optional<std::string_view> PeekCurrent();
+        std::optional<Token> ParseToken();
+        std::optional<Token> PeekToken();
         void SkipCurrent();
+        // Skips the tokens left on the line of the last parsed one, e.g. to recover after an error in it.
+        void SkipLine();
         std::string GetApproxCurrentLocation();
+        SourceSpan GetCurrentSpan();
         std::optional<Exceptions::WrappedGenericException> AssertIsNewLine();
         void SetNewLine(bool isNewLine);
         bool IsNewLine() const { return m_IsNewLine; }
 
+        const std::shared_ptr<const SourceBuffer> &GetSourceBuffer() const { return m_SourceBuffer; }
+
         static void AddLibToState(sol::state& state) {
             state.new_usertype<TokenStream>("TokenStream",
-                sol::constructors<TokenStream(const std::string&)>(),
+                sol::constructors<TokenStream(std::string)>(),
                 "ParseCurrent", &TokenStream::ParseCurrent,
                 "PeekCurrent", &TokenStream::PeekCurrent,
                 "SkipCurrent", &TokenStream::SkipCurrent,
                 "GetApproxCurrentLocation", &TokenStream::GetApproxCurrentLocation,
+                "GetLine", [](TokenStream& self) { return self.GetCurrentSpan().Begin.Line; },
+                "GetColumn", [](TokenStream& self) { return self.GetCurrentSpan().Begin.Column; },
                 "AssertIsNewLine", &TokenStream::AssertIsNewLine,
                 "SetNewLine", &TokenStream::SetNewLine,
                 "IsNewLine", &TokenStream::IsNewLine
@@ -39,15 +85,34 @@ namespace Core {
         }
 
     private:
-        void SkipWhitespace();
-        void SkipToNextToken();
-        std::optional<std::string> ParseString();
-        std::optional<std::string> m_LastToken;
-
-        std::string m_Source;
-        std::string::const_iterator m_Current;
-        size_t m_NumberOfLines = 1;
-        size_t m_PreviousNumberOfLines = 1;
+        struct Cursor {
+            size_t Position = 0;
+            size_t Line = 1;
+            size_t LineStart = 0;
+
+            SourceLocation GetLocation() const {
+                return {Line, Position - LineStart + 1};
+            }
+        };
+
+        // Result of lexing one token: the token itself and where the stream continues afterwards.
+        struct LexResult {
+            std::optional<Token> LexedToken;
+            Cursor Next;
+            bool CrossedNewLine = false;
+        };
+
+        LexResult Lex(Cursor from);
+        bool SkipToNextToken(Cursor& cursor) const;
+        std::optional<std::string_view> LexString(Cursor& cursor);
+        void Commit(LexResult&& result);
+
+        std::shared_ptr<const SourceBuffer> m_SourceBuffer;
+        std::string_view m_Source;
+        Cursor m_Cursor;
+        std::optional<LexResult> m_Peeked;
+        std::optional<Token> m_LastToken;
+        std::deque<std::string> m_DecodedStrings; // storage for string tokens containing escape sequences
         bool m_IsNewLine = true;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,159 @@
+module Core.Profiler;
+
+import std;
+import Core.Json;
+
+namespace Core::Profiling {
+    namespace {
+        double ToMilliseconds(Clock::duration duration) {
+            return std::chrono::duration<double, std::milli>(duration).count();
+        }
+
+        double ToMicroseconds(Clock::duration duration) {
+            return std::chrono::duration<double, std::micro>(duration).count();
+        }
+
+        double ToKibibytes(std::integral auto bytes) {
+            return static_cast<double>(bytes) / 1024.0;
+        }
+    }
+
+    HandlerId Profiler::RegisterHandler(std::string_view name, std::string_view category) {
+        std::scoped_lock lock(m_Mutex);
+        auto [it, inserted] = m_HandlerIds.try_emplace(std::string(name), static_cast<HandlerId>(m_Handlers.size()));
+        if (inserted) {
+            m_Handlers.push_back(HandlerStats{std::string(name)});
+            m_HandlerEventNames.push_back(InternEventName(name));
+            m_HandlerCategories.push_back(InternEventName(category));
+        }
+        return it->second;
+    }
+
+    void Profiler::RecordPhase(std::string_view name, Clock::time_point start, Clock::time_point end) {
+        std::scoped_lock lock(m_Mutex);
+        auto phase = std::ranges::find(m_Phases, name, &PhaseStats::Name);
+        if (phase == m_Phases.end()) {
+            phase = m_Phases.insert(m_Phases.end(), PhaseStats{std::string(name)});
+        }
+        ++phase->Count;
+        phase->TotalTime += end - start;
+
+        m_Events.push_back({InternEventName(name), InternEventName("phase"), GetThreadIndex(), start, end, 0});
+    }
+
+    void Profiler::RecordHandlerCall(HandlerId id, Clock::time_point start, Clock::time_point end,
+                                     size_t luaMemoryBefore, size_t luaMemoryAfter) {
+        std::scoped_lock lock(m_Mutex);
+        auto &stats = m_Handlers[id];
+        auto elapsed = end - start;
+        ++stats.Calls;
+        stats.TotalTime += elapsed;
+        stats.MaxTime = std::max(stats.MaxTime, elapsed);
+        stats.LuaMemoryDelta += static_cast<int64_t>(luaMemoryAfter) - static_cast<int64_t>(luaMemoryBefore);
+        stats.PeakLuaMemory = std::max(stats.PeakLuaMemory, luaMemoryAfter);
+
+        m_Events.push_back({m_HandlerEventNames[id], m_HandlerCategories[id], GetThreadIndex(), start, end,
+                            luaMemoryAfter});
+    }
+
+    std::vector<HandlerStats> Profiler::GetHandlerStats() const {
+        std::scoped_lock lock(m_Mutex);
+        return m_Handlers;
+    }
+
+    std::string Profiler::FormatSummary() const {
+        std::scoped_lock lock(m_Mutex);
+
+        std::string summary = std::format("{:<40} {:>8} {:>12}\n", "Phase", "Count", "Total ms");
+        for (const auto &phase: m_Phases) {
+            summary += std::format("{:<40} {:>8} {:>12.3f}\n", phase.Name, phase.Count, ToMilliseconds(phase.TotalTime));
+        }
+
+        std::vector<const HandlerStats *> handlers;
+        for (const auto &handler: m_Handlers) {
+            if (handler.Calls != 0)
+                handlers.push_back(&handler);
+        }
+        std::ranges::sort(handlers, std::greater{}, [](const HandlerStats *stats) { return stats->TotalTime; });
+
+        summary += std::format("\n{:<40} {:>8} {:>12} {:>10} {:>10} {:>14} {:>14}\n", "Handler", "Calls", "Total ms",
+                               "Mean us", "Max us", "Lua delta KiB", "Peak Lua KiB");
+        for (const auto *handler: handlers) {
+            summary += std::format("{:<40} {:>8} {:>12.3f} {:>10.2f} {:>10.2f} {:>14.1f} {:>14.1f}\n",
+                                   handler->Name, handler->Calls, ToMilliseconds(handler->TotalTime),
+                                   ToMicroseconds(handler->TotalTime) / static_cast<double>(handler->Calls),
+                                   ToMicroseconds(handler->MaxTime), ToKibibytes(handler->LuaMemoryDelta),
+                                   ToKibibytes(handler->PeakLuaMemory));
+        }
+        return summary;
+    }
+
+    std::string Profiler::ToChromeTrace() const {
+        std::scoped_lock lock(m_Mutex);
+
+        Json::JsonWriter writer;
+        writer.BeginObject();
+        writer.Member("displayTimeUnit", "ms");
+        writer.Key("traceEvents").BeginArray();
+
+        writer.BeginObject()
+                .Member("name", "process_name").Member("ph", "M").Member("pid", 1).Member("tid", 0)
+                .Key("args").BeginObject().Member("name", "EasyASM").EndObject()
+                .EndObject();
+
+        for (const auto &event: m_Events) {
+            double start = ToMicroseconds(event.Start - m_Epoch);
+            writer.BeginObject()
+                    .Member("name", m_EventNames[event.Name])
+                    .Member("cat", m_EventNames[event.Category])
+                    .Member("ph", "X")
+                    .Member("pid", 1)
+                    .Member("tid", event.Thread)
+                    .Member("ts", start)
+                    .Member("dur", ToMicroseconds(event.End - event.Start));
+            if (event.LuaMemory != 0) {
+                writer.Key("args").BeginObject().Member("luaMemoryBytes", event.LuaMemory).EndObject();
+            }
+            writer.EndObject();
+
+            // a counter track of the Lua heap, sampled after every handler call
+            if (event.LuaMemory != 0) {
+                writer.BeginObject()
+                        .Member("name", "Lua memory")
+                        .Member("ph", "C")
+                        .Member("pid", 1)
+                        .Member("tid", event.Thread)
+                        .Member("ts", ToMicroseconds(event.End - m_Epoch))
+                        .Key("args").BeginObject().Member("KiB", ToKibibytes(event.LuaMemory)).EndObject()
+                        .EndObject();
+            }
+        }
+
+        writer.EndArray();
+        writer.EndObject();
+        return writer.TakeOutput();
+    }
+
+    void Profiler::WriteChromeTrace(const std::filesystem::path &path) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error(std::format("Failed to open trace file '{}'", path.string()));
+        }
+        file << ToChromeTrace();
+    }
+
+    uint32_t Profiler::GetThreadIndex() {
+        auto [it, inserted] = m_Threads.try_emplace(std::this_thread::get_id(),
+                                                    static_cast<uint32_t>(m_Threads.size() + 1));
+        return it->second;
+    }
+
+    uint32_t Profiler::InternEventName(std::string_view name) {
+        auto [it, inserted] = m_EventNameIds.try_emplace(std::string(name),
+                                                         static_cast<uint32_t>(m_EventNames.size()));
+        if (inserted) {
+            m_EventNames.emplace_back(name);
+        }
+        return it->second;
+    }
+}
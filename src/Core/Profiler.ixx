@@ -0,0 +1,133 @@
+export module Core.Profiler;
+
+import std;
+
+namespace Core::Profiling {
+    export using Clock = std::chrono::steady_clock;
+
+    export using HandlerId = uint32_t;
+
+    export struct HandlerStats {
+        std::string Name;
+        uint64_t Calls = 0;
+        Clock::duration TotalTime{};
+        Clock::duration MaxTime{};
+        int64_t LuaMemoryDelta = 0;    // net bytes the Lua heap grew by across all calls
+        size_t PeakLuaMemory = 0;      // largest Lua heap in use right after a call
+    };
+
+    // Collects phase timings, per-handler statistics and a Chrome trace-event log for one or more
+    // Compilers. Recording is thread safe, so the workers of a batch run can share a single Profiler.
+    export class Profiler {
+    public:
+        Profiler() : m_Epoch(Clock::now()) {}
+
+        Profiler(const Profiler &) = delete;
+
+        Profiler &operator=(const Profiler &) = delete;
+
+        // Handlers with the same name share their statistics, e.g. the same Lua function bound to
+        // several mnemonics or registered by several batch workers.
+        HandlerId RegisterHandler(std::string_view name, std::string_view category);
+
+        void RecordPhase(std::string_view name, Clock::time_point start, Clock::time_point end);
+
+        void RecordHandlerCall(HandlerId id, Clock::time_point start, Clock::time_point end,
+                               size_t luaMemoryBefore, size_t luaMemoryAfter);
+
+        [[nodiscard]] std::vector<HandlerStats> GetHandlerStats() const;
+
+        // Phase and handler tables, handlers sorted by cumulative time.
+        [[nodiscard]] std::string FormatSummary() const;
+
+        // Trace Event Format, loadable in chrome://tracing or Perfetto.
+        [[nodiscard]] std::string ToChromeTrace() const;
+
+        void WriteChromeTrace(const std::filesystem::path &path) const;
+
+    private:
+        struct TraceEvent {
+            uint32_t Name;     // phase or handler name index in m_EventNames
+            uint32_t Category; // index in m_EventNames
+            uint32_t Thread;
+            Clock::time_point Start;
+            Clock::time_point End;
+            size_t LuaMemory;  // after the event, 0 for phases
+        };
+
+        struct PhaseStats {
+            std::string Name;
+            uint64_t Count = 0;
+            Clock::duration TotalTime{};
+        };
+
+        uint32_t GetThreadIndex();
+
+        uint32_t InternEventName(std::string_view name);
+
+        Clock::time_point m_Epoch;
+
+        mutable std::mutex m_Mutex;
+        std::vector<HandlerStats> m_Handlers;
+        std::vector<uint32_t> m_HandlerEventNames;
+        std::vector<uint32_t> m_HandlerCategories;
+        std::unordered_map<std::string, HandlerId> m_HandlerIds;
+        std::vector<PhaseStats> m_Phases;
+        std::vector<std::string> m_EventNames;
+        std::unordered_map<std::string, uint32_t> m_EventNameIds;
+        std::vector<TraceEvent> m_Events;
+        std::unordered_map<std::thread::id, uint32_t> m_Threads;
+    };
+
+    // Times the enclosing scope as a phase, does nothing without a Profiler.
+    export class PhaseScope {
+    public:
+        PhaseScope(Profiler *profiler, std::string_view name)
+            : m_Profiler(profiler), m_Name(name), m_Start(profiler ? Clock::now() : Clock::time_point{}) {}
+
+        PhaseScope(const PhaseScope &) = delete;
+
+        PhaseScope &operator=(const PhaseScope &) = delete;
+
+        ~PhaseScope() {
+            if (m_Profiler) {
+                m_Profiler->RecordPhase(m_Name, m_Start, Clock::now());
+            }
+        }
+
+    private:
+        Profiler *m_Profiler;
+        std::string_view m_Name;
+        Clock::time_point m_Start;
+    };
+
+    // Times one handler call. Stop records the Lua heap after the call; a call left by an exception is
+    // still recorded, with the heap size from before the call.
+    export class HandlerScope {
+    public:
+        HandlerScope(Profiler &profiler, HandlerId id, size_t luaMemoryBefore)
+            : m_Profiler(profiler), m_Id(id), m_LuaMemoryBefore(luaMemoryBefore), m_Start(Clock::now()) {}
+
+        HandlerScope(const HandlerScope &) = delete;
+
+        HandlerScope &operator=(const HandlerScope &) = delete;
+
+        void Stop(size_t luaMemoryAfter) {
+            if (!m_Stopped) {
+                m_Stopped = true;
+                m_Profiler.RecordHandlerCall(m_Id, m_Start, Clock::now(), m_LuaMemoryBefore, luaMemoryAfter);
+            }
+        }
+
+        ~HandlerScope() {
+            Stop(m_LuaMemoryBefore);
+        }
+
+    private:
+        Profiler &m_Profiler;
+        HandlerId m_Id;
+        size_t m_LuaMemoryBefore;
+        Clock::time_point m_Start;
+        bool m_Stopped = false;
+    };
+}
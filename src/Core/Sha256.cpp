@@ -0,0 +1,142 @@
+module Core.Sha256;
+
+import std;
+
+namespace Core {
+    namespace {
+        constexpr std::array<uint32_t, 64> roundConstants{
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+        };
+    }
+
+    void Sha256::Reset() {
+        m_State = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        m_BufferSize = 0;
+        m_TotalBytes = 0;
+    }
+
+    Sha256 &Sha256::Update(std::string_view data) {
+        auto bytes = reinterpret_cast<const uint8_t *>(data.data());
+        size_t size = data.size();
+        m_TotalBytes += size;
+
+        if (m_BufferSize != 0) {
+            size_t take = std::min(size, m_Buffer.size() - m_BufferSize);
+            std::memcpy(m_Buffer.data() + m_BufferSize, bytes, take);
+            m_BufferSize += take;
+            bytes += take;
+            size -= take;
+            if (m_BufferSize < m_Buffer.size())
+                return *this;
+            ProcessBlock(m_Buffer.data());
+            m_BufferSize = 0;
+        }
+
+        for (; size >= m_Buffer.size(); bytes += m_Buffer.size(), size -= m_Buffer.size()) {
+            ProcessBlock(bytes);
+        }
+
+        std::memcpy(m_Buffer.data(), bytes, size);
+        m_BufferSize = size;
+        return *this;
+    }
+
+    Sha256 &Sha256::UpdateField(std::string_view data) {
+        std::array<char, 8> length{};
+        for (size_t i = 0; i < length.size(); ++i) {
+            length[i] = static_cast<char>((static_cast<uint64_t>(data.size()) >> (8 * i)) & 0xFF);
+        }
+        Update({length.data(), length.size()});
+        return Update(data);
+    }
+
+    Sha256::Digest Sha256::Finish() {
+        uint64_t totalBits = m_TotalBytes * 8;
+
+        m_Buffer[m_BufferSize++] = 0x80;
+        if (m_BufferSize > 56) {
+            std::fill(m_Buffer.begin() + static_cast<ptrdiff_t>(m_BufferSize), m_Buffer.end(), 0);
+            ProcessBlock(m_Buffer.data());
+            m_BufferSize = 0;
+        }
+        std::fill(m_Buffer.begin() + static_cast<ptrdiff_t>(m_BufferSize), m_Buffer.begin() + 56, 0);
+        for (size_t i = 0; i < 8; ++i) {
+            m_Buffer[63 - i] = static_cast<uint8_t>(totalBits >> (8 * i)); // big endian
+        }
+        ProcessBlock(m_Buffer.data());
+
+        Digest digest{};
+        for (size_t i = 0; i < m_State.size(); ++i) {
+            for (size_t j = 0; j < 4; ++j) {
+                digest[4 * i + j] = static_cast<uint8_t>(m_State[i] >> (24 - 8 * j));
+            }
+        }
+        Reset();
+        return digest;
+    }
+
+    std::string Sha256::FinishHex() {
+        return ToHex(Finish());
+    }
+
+    std::string Sha256::ToHex(const Digest &digest) {
+        constexpr std::string_view hexDigits = "0123456789abcdef";
+        std::string hex;
+        hex.reserve(digest.size() * 2);
+        for (uint8_t byte: digest) {
+            hex += hexDigits[byte >> 4];
+            hex += hexDigits[byte & 0xF];
+        }
+        return hex;
+    }
+
+    void Sha256::ProcessBlock(const uint8_t *block) {
+        std::array<uint32_t, 64> schedule{};
+        for (size_t i = 0; i < 16; ++i) {
+            schedule[i] = uint32_t{block[4 * i]} << 24 | uint32_t{block[4 * i + 1]} << 16 |
+                          uint32_t{block[4 * i + 2]} << 8 | uint32_t{block[4 * i + 3]};
+        }
+        for (size_t i = 16; i < 64; ++i) {
+            uint32_t s0 = std::rotr(schedule[i - 15], 7) ^ std::rotr(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3);
+            uint32_t s1 = std::rotr(schedule[i - 2], 17) ^ std::rotr(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10);
+            schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+        }
+
+        auto [a, b, c, d, e, f, g, h] = m_State;
+        for (size_t i = 0; i < 64; ++i) {
+            uint32_t s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+            uint32_t choose = (e & f) ^ (~e & g);
+            uint32_t temp1 = h + s1 + choose + roundConstants[i] + schedule[i];
+            uint32_t s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+            uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t temp2 = s0 + majority;
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + temp1;
+            d = c;
+            c = b;
+            b = a;
+            a = temp1 + temp2;
+        }
+
+        m_State[0] += a;
+        m_State[1] += b;
+        m_State[2] += c;
+        m_State[3] += d;
+        m_State[4] += e;
+        m_State[5] += f;
+        m_State[6] += g;
+        m_State[7] += h;
+    }
+}
@@ -0,0 +1,37 @@
+export module Core.Sha256;
+
+import std;
+
+namespace Core {
+    // Incremental SHA-256 (FIPS 180-4), used for content-addressed keys.
+    export class Sha256 {
+    public:
+        using Digest = std::array<uint8_t, 32>;
+
+        Sha256() {
+            Reset();
+        }
+
+        void Reset();
+
+        Sha256 &Update(std::string_view data);
+
+        // Hashes the length before the bytes, so consecutive fields can never run into each other.
+        Sha256 &UpdateField(std::string_view data);
+
+        [[nodiscard]] Digest Finish();
+
+        // Lowercase hexadecimal digest.
+        [[nodiscard]] std::string FinishHex();
+
+        [[nodiscard]] static std::string ToHex(const Digest &digest);
+
+    private:
+        void ProcessBlock(const uint8_t *block);
+
+        std::array<uint32_t, 8> m_State{};
+        std::array<uint8_t, 64> m_Buffer{};
+        size_t m_BufferSize = 0;
+        uint64_t m_TotalBytes = 0;
+    };
+}
@@ -0,0 +1,175 @@
+module Core.SimulationTest;
+
+import std;
+import Vendor.yaml;
+import Core.Simulator;
+
+namespace Core::Sim {
+    namespace {
+        uint8_t ReadByte(const YAML::Node &node, std::string_view what) {
+            auto value = node.as<uint64_t>();
+            if (value > 0xFF) {
+                throw std::runtime_error(std::format("{} {} does not fit in 8 bits", what, value));
+            }
+            return static_cast<uint8_t>(value);
+        }
+
+        std::vector<uint8_t> ReadBytes(const YAML::Node &node, std::string_view what) {
+            std::vector<uint8_t> values;
+            for (const auto &value: node) {
+                values.push_back(ReadByte(value, what));
+            }
+            return values;
+        }
+
+        std::map<uint8_t, std::vector<uint8_t>> ReadPortSequences(const YAML::Node &node) {
+            std::map<uint8_t, std::vector<uint8_t>> sequences;
+            for (const auto &entry: node) {
+                sequences[ReadByte(entry.first, "Port")] = ReadBytes(entry.second, "Value");
+            }
+            return sequences;
+        }
+
+        // 's0' to 'sF'
+        uint8_t ParseRegister(const std::string &name) {
+            if (name.size() == 2 && (name[0] == 's' || name[0] == 'S') &&
+                std::isxdigit(static_cast<unsigned char>(name[1]))) {
+                return static_cast<uint8_t>(std::stoi(name.substr(1), nullptr, 16));
+            }
+            throw std::runtime_error(std::format("Unknown register '{}'", name));
+        }
+
+        std::string FormatBytes(std::span<const uint8_t> values) {
+            std::string text = "[";
+            for (auto value: values) {
+                if (text.size() > 1)
+                    text += ", ";
+                text += std::format("{:02X}", value);
+            }
+            return text + "]";
+        }
+
+        SimulationTest ParseSimulationTest(const YAML::Node &root, const std::filesystem::path &path) {
+            SimulationTest test;
+            auto baseDir = path.parent_path();
+
+            if (root["Source"]) {
+                test.SourcePath = baseDir / root["Source"].as<std::string>();
+            }
+            if (root["Image"]) {
+                test.ImagePath = baseDir / root["Image"].as<std::string>();
+            }
+            if (test.SourcePath.has_value() == test.ImagePath.has_value()) {
+                throw std::runtime_error("A test needs exactly one of 'Source' and 'Image'");
+            }
+
+            if (root["MaxCycles"]) {
+                test.MaxCycles = root["MaxCycles"].as<uint64_t>();
+            }
+            if (root["Interrupts"]) {
+                test.Interrupts = root["Interrupts"].as<std::vector<uint64_t>>();
+            }
+            if (root["Inputs"]) {
+                test.Inputs = ReadPortSequences(root["Inputs"]);
+            }
+            if (root["StopOnOutput"]) {
+                test.StopPort = ReadByte(root["StopOnOutput"], "Port");
+                test.ExpectedStop = StopReason::PortStop;
+            }
+
+            const auto &expect = root["Expect"];
+            if (!expect)
+                return test;
+            if (expect["Stop"]) {
+                auto name = expect["Stop"].as<std::string>();
+                auto reason = ParseStopReason(name);
+                if (!reason) {
+                    throw std::runtime_error(std::format("Unknown stop reason '{}'", name));
+                }
+                test.ExpectedStop = *reason;
+            }
+            if (expect["Outputs"]) {
+                test.ExpectedOutputs = ReadPortSequences(expect["Outputs"]);
+            }
+            for (const auto &entry: expect["Registers"]) {
+                test.ExpectedRegisters[ParseRegister(entry.first.as<std::string>())] = ReadByte(entry.second, "Value");
+            }
+            for (const auto &entry: expect["Scratchpad"]) {
+                auto address = ReadByte(entry.first, "Address");
+                if (address >= ScratchpadSize) {
+                    throw std::runtime_error(std::format("Scratchpad address {:02X} is out of range", address));
+                }
+                test.ExpectedScratchpad[address] = ReadByte(entry.second, "Value");
+            }
+            if (expect["Cycles"]) {
+                test.ExpectedCycles = expect["Cycles"].as<uint64_t>();
+            }
+            return test;
+        }
+    }
+
+    SimulationTest LoadSimulationTest(const std::filesystem::path &path) {
+        try {
+            return ParseSimulationTest(YAML::LoadFile(path.string()), path);
+        } catch (const YAML::Exception &e) {
+            throw std::runtime_error(std::format("Error parsing test '{}': {}", path.string(), e.what()));
+        }
+    }
+
+    SimulationResult RunSimulationTest(const SimulationTest &test, std::shared_ptr<const Program> program) {
+        ScriptedPorts ports;
+        for (const auto &[port, values]: test.Inputs) {
+            ports.SetInputSequence(port, values);
+        }
+        if (test.StopPort) {
+            ports.AddStopPort(*test.StopPort);
+        }
+
+        Processor processor(program, ports);
+        for (auto cycle: test.Interrupts) {
+            processor.ScheduleInterrupt(cycle);
+        }
+
+        SimulationResult result;
+        result.Stop = processor.Run(test.MaxCycles);
+        result.StopAddress = processor.GetStopAddress();
+        const auto &state = processor.GetState();
+        result.Cycles = state.Cycles;
+        result.Instructions = state.Instructions;
+
+        auto &failures = result.Failures;
+        if (result.Stop != test.ExpectedStop) {
+            auto failure = std::format("stopped with {} instead of {}", GetStopReasonName(result.Stop),
+                                       GetStopReasonName(test.ExpectedStop));
+            if (result.Stop != StopReason::CycleLimit) {
+                failure += std::format(" at {:03X}: {}", result.StopAddress,
+                                       Program::Disassemble(program->GetWord(result.StopAddress)));
+            }
+            failures.push_back(std::move(failure));
+        }
+        for (const auto &[port, expected]: test.ExpectedOutputs) {
+            auto written = ports.GetWrittenValues(port);
+            if (written != expected) {
+                failures.push_back(std::format("port {:02X} received {}, expected {}", port, FormatBytes(written),
+                                               FormatBytes(expected)));
+            }
+        }
+        for (const auto &[index, expected]: test.ExpectedRegisters) {
+            if (state.Registers[index] != expected) {
+                failures.push_back(std::format("s{:X} is {:02X}, expected {:02X}", index, state.Registers[index],
+                                               expected));
+            }
+        }
+        for (const auto &[address, expected]: test.ExpectedScratchpad) {
+            if (state.Scratchpad[address] != expected) {
+                failures.push_back(std::format("scratchpad {:02X} is {:02X}, expected {:02X}", address,
+                                               state.Scratchpad[address], expected));
+            }
+        }
+        if (test.ExpectedCycles && result.Cycles != *test.ExpectedCycles) {
+            failures.push_back(std::format("ran {} cycles, expected {}", result.Cycles, *test.ExpectedCycles));
+        }
+        result.Passed = failures.empty();
+        return result;
+    }
+}
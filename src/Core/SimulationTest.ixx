@@ -0,0 +1,50 @@
+export module Core.SimulationTest;
+
+import std;
+import Core.Simulator;
+
+namespace Core::Sim {
+    export constexpr uint64_t DefaultMaxCycles = 1'000'000;
+
+    // One simulation test, read from a YAML file:
+    //
+    //   Source: blink.psm          # or Image: blink.mem, relative to the test file
+    //   MaxCycles: 20000
+    //   Interrupts: [ 1000, 5000 ] # cycles at which the interrupt line is raised
+    //   Inputs: { 0x01: [ 0x10, 0x20 ] }
+    //   StopOnOutput: 0xFF         # a write to this port ends the run
+    //   Expect:
+    //     Stop: PortStop           # defaults to PortStop with StopOnOutput, Halted otherwise
+    //     Outputs: { 0x02: [ 1, 2, 3 ] }
+    //     Registers: { s0: 0x2A }
+    //     Scratchpad: { 0x3F: 7 }
+    //     Cycles: 1234             # exactly, the stopping instruction included
+    export struct SimulationTest {
+        std::optional<std::filesystem::path> SourcePath;
+        std::optional<std::filesystem::path> ImagePath;
+        uint64_t MaxCycles = DefaultMaxCycles;
+        std::vector<uint64_t> Interrupts;
+        std::map<uint8_t, std::vector<uint8_t>> Inputs;
+        std::optional<uint8_t> StopPort;
+
+        StopReason ExpectedStop = StopReason::Halted;
+        std::map<uint8_t, std::vector<uint8_t>> ExpectedOutputs;
+        std::map<uint8_t, uint8_t> ExpectedRegisters;
+        std::map<uint8_t, uint8_t> ExpectedScratchpad;
+        std::optional<uint64_t> ExpectedCycles;
+    };
+
+    export struct SimulationResult {
+        bool Passed = false;
+        std::vector<std::string> Failures;
+        StopReason Stop = StopReason::Halted;
+        uint16_t StopAddress = 0;
+        uint64_t Cycles = 0;
+        uint64_t Instructions = 0;
+    };
+
+    export SimulationTest LoadSimulationTest(const std::filesystem::path &path);
+
+    // Runs the test on a fresh Processor, the Program may be shared with other threads.
+    export SimulationResult RunSimulationTest(const SimulationTest &test, std::shared_ptr<const Program> program);
+}
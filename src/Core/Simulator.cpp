@@ -0,0 +1,613 @@
+module Core.Simulator;
+
+import std;
+import Core.BitBuffer;
+import Core.Lib;
+
+namespace Core::Sim {
+    namespace {
+        constexpr uint16_t addressMask = ProgramDepth - 1;
+        constexpr uint32_t wordMask = (1u << WordWidth) - 1;
+
+        constexpr std::array<std::string_view, 6> stopReasonNames{
+            "Halted", "CycleLimit", "PortStop", "StackOverflow", "StackUnderflow", "InvalidInstruction"
+        };
+
+        // Opcodes in bits 17..13, the register flag of two-operand instructions is bit 12.
+        enum Opcode : uint32_t {
+            Load = 0, Input = 2, Fetch = 3, And = 5, Or = 6, Xor = 7, Test = 9, Compare = 10, Add = 12,
+            AddCarry = 13, Sub = 14, SubCarry = 15, ShiftRotate = 16, Return = 21, Output = 22, Store = 23,
+            Call = 24, Jump = 26, ReturnInterrupt = 28, InterruptEnable = 30
+        };
+
+        enum class AluOperation { Load, And, Or, Xor, Test, Compare, Add, AddCarry, Sub, SubCarry };
+
+        constexpr std::string_view GetConditionName(uint32_t condition) {
+            switch (condition) {
+                case 4: return "Z";
+                case 5: return "NZ";
+                case 6: return "C";
+                case 7: return "NC";
+                default: return "";
+            }
+        }
+
+        constexpr std::string_view GetShiftName(uint32_t function) {
+            switch (function) {
+                case 0: return "SLA";
+                case 2: return "RL";
+                case 4: return "SLX";
+                case 6: return "SL0";
+                case 7: return "SL1";
+                case 8: return "SRA";
+                case 10: return "SRX";
+                case 12: return "RR";
+                case 14: return "SR0";
+                case 15: return "SR1";
+                default: return "";
+            }
+        }
+
+        std::optional<uint32_t> ParseHex(std::string_view text) {
+            uint32_t value = 0;
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value, 16);
+            if (error != std::errc{} || end != text.data() + text.size())
+                return std::nullopt;
+            return value;
+        }
+    }
+
+    std::string_view GetStopReasonName(StopReason reason) {
+        return stopReasonNames.at(static_cast<size_t>(reason));
+    }
+
+    std::optional<StopReason> ParseStopReason(std::string_view name) {
+        for (size_t i = 0; i < stopReasonNames.size(); ++i) {
+            if (Lib::EqualsIgnoreCase(name, stopReasonNames[i]))
+                return static_cast<StopReason>(i);
+        }
+        return std::nullopt;
+    }
+
+    void ScriptedPorts::SetInputSequence(uint8_t port, std::vector<uint8_t> values) {
+        m_Inputs[port] = {std::move(values), 0};
+    }
+
+    uint8_t ScriptedPorts::Input(uint8_t port, uint64_t) {
+        auto it = m_Inputs.find(port);
+        if (it == m_Inputs.end() || it->second.Values.empty())
+            return 0;
+        auto &script = it->second;
+        uint8_t value = script.Values[script.Next];
+        if (script.Next + 1 < script.Values.size())
+            ++script.Next;
+        return value;
+    }
+
+    PortAction ScriptedPorts::Output(uint8_t port, uint8_t value, uint64_t cycle) {
+        m_Writes.push_back({port, value, cycle});
+        return m_StopPorts.test(port) ? PortAction::Stop : PortAction::Continue;
+    }
+
+    std::vector<uint8_t> ScriptedPorts::GetWrittenValues(uint8_t port) const {
+        std::vector<uint8_t> values;
+        for (const auto &write: m_Writes) {
+            if (write.Port == port)
+                values.push_back(write.Value);
+        }
+        return values;
+    }
+
+    // The handlers of the threaded code and the decoder that picks them. Conditions, operand kinds and
+    // shift functions are template parameters, so no handler tests at run time what the decoder already knew.
+    struct InstructionSet {
+        static void Advance(Processor &processor) {
+            processor.m_State.ProgramCounter = (processor.m_State.ProgramCounter + 1) & addressMask;
+        }
+
+        template<bool RegisterOperand>
+        static uint8_t GetOperand(const Processor &processor, const DecodedInstruction &instruction) {
+            if constexpr (RegisterOperand) {
+                return processor.m_State.Registers[instruction.Operand];
+            } else {
+                return instruction.Operand;
+            }
+        }
+
+        template<uint32_t Condition>
+        static bool Holds(const ProcessorState &state) {
+            if constexpr (Condition == 4) {
+                return state.Zero;
+            } else if constexpr (Condition == 5) {
+                return !state.Zero;
+            } else if constexpr (Condition == 6) {
+                return state.Carry;
+            } else if constexpr (Condition == 7) {
+                return !state.Carry;
+            } else {
+                return true;
+            }
+        }
+
+        template<AluOperation Operation, bool RegisterOperand>
+        static void Alu(Processor &processor, const DecodedInstruction &instruction) {
+            auto &state = processor.m_State;
+            uint8_t &x = state.Registers[instruction.X];
+            uint8_t y = GetOperand<RegisterOperand>(processor, instruction);
+
+            if constexpr (Operation == AluOperation::Load) {
+                x = y;
+            } else if constexpr (Operation == AluOperation::And || Operation == AluOperation::Or ||
+                                 Operation == AluOperation::Xor) {
+                if constexpr (Operation == AluOperation::And) {
+                    x &= y;
+                } else if constexpr (Operation == AluOperation::Or) {
+                    x |= y;
+                } else {
+                    x ^= y;
+                }
+                state.Zero = x == 0;
+                state.Carry = false;
+            } else if constexpr (Operation == AluOperation::Test) {
+                uint8_t result = x & y;
+                state.Zero = result == 0;
+                state.Carry = (std::popcount(result) & 1) != 0; // odd parity
+            } else if constexpr (Operation == AluOperation::Compare) {
+                state.Zero = x == y;
+                state.Carry = x < y;
+            } else if constexpr (Operation == AluOperation::Add || Operation == AluOperation::AddCarry) {
+                unsigned sum = unsigned{x} + y + (Operation == AluOperation::AddCarry && state.Carry ? 1 : 0);
+                x = static_cast<uint8_t>(sum);
+                state.Carry = sum > 0xFF;
+                state.Zero = x == 0;
+            } else {
+                unsigned subtrahend = unsigned{y} + (Operation == AluOperation::SubCarry && state.Carry ? 1 : 0);
+                state.Carry = x < subtrahend;
+                x = static_cast<uint8_t>(x - subtrahend);
+                state.Zero = x == 0;
+            }
+            Advance(processor);
+        }
+
+        template<uint32_t Function>
+        static void Shift(Processor &processor, const DecodedInstruction &instruction) {
+            auto &state = processor.m_State;
+            uint8_t &x = state.Registers[instruction.X];
+            uint8_t value = x;
+            if constexpr (Function < 8) {
+                // left: bit 7 goes to carry, bit 0 comes from carry (SLA), bit 7 (RL), bit 0 (SLX), 0 or 1
+                unsigned in = Function == 0 ? state.Carry : Function == 2 ? value >> 7 : Function == 4 ? value & 1
+                                                                                        : Function == 7 ? 1 : 0;
+                state.Carry = (value >> 7) != 0;
+                x = static_cast<uint8_t>(value << 1 | in);
+            } else {
+                // right: bit 0 goes to carry, bit 7 comes from carry (SRA), bit 7 (SRX), bit 0 (RR), 0 or 1
+                unsigned in = Function == 8 ? state.Carry : Function == 10 ? value >> 7 : Function == 12 ? value & 1
+                                                                                         : Function == 15 ? 1 : 0;
+                state.Carry = (value & 1) != 0;
+                x = static_cast<uint8_t>(value >> 1 | in << 7);
+            }
+            state.Zero = x == 0;
+            Advance(processor);
+        }
+
+        template<bool RegisterOperand>
+        static void InputPort(Processor &processor, const DecodedInstruction &instruction) {
+            auto &state = processor.m_State;
+            state.Registers[instruction.X] = processor.m_Ports.Input(GetOperand<RegisterOperand>(processor, instruction),
+                                                                     state.Cycles);
+            Advance(processor);
+        }
+
+        template<bool RegisterOperand>
+        static void OutputPort(Processor &processor, const DecodedInstruction &instruction) {
+            auto &state = processor.m_State;
+            auto action = processor.m_Ports.Output(GetOperand<RegisterOperand>(processor, instruction),
+                                                   state.Registers[instruction.X], state.Cycles);
+            if (action == PortAction::Stop) {
+                processor.Stop(StopReason::PortStop);
+            }
+            Advance(processor);
+        }
+
+        template<bool RegisterOperand>
+        static void FetchScratchpad(Processor &processor, const DecodedInstruction &instruction) {
+            auto &state = processor.m_State;
+            state.Registers[instruction.X] =
+                    state.Scratchpad[GetOperand<RegisterOperand>(processor, instruction) % ScratchpadSize];
+            Advance(processor);
+        }
+
+        template<bool RegisterOperand>
+        static void StoreScratchpad(Processor &processor, const DecodedInstruction &instruction) {
+            auto &state = processor.m_State;
+            state.Scratchpad[GetOperand<RegisterOperand>(processor, instruction) % ScratchpadSize] =
+                    state.Registers[instruction.X];
+            Advance(processor);
+        }
+
+        static bool Push(Processor &processor, uint16_t address) {
+            auto &state = processor.m_State;
+            if (state.StackSize == StackDepth) {
+                processor.Stop(StopReason::StackOverflow);
+                return false;
+            }
+            state.Stack[state.StackSize++] = address;
+            return true;
+        }
+
+        static std::optional<uint16_t> Pop(Processor &processor) {
+            auto &state = processor.m_State;
+            if (state.StackSize == 0) {
+                processor.Stop(StopReason::StackUnderflow);
+                return std::nullopt;
+            }
+            return state.Stack[--state.StackSize];
+        }
+
+        template<uint32_t Condition>
+        static void JumpTo(Processor &processor, const DecodedInstruction &instruction) {
+            if (Holds<Condition>(processor.m_State)) {
+                processor.m_State.ProgramCounter = instruction.Address;
+            } else {
+                Advance(processor);
+            }
+        }
+
+        // 'JUMP here' ends most firmware tests. Waits for the next interrupt in one step, or halts if
+        // nothing can interrupt the loop any more.
+        static void JumpToSelf(Processor &processor, const DecodedInstruction &) {
+            auto &state = processor.m_State;
+            bool interruptComing = processor.m_InterruptLine || !processor.m_ScheduledInterrupts.empty();
+            if (!state.InterruptEnable || !interruptComing) {
+                processor.Stop(StopReason::Halted);
+                return;
+            }
+
+            uint64_t wake = processor.m_InterruptLine
+                                ? state.Cycles
+                                : std::min(processor.m_ScheduledInterrupts.back(), processor.m_CycleLimit);
+            uint64_t iterations = std::max<uint64_t>((wake - std::min(wake, state.Cycles) + 1) / 2, 1);
+            state.Cycles += (iterations - 1) * CyclesPerInstruction; // the run loop counts the last one
+            state.Instructions += iterations - 1;
+        }
+
+        template<uint32_t Condition>
+        static void CallTo(Processor &processor, const DecodedInstruction &instruction) {
+            auto &state = processor.m_State;
+            if (!Holds<Condition>(state)) {
+                Advance(processor);
+                return;
+            }
+            if (Push(processor, (state.ProgramCounter + 1) & addressMask)) {
+                state.ProgramCounter = instruction.Address;
+            }
+        }
+
+        template<uint32_t Condition>
+        static void ReturnFrom(Processor &processor, const DecodedInstruction &) {
+            if (!Holds<Condition>(processor.m_State)) {
+                Advance(processor);
+                return;
+            }
+            if (auto address = Pop(processor)) {
+                processor.m_State.ProgramCounter = *address;
+            }
+        }
+
+        template<bool Enable>
+        static void ReturnFromInterrupt(Processor &processor, const DecodedInstruction &) {
+            auto &state = processor.m_State;
+            auto address = Pop(processor);
+            if (!address)
+                return;
+            state.ProgramCounter = *address;
+            state.Zero = state.PreservedZero;
+            state.Carry = state.PreservedCarry;
+            state.InterruptEnable = Enable;
+            processor.UpdateNextEvent();
+        }
+
+        template<bool Enable>
+        static void SetInterruptEnable(Processor &processor, const DecodedInstruction &) {
+            processor.m_State.InterruptEnable = Enable;
+            processor.UpdateNextEvent();
+            Advance(processor);
+        }
+
+        static void Invalid(Processor &processor, const DecodedInstruction &) {
+            processor.Stop(StopReason::InvalidInstruction);
+        }
+
+        static void TakeInterrupt(Processor &processor) {
+            auto &state = processor.m_State;
+            if (!Push(processor, state.ProgramCounter))
+                return;
+            state.PreservedZero = state.Zero;
+            state.PreservedCarry = state.Carry;
+            state.InterruptEnable = false;
+            state.ProgramCounter = InterruptVector;
+            state.Cycles += CyclesPerInstruction;
+            ++state.InterruptsTaken;
+            processor.m_InterruptLine = false;
+        }
+
+        template<AluOperation Operation>
+        static DecodedInstruction DecodeAlu(uint32_t word) {
+            return DecodeTwoOperand<&Alu<Operation, false>, &Alu<Operation, true>>(word);
+        }
+
+        template<InstructionHandler ConstantForm, InstructionHandler RegisterForm>
+        static DecodedInstruction DecodeTwoOperand(uint32_t word) {
+            auto x = static_cast<uint8_t>(word >> 8 & 0xF);
+            if (word >> 12 & 1) {
+                return {RegisterForm, x, static_cast<uint8_t>(word >> 4 & 0xF), 0};
+            }
+            return {ConstantForm, x, static_cast<uint8_t>(word & 0xFF), 0};
+        }
+
+        static InstructionHandler SelectShift(uint32_t function) {
+            switch (function) {
+                case 0: return &Shift<0>;
+                case 2: return &Shift<2>;
+                case 4: return &Shift<4>;
+                case 6: return &Shift<6>;
+                case 7: return &Shift<7>;
+                case 8: return &Shift<8>;
+                case 10: return &Shift<10>;
+                case 12: return &Shift<12>;
+                case 14: return &Shift<14>;
+                case 15: return &Shift<15>;
+                default: return &Invalid;
+            }
+        }
+
+        // Handlers for the conditions 0 (always), Z, NZ, C and NC, the rest do not exist.
+        template<template<uint32_t> typename Handler>
+        static InstructionHandler SelectConditional(uint32_t condition) {
+            switch (condition) {
+                case 0: return Handler<0>::Execute;
+                case 4: return Handler<4>::Execute;
+                case 5: return Handler<5>::Execute;
+                case 6: return Handler<6>::Execute;
+                case 7: return Handler<7>::Execute;
+                default: return &Invalid;
+            }
+        }
+
+        template<uint32_t Condition>
+        struct JumpHandler {
+            static constexpr InstructionHandler Execute = &JumpTo<Condition>;
+        };
+
+        template<uint32_t Condition>
+        struct CallHandler {
+            static constexpr InstructionHandler Execute = &CallTo<Condition>;
+        };
+
+        template<uint32_t Condition>
+        struct ReturnHandler {
+            static constexpr InstructionHandler Execute = &ReturnFrom<Condition>;
+        };
+
+        static DecodedInstruction Decode(uint32_t word, uint16_t address) {
+            uint32_t condition = word >> 10 & 0x7;
+            auto target = static_cast<uint16_t>(word & addressMask);
+            switch (word >> 13) {
+                case Load: return DecodeAlu<AluOperation::Load>(word);
+                case And: return DecodeAlu<AluOperation::And>(word);
+                case Or: return DecodeAlu<AluOperation::Or>(word);
+                case Xor: return DecodeAlu<AluOperation::Xor>(word);
+                case Test: return DecodeAlu<AluOperation::Test>(word);
+                case Compare: return DecodeAlu<AluOperation::Compare>(word);
+                case Add: return DecodeAlu<AluOperation::Add>(word);
+                case AddCarry: return DecodeAlu<AluOperation::AddCarry>(word);
+                case Sub: return DecodeAlu<AluOperation::Sub>(word);
+                case SubCarry: return DecodeAlu<AluOperation::SubCarry>(word);
+                case Input: return DecodeTwoOperand<&InputPort<false>, &InputPort<true>>(word);
+                case Output: return DecodeTwoOperand<&OutputPort<false>, &OutputPort<true>>(word);
+                case Fetch: return DecodeTwoOperand<&FetchScratchpad<false>, &FetchScratchpad<true>>(word);
+                case Store: return DecodeTwoOperand<&StoreScratchpad<false>, &StoreScratchpad<true>>(word);
+                case ShiftRotate:
+                    if (word >> 12 & 1)
+                        return {&Invalid, 0, 0, 0};
+                    return {SelectShift(word & 0xFF), static_cast<uint8_t>(word >> 8 & 0xF), 0, 0};
+                case Jump:
+                    if (condition == 0 && target == address)
+                        return {&JumpToSelf, 0, 0, target};
+                    return {SelectConditional<JumpHandler>(condition), 0, 0, target};
+                case Call: return {SelectConditional<CallHandler>(condition), 0, 0, target};
+                case Return: return {SelectConditional<ReturnHandler>(condition), 0, 0, 0};
+                case ReturnInterrupt:
+                    return {word & 1 ? &ReturnFromInterrupt<true> : &ReturnFromInterrupt<false>, 0, 0, 0};
+                case InterruptEnable:
+                    return {word & 1 ? &SetInterruptEnable<true> : &SetInterruptEnable<false>, 0, 0, 0};
+                default: return {&Invalid, 0, 0, 0};
+            }
+        }
+    };
+
+    Program::Program(std::vector<uint32_t> words) : m_Words(std::move(words)) {
+        if (m_Words.size() > ProgramDepth) {
+            throw std::runtime_error(std::format("The image has {} words, the program memory holds {}",
+                                                 m_Words.size(), ProgramDepth));
+        }
+        m_Words.resize(ProgramDepth, 0);
+
+        m_Code.reserve(ProgramDepth);
+        for (size_t address = 0; address < ProgramDepth; ++address) {
+            if (m_Words[address] > wordMask) {
+                throw std::runtime_error(std::format("Word {:05X} at address {:03X} is wider than {} bits",
+                                                     m_Words[address], address, WordWidth));
+            }
+            m_Code.push_back(InstructionSet::Decode(m_Words[address], static_cast<uint16_t>(address)));
+        }
+    }
+
+    Program Program::FromBitBuffer(const BitBuffer &bitBuffer) {
+        if (bitBuffer.Size() % WordWidth != 0) {
+            throw std::runtime_error(std::format("The image is not a whole number of {}-bit words", WordWidth));
+        }
+        std::vector<uint32_t> words(bitBuffer.GetWordCount(WordWidth));
+        for (size_t i = 0; i < words.size(); ++i) {
+            words[i] = static_cast<uint32_t>(bitBuffer.ReadWord(i, WordWidth));
+        }
+        return Program(std::move(words));
+    }
+
+    Program Program::FromMemFile(const std::filesystem::path &path) {
+        std::ifstream input(path);
+        if (!input) {
+            throw std::runtime_error(std::format("Failed to open image '{}'", path.string()));
+        }
+
+        std::vector<uint32_t> words;
+        size_t address = 0;
+        std::string line;
+        for (size_t lineNumber = 1; std::getline(input, line); ++lineNumber) {
+            std::string_view rest = line;
+            rest = rest.substr(0, rest.find("//"));
+            std::istringstream tokens{std::string(rest)};
+            std::string token;
+            while (tokens >> token) {
+                bool isAddress = token.starts_with('@');
+                auto value = ParseHex(isAddress ? std::string_view(token).substr(1) : std::string_view(token));
+                if (!value) {
+                    throw std::runtime_error(std::format("Invalid {} '{}' at line {} of '{}'",
+                                                         isAddress ? "address" : "word", token, lineNumber,
+                                                         path.string()));
+                }
+                if (isAddress) {
+                    address = *value;
+                    continue;
+                }
+                if (address >= ProgramDepth) {
+                    throw std::runtime_error(std::format("Word at address {:X} of '{}' is past the program memory",
+                                                         address, path.string()));
+                }
+                if (words.size() <= address) {
+                    words.resize(address + 1, 0);
+                }
+                words[address++] = *value;
+            }
+        }
+        return Program(std::move(words));
+    }
+
+    std::string Program::Disassemble(uint32_t word) {
+        auto x = word >> 8 & 0xF;
+        auto registerForm = (word >> 12 & 1) != 0;
+        auto operand = registerForm ? std::format("s{:X}", word >> 4 & 0xF) : std::format("{:02X}", word & 0xFF);
+        auto conditionName = GetConditionName(word >> 10 & 0x7);
+        auto withCondition = [&](std::string_view mnemonic, std::string argument) {
+            if (conditionName.empty())
+                return argument.empty() ? std::string(mnemonic) : std::format("{} {}", mnemonic, argument);
+            return argument.empty() ? std::format("{} {}", mnemonic, conditionName)
+                                    : std::format("{} {}, {}", mnemonic, conditionName, argument);
+        };
+
+        switch (word >> 13) {
+            case Load: return std::format("LOAD s{:X}, {}", x, operand);
+            case And: return std::format("AND s{:X}, {}", x, operand);
+            case Or: return std::format("OR s{:X}, {}", x, operand);
+            case Xor: return std::format("XOR s{:X}, {}", x, operand);
+            case Test: return std::format("TEST s{:X}, {}", x, operand);
+            case Compare: return std::format("COMPARE s{:X}, {}", x, operand);
+            case Add: return std::format("ADD s{:X}, {}", x, operand);
+            case AddCarry: return std::format("ADDCY s{:X}, {}", x, operand);
+            case Sub: return std::format("SUB s{:X}, {}", x, operand);
+            case SubCarry: return std::format("SUBCY s{:X}, {}", x, operand);
+            case Input: return std::format("INPUT s{:X}, {}", x, registerForm ? "(" + operand + ")" : operand);
+            case Output: return std::format("OUTPUT s{:X}, {}", x, registerForm ? "(" + operand + ")" : operand);
+            case Fetch: return std::format("FETCH s{:X}, {}", x, registerForm ? "(" + operand + ")" : operand);
+            case Store: return std::format("STORE s{:X}, {}", x, registerForm ? "(" + operand + ")" : operand);
+            case ShiftRotate:
+                if (auto name = GetShiftName(word & 0xFF); !registerForm && !name.empty())
+                    return std::format("{} s{:X}", name, x);
+                break;
+            case Jump: return withCondition("JUMP", std::format("{:03X}", word & addressMask));
+            case Call: return withCondition("CALL", std::format("{:03X}", word & addressMask));
+            case Return: return withCondition("RETURN", "");
+            case ReturnInterrupt: return word & 1 ? "RETURNI ENABLE" : "RETURNI DISABLE";
+            case InterruptEnable: return word & 1 ? "ENABLE INTERRUPT" : "DISABLE INTERRUPT";
+            default: break;
+        }
+        return std::format("invalid instruction {:05X}", word);
+    }
+
+    Processor::Processor(std::shared_ptr<const Program> program, PortHandler &ports)
+        : m_Program(std::move(program)), m_Code(m_Program->m_Code.data()), m_Ports(ports) {}
+
+    void Processor::Reset() {
+        m_State = {};
+        m_InterruptLine = false;
+        m_StopReason.reset();
+        m_StopAddress = 0;
+    }
+
+    void Processor::ScheduleInterrupt(uint64_t cycle) {
+        m_ScheduledInterrupts.insert(std::ranges::upper_bound(m_ScheduledInterrupts, cycle, std::greater{}), cycle);
+    }
+
+    void Processor::RaiseInterrupt() {
+        m_InterruptLine = true;
+        UpdateNextEvent();
+    }
+
+    void Processor::Stop(StopReason reason) {
+        m_StopReason = reason;
+        m_StopAddress = m_State.ProgramCounter;
+    }
+
+    void Processor::UpdateNextEvent() {
+        m_NextEvent = m_CycleLimit;
+        if (m_InterruptLine && m_State.InterruptEnable) {
+            m_NextEvent = m_State.Cycles;
+        } else if (!m_ScheduledInterrupts.empty()) {
+            m_NextEvent = std::min(m_NextEvent, m_ScheduledInterrupts.back());
+        }
+    }
+
+    void Processor::HandleEvents() {
+        while (!m_ScheduledInterrupts.empty() && m_ScheduledInterrupts.back() <= m_State.Cycles) {
+            m_InterruptLine = true;
+            m_ScheduledInterrupts.pop_back();
+        }
+        if (m_State.Cycles >= m_CycleLimit) {
+            Stop(StopReason::CycleLimit);
+            return;
+        }
+        if (m_InterruptLine && m_State.InterruptEnable) {
+            InstructionSet::TakeInterrupt(*this);
+        }
+        UpdateNextEvent();
+    }
+
+    StopReason Processor::Run(uint64_t cycleLimit) {
+        m_CycleLimit = cycleLimit;
+        m_StopReason.reset();
+        UpdateNextEvent();
+
+        for (;;) {
+            if (m_State.Cycles >= m_NextEvent) {
+                HandleEvents();
+                if (m_StopReason)
+                    break;
+            }
+
+            const auto &instruction = m_Code[m_State.ProgramCounter];
+            instruction.Execute(*this, instruction);
+            if (m_StopReason) [[unlikely]] {
+                // the write that asked to stop has happened, everything else stopped before its instruction
+                if (*m_StopReason == StopReason::PortStop) {
+                    m_State.Cycles += CyclesPerInstruction;
+                    ++m_State.Instructions;
+                }
+                break;
+            }
+            m_State.Cycles += CyclesPerInstruction;
+            ++m_State.Instructions;
+        }
+        return *m_StopReason;
+    }
+}
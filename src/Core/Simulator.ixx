@@ -0,0 +1,192 @@
+export module Core.Simulator;
+
+import std;
+import Core.BitBuffer;
+
+namespace Core::Sim {
+    // The KCPSM3 flavour of PicoBlaze that the PicoBlaze language assembles for.
+    export constexpr size_t WordWidth = 18;
+    export constexpr size_t ProgramDepth = 1024;
+    export constexpr size_t RegisterCount = 16;
+    export constexpr size_t ScratchpadSize = 64;
+    export constexpr size_t StackDepth = 31;
+    export constexpr uint16_t InterruptVector = 0x3FF;
+    export constexpr uint64_t CyclesPerInstruction = 2; // interrupt entry included
+
+    export enum class StopReason {
+        Halted,            // an unconditional JUMP to itself that no interrupt can leave
+        CycleLimit,
+        PortStop,          // requested by the port handler
+        StackOverflow,     // a CALL or interrupt with all 31 stack entries in use
+        StackUnderflow,    // a RETURN or RETURNI with an empty stack
+        InvalidInstruction
+    };
+
+    export std::string_view GetStopReasonName(StopReason reason);
+
+    export std::optional<StopReason> ParseStopReason(std::string_view name);
+
+    export enum class PortAction {
+        Continue,
+        Stop
+    };
+
+    // INPUT and OUTPUT of a simulated processor. The default reads every port as zero and ignores writes.
+    export class PortHandler {
+    public:
+        virtual ~PortHandler() = default;
+
+        virtual uint8_t Input(uint8_t port, uint64_t cycle) {
+            return 0;
+        }
+
+        virtual PortAction Output(uint8_t port, uint8_t value, uint64_t cycle) {
+            return PortAction::Continue;
+        }
+    };
+
+    export struct PortWrite {
+        uint8_t Port;
+        uint8_t Value;
+        uint64_t Cycle;
+    };
+
+    // Port stubs for tests: every input port answers with its scripted values in order and keeps repeating
+    // the last one, unscripted ports read as zero. Every write is recorded, and a write to a stop port ends
+    // the run.
+    export class ScriptedPorts : public PortHandler {
+    public:
+        void SetInputSequence(uint8_t port, std::vector<uint8_t> values);
+
+        void AddStopPort(uint8_t port) {
+            m_StopPorts.set(port);
+        }
+
+        uint8_t Input(uint8_t port, uint64_t cycle) override;
+
+        PortAction Output(uint8_t port, uint8_t value, uint64_t cycle) override;
+
+        [[nodiscard]] std::span<const PortWrite> GetWrites() const {
+            return m_Writes;
+        }
+
+        [[nodiscard]] std::vector<uint8_t> GetWrittenValues(uint8_t port) const;
+
+    private:
+        struct InputScript {
+            std::vector<uint8_t> Values;
+            size_t Next = 0;
+        };
+
+        std::unordered_map<uint8_t, InputScript> m_Inputs;
+        std::bitset<256> m_StopPorts;
+        std::vector<PortWrite> m_Writes;
+    };
+
+    export struct ProcessorState {
+        std::array<uint8_t, RegisterCount> Registers{};
+        std::array<uint8_t, ScratchpadSize> Scratchpad{};
+        std::array<uint16_t, StackDepth> Stack{};
+        size_t StackSize = 0;
+        uint16_t ProgramCounter = 0;
+        bool Zero = false;
+        bool Carry = false;
+        bool InterruptEnable = false;
+        bool PreservedZero = false; // flags saved by the interrupt, restored by RETURNI
+        bool PreservedCarry = false;
+        uint64_t Cycles = 0;
+        uint64_t Instructions = 0;
+        uint64_t InterruptsTaken = 0;
+    };
+
+    class Processor;
+    struct DecodedInstruction;
+    struct InstructionSet;
+
+    using InstructionHandler = void (*)(Processor &, const DecodedInstruction &);
+
+    // One predecoded word: the handler of its operation and its operands, so running an instruction is a
+    // single indirect call without looking at the word again.
+    struct DecodedInstruction {
+        InstructionHandler Execute;
+        uint8_t X;        // sX
+        uint8_t Operand;  // kk, pp, ss, or the index of sY
+        uint16_t Address; // of JUMP and CALL
+    };
+
+    // A program memory image predecoded into threaded code. Immutable, so one Program can be shared by any
+    // number of Processors on any number of threads.
+    export class Program {
+    public:
+        // Words beyond the end of the image are zero, as in the emitted images.
+        explicit Program(std::vector<uint32_t> words);
+
+        static Program FromBitBuffer(const BitBuffer &bitBuffer);
+
+        // Reads a '.mem' image: hexadecimal words, '@address' lines and '//' comments.
+        static Program FromMemFile(const std::filesystem::path &path);
+
+        [[nodiscard]] uint32_t GetWord(size_t address) const {
+            return m_Words.at(address);
+        }
+
+        // For listings and error messages, e.g. "ADD s0, s1".
+        [[nodiscard]] static std::string Disassemble(uint32_t word);
+
+    private:
+        friend class Processor;
+
+        std::vector<uint32_t> m_Words;
+        std::vector<DecodedInstruction> m_Code;
+    };
+
+    export class Processor {
+    public:
+        Processor(std::shared_ptr<const Program> program, PortHandler &ports);
+
+        // Back to the power-up state; scheduled interrupts are kept.
+        void Reset();
+
+        // Raises the interrupt line at the given cycle, it stays raised until the interrupt is taken.
+        void ScheduleInterrupt(uint64_t cycle);
+
+        void RaiseInterrupt();
+
+        // Runs until something stops the processor or the cycle count reaches cycleLimit.
+        StopReason Run(uint64_t cycleLimit);
+
+        [[nodiscard]] const ProcessorState &GetState() const {
+            return m_State;
+        }
+
+        ProcessorState &GetState() {
+            return m_State;
+        }
+
+        // Address of the instruction that stopped the run, meaningful after anything but CycleLimit.
+        [[nodiscard]] uint16_t GetStopAddress() const {
+            return m_StopAddress;
+        }
+
+    private:
+        friend struct InstructionSet;
+
+        void Stop(StopReason reason);
+
+        void UpdateNextEvent();
+
+        void HandleEvents();
+
+        std::shared_ptr<const Program> m_Program;
+        const DecodedInstruction *m_Code;
+        PortHandler &m_Ports;
+        ProcessorState m_State;
+
+        std::vector<uint64_t> m_ScheduledInterrupts; // sorted, latest first so the next one pops off the back
+        bool m_InterruptLine = false;
+        uint64_t m_CycleLimit = 0;
+        uint64_t m_NextEvent = 0; // the run loop only looks at interrupts and the limit from this cycle on
+        std::optional<StopReason> m_StopReason;
+        uint16_t m_StopAddress = 0;
+    };
+}
@@ -0,0 +1,45 @@
+module Core.SourceBuffer;
+
+import std;
+import Core.MappedFile;
+
+namespace Core {
+    namespace {
+        std::string ReadStream(std::istream &input, const std::string &name) {
+            std::string text;
+            std::array<char, 1 << 16> block{};
+            while (input.read(block.data(), block.size()) || input.gcount() > 0) {
+                text.append(block.data(), static_cast<size_t>(input.gcount()));
+            }
+            if (input.bad()) {
+                throw std::runtime_error(std::format("Failed to read source file '{}'", name));
+            }
+            return text;
+        }
+    }
+
+    std::shared_ptr<const SourceBuffer> SourceBuffer::FromFile(const std::filesystem::path &path) {
+        std::error_code error;
+        if (std::filesystem::is_regular_file(path, error)) {
+            try {
+                return std::make_shared<const SourceBuffer>(MappedFile(path));
+            } catch (const std::exception &) {
+                // e.g. a file system without mapping support, reading still works
+            }
+        }
+
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            throw std::runtime_error(std::format("Failed to open source file '{}'", path.string()));
+        }
+        return std::make_shared<const SourceBuffer>(ReadStream(input, path.string()));
+    }
+
+    std::shared_ptr<const SourceBuffer> SourceBuffer::FromStdin() {
+        return std::make_shared<const SourceBuffer>(ReadStream(std::cin, "<stdin>"));
+    }
+
+    std::shared_ptr<const SourceBuffer> SourceBuffer::FromString(std::string text) {
+        return std::make_shared<const SourceBuffer>(std::move(text));
+    }
+}
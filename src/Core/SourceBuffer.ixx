@@ -0,0 +1,42 @@
+export module Core.SourceBuffer;
+
+import std;
+import Core.MappedFile;
+
+namespace Core {
+    // Read-only source text shared by everything that lexes it. Files are mapped rather than copied,
+    // pipes and stdin are read in large blocks. Token views point straight into the buffer, so it must
+    // outlive every TokenStream over it, which holds a reference for that reason.
+    export class SourceBuffer {
+    public:
+        // Maps regular files and reads anything else (FIFOs, devices), or a file that cannot be mapped.
+        static std::shared_ptr<const SourceBuffer> FromFile(const std::filesystem::path &path);
+
+        static std::shared_ptr<const SourceBuffer> FromStdin();
+
+        static std::shared_ptr<const SourceBuffer> FromString(std::string text);
+
+        [[nodiscard]] std::string_view GetText() const {
+            return std::visit([](const auto &storage) { return GetView(storage); }, m_Storage);
+        }
+
+        [[nodiscard]] bool IsMapped() const {
+            return std::holds_alternative<MappedFile>(m_Storage);
+        }
+
+        explicit SourceBuffer(MappedFile file) : m_Storage(std::move(file)) {}
+
+        explicit SourceBuffer(std::string text) : m_Storage(std::move(text)) {}
+
+    private:
+        static std::string_view GetView(const MappedFile &file) {
+            return file.GetView();
+        }
+
+        static std::string_view GetView(const std::string &text) {
+            return text;
+        }
+
+        std::variant<MappedFile, std::string> m_Storage;
+    };
+}
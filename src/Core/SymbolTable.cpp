@@ -0,0 +1,139 @@
+module Core.SymbolTable;
+
+import std;
+import Vendor.sol;
+import Core.BitBuffer;
+import Core.Exceptions;
+
+namespace Core {
+    void SymbolTable::AddLibToState(sol::state &state) {
+        state.new_usertype<SymbolTable>("SymbolTable",
+                                        "DefineLabel", &SymbolTable::DefineLabel,
+                                        "DefineConstant", &SymbolTable::DefineConstant,
+                                        "GetLabel", &SymbolTable::GetLabel,
+                                        "GetConstant", &SymbolTable::GetConstant,
+                                        "AddAddressRelocation",
+                                        [](SymbolTable &self, std::string_view name, uint64_t offset, size_t width) {
+                                            self.AddRelocation(RelocationKind::Address, name, offset, width);
+                                        },
+                                        "AddConstantRelocation",
+                                        [](SymbolTable &self, std::string_view name, uint64_t offset, size_t width) {
+                                            self.AddRelocation(RelocationKind::Constant, name, offset, width);
+                                        },
+                                        "GetRelocationCount",
+                                        [](const SymbolTable &self) { return self.GetRelocations().size(); }
+        );
+    }
+
+    SymbolId SymbolTable::Intern(std::string_view name) {
+        if (auto it = m_Ids.find(name); it != m_Ids.end())
+            return it->second;
+
+        auto id = static_cast<SymbolId>(m_Names.size());
+        const auto &stored = m_Names.emplace_back(name);
+        m_Ids.emplace(stored, id);
+        m_Definitions.emplace_back();
+        return id;
+    }
+
+    std::optional<SymbolId> SymbolTable::Find(std::string_view name) const {
+        if (auto it = m_Ids.find(name); it != m_Ids.end())
+            return it->second;
+        return std::nullopt;
+    }
+
+    bool SymbolTable::DefineLabel(std::string_view name, uint64_t address) {
+        auto &definition = m_Definitions[Intern(name)];
+        if (definition.Address)
+            return false;
+        definition.Address = address;
+        return true;
+    }
+
+    bool SymbolTable::DefineConstant(std::string_view name, uint64_t value) {
+        auto &definition = m_Definitions[Intern(name)];
+        if (definition.Value)
+            return false;
+        definition.Value = value;
+        return true;
+    }
+
+    std::optional<uint64_t> SymbolTable::GetLabel(std::string_view name) const {
+        auto id = Find(name);
+        return id ? m_Definitions[*id].Address : std::nullopt;
+    }
+
+    std::optional<uint64_t> SymbolTable::GetConstant(std::string_view name) const {
+        auto id = Find(name);
+        return id ? m_Definitions[*id].Value : std::nullopt;
+    }
+
+    void SymbolTable::AddRelocation(RelocationKind kind, std::string_view name, uint64_t offset, size_t width) {
+        AddRelocation(kind, Intern(name), offset, width);
+    }
+
+    void SymbolTable::AddRelocation(RelocationKind kind, SymbolId symbol, uint64_t offset, size_t width) {
+        if (width == 0 || width > BitBuffer::WordBits) {
+            throw Exceptions::CompilerImplementationError(
+                std::format("Relocation of '{}' has an unsupported width of {} bits", GetName(symbol), width));
+        }
+        m_Relocations.push_back({offset, symbol, static_cast<uint16_t>(width), kind});
+    }
+
+    void SymbolTable::Link(BitBuffer &bitBuffer, const std::function<void(std::string)> &reportProblem) const {
+        struct Problem {
+            std::string Message;
+            size_t References = 0;
+        };
+
+        // keyed by symbol and kind, so each problem is reported once however often it is referenced
+        std::vector<Problem> problems;
+        std::unordered_map<uint64_t, size_t> problemIndex;
+        auto report = [&](const Relocation &relocation, auto &&makeMessage) {
+            uint64_t key = uint64_t{relocation.Symbol} << 1 | static_cast<uint64_t>(relocation.Kind);
+            auto [it, inserted] = problemIndex.try_emplace(key, problems.size());
+            if (inserted) {
+                problems.push_back({makeMessage(), 0});
+            }
+            ++problems[it->second].References;
+        };
+
+        for (const auto &relocation: m_Relocations) {
+            const auto &definition = m_Definitions[relocation.Symbol];
+            bool isAddress = relocation.Kind == RelocationKind::Address;
+            auto value = isAddress ? definition.Address : definition.Value;
+            std::string_view kindName = isAddress ? "label" : "constant";
+            const auto &name = m_Names[relocation.Symbol];
+
+            if (!value) {
+                report(relocation, [&] { return std::format("{} '{}' is not defined", kindName, name); });
+                continue;
+            }
+            if (relocation.Width < BitBuffer::WordBits && *value >= (uint64_t{1} << relocation.Width)) {
+                report(relocation, [&] {
+                    return std::format("{} '{}' = {} does not fit in {} bits", kindName, name, *value, relocation.Width);
+                });
+                continue;
+            }
+            if (relocation.Offset + relocation.Width > bitBuffer.Size()) {
+                throw Exceptions::CompilerImplementationError(
+                    std::format("Relocation of '{}' at bit {} lies beyond the end of the program", name,
+                                relocation.Offset));
+            }
+
+            bitBuffer.ReplaceBits(*value, relocation.Width, relocation.Offset);
+        }
+
+        for (const auto &problem: problems) {
+            reportProblem(std::format("{} ({} reference{})", problem.Message, problem.References,
+                                      problem.References == 1 ? "" : "s"));
+        }
+    }
+
+    void SymbolTable::Clear() {
+        m_Names.clear();
+        m_Ids.clear();
+        m_Definitions.clear();
+        m_Relocations.clear();
+    }
+}
@@ -0,0 +1,86 @@
+export module Core.SymbolTable;
+
+import std;
+import Vendor.sol;
+import Core.BitBuffer;
+
+namespace Core {
+    export using SymbolId = uint32_t;
+
+    export enum class RelocationKind : uint8_t {
+        Address, // patched with the label's address
+        Constant // patched with the constant's value
+    };
+
+    // A field of the bit buffer left as a dummy until the symbol it refers to is known.
+    export struct Relocation {
+        uint64_t Offset; // bit index of the field's least significant bit
+        SymbolId Symbol;
+        uint16_t Width;
+        RelocationKind Kind;
+    };
+
+    export struct SymbolDefinition {
+        std::optional<uint64_t> Address; // as a label
+        std::optional<uint64_t> Value;   // as a constant
+    };
+
+    // Labels and constants of one source, interned by name, plus the relocations that refer to them.
+    // Labels and constants are separate namespaces, a name may be both.
+    export class SymbolTable {
+    public:
+        SymbolTable() = default;
+
+        SymbolTable(const SymbolTable &) = delete;
+        SymbolTable &operator=(const SymbolTable &) = delete;
+        SymbolTable(SymbolTable &&) = default;
+        SymbolTable &operator=(SymbolTable &&) = default;
+
+        static void AddLibToState(sol::state &state);
+
+        SymbolId Intern(std::string_view name);
+
+        [[nodiscard]] std::optional<SymbolId> Find(std::string_view name) const;
+
+        [[nodiscard]] const std::string &GetName(SymbolId id) const {
+            return m_Names.at(id);
+        }
+
+        [[nodiscard]] size_t GetSymbolCount() const {
+            return m_Names.size();
+        }
+
+        [[nodiscard]] const SymbolDefinition &GetDefinition(SymbolId id) const {
+            return m_Definitions.at(id);
+        }
+
+        // false if the name is already defined as a label (or constant), the old definition is kept.
+        bool DefineLabel(std::string_view name, uint64_t address);
+
+        bool DefineConstant(std::string_view name, uint64_t value);
+
+        [[nodiscard]] std::optional<uint64_t> GetLabel(std::string_view name) const;
+
+        [[nodiscard]] std::optional<uint64_t> GetConstant(std::string_view name) const;
+
+        void AddRelocation(RelocationKind kind, std::string_view name, uint64_t offset, size_t width);
+
+        void AddRelocation(RelocationKind kind, SymbolId symbol, uint64_t offset, size_t width);
+
+        [[nodiscard]] std::span<const Relocation> GetRelocations() const {
+            return m_Relocations;
+        }
+
+        // Patches every relocation in one pass. Each unresolved or out of range symbol is handed to
+        // reportProblem once, after the pass; the buffer is only left partially patched then.
+        void Link(BitBuffer &bitBuffer, const std::function<void(std::string)> &reportProblem) const;
+
+        void Clear();
+
+    private:
+        std::deque<std::string> m_Names; // deque keeps the keys of m_Ids in place as it grows
+        std::unordered_map<std::string_view, SymbolId> m_Ids;
+        std::vector<SymbolDefinition> m_Definitions;
+        std::vector<Relocation> m_Relocations;
+    };
+}
@@ -0,0 +1,52 @@
+export module Core.WorkerPool;
+
+import std;
+
+namespace Core {
+    export size_t GetDefaultWorkerCount() {
+        auto count = std::thread::hardware_concurrency();
+        return count == 0 ? 1 : count;
+    }
+
+    // Runs process(state, index) for every index in [0, count) on up to threadCount threads. Every thread
+    // builds its own state with makeWorkerState() before taking work, so per-thread resources such as a
+    // Compiler and its sol::state are never shared. Indices are handed out in order from an atomic counter.
+    // The first exception escaping a worker is rethrown on the calling thread after all workers joined.
+    export template<typename MakeWorkerState, typename Process>
+    void ParallelForEach(size_t count, size_t threadCount, MakeWorkerState &&makeWorkerState, Process &&process) {
+        if (count == 0)
+            return;
+
+        threadCount = std::clamp<size_t>(threadCount, 1, count);
+
+        std::atomic<size_t> next{0};
+        std::exception_ptr firstError;
+        std::mutex errorMutex;
+
+        auto worker = [&] {
+            try {
+                auto state = makeWorkerState();
+                for (size_t index = next.fetch_add(1); index < count; index = next.fetch_add(1)) {
+                    process(state, index);
+                }
+            } catch (...) {
+                std::scoped_lock lock(errorMutex);
+                if (!firstError)
+                    firstError = std::current_exception();
+                next.store(count); // stop handing out work
+            }
+        };
+
+        {
+            std::vector<std::jthread> threads;
+            threads.reserve(threadCount - 1);
+            for (size_t i = 1; i < threadCount; ++i) {
+                threads.emplace_back(worker);
+            }
+            worker();
+        }
+
+        if (firstError)
+            std::rethrow_exception(firstError);
+    }
+}
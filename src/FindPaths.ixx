@@ -2,23 +2,204 @@ export module FindPaths;
 
 import std;
 import <args.hxx>;
+import Core.Output;
+import Core.BuildCache;
+import Core.Assembler;
+import Core.DeadCode;
+
+namespace {
+    // '*' and '?' never cross a '/', '**' matches any number of whole directories
+    bool MatchGlob(std::string_view pattern, std::string_view path) {
+        if (pattern.empty())
+            return path.empty();
+
+        if (pattern.starts_with("**")) {
+            auto rest = pattern.substr(2);
+            if (rest.starts_with('/'))
+                rest.remove_prefix(1);
+            if (rest.empty())
+                return true;
+            for (size_t i = 0; i <= path.size(); ++i) {
+                if ((i == 0 || path[i - 1] == '/') && MatchGlob(rest, path.substr(i)))
+                    return true;
+            }
+            return false;
+        }
+
+        if (pattern.front() == '*') {
+            for (size_t i = 0; i <= path.size(); ++i) {
+                if (MatchGlob(pattern.substr(1), path.substr(i)))
+                    return true;
+                if (i < path.size() && path[i] == '/')
+                    return false;
+            }
+            return false;
+        }
+
+        if (path.empty())
+            return false;
+        if (pattern.front() != '?' && pattern.front() != path.front())
+            return false;
+        if (pattern.front() == '?' && path.front() == '/')
+            return false;
+        return MatchGlob(pattern.substr(1), path.substr(1));
+    }
+
+    std::vector<std::filesystem::path> ExpandGlob(const std::string &pattern) {
+        std::string generic = std::filesystem::path(pattern).generic_string();
+        auto firstWildcard = generic.find_first_of("*?");
+        if (firstWildcard == std::string::npos) {
+            return {std::filesystem::path(generic)};
+        }
+
+        auto baseEnd = generic.rfind('/', firstWildcard);
+        std::filesystem::path baseDir = baseEnd == std::string::npos
+                                            ? std::filesystem::path(".")
+                                            : std::filesystem::path(generic.substr(0, baseEnd));
+        std::string relativePattern = baseEnd == std::string::npos ? generic : generic.substr(baseEnd + 1);
+
+        std::vector<std::filesystem::path> matches;
+        std::error_code error;
+        if (!std::filesystem::is_directory(baseDir, error))
+            return matches;
+
+        // only '**' crosses directories, without it the walk goes no deeper than the pattern
+        bool recursive = relativePattern.find("**") != std::string::npos;
+        auto depth = static_cast<int>(std::ranges::count(relativePattern, '/'));
+
+        std::filesystem::recursive_directory_iterator it(
+            baseDir, std::filesystem::directory_options::skip_permission_denied, error);
+        for (; !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+            if (!recursive && it.depth() >= depth)
+                it.disable_recursion_pending();
+            std::error_code typeError;
+            if (!it->is_regular_file(typeError))
+                continue;
+            auto relative = it->path().lexically_relative(baseDir).generic_string();
+            if (MatchGlob(relativePattern, relative)) {
+                matches.push_back(it->path());
+            }
+        }
+        if (error) {
+            std::cerr << "Error: Cannot expand glob pattern " << pattern << ": " << error.message() << "\n";
+            std::exit(1);
+        }
+
+        std::ranges::sort(matches);
+        return matches;
+    }
+
+    std::vector<std::filesystem::path> ReadManifest(const std::filesystem::path &manifestPath) {
+        std::ifstream manifest(manifestPath);
+        if (!manifest) {
+            std::cerr << "Error: Cannot open manifest file: " << manifestPath.string() << "\n";
+            std::exit(1);
+        }
+
+        std::vector<std::filesystem::path> entries;
+        std::string line;
+        while (std::getline(manifest, line)) {
+            auto first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#')
+                continue;
+            auto last = line.find_last_not_of(" \t\r");
+            std::filesystem::path entry(line.substr(first, last - first + 1));
+            entries.push_back(entry.is_relative() ? manifestPath.parent_path() / entry : entry);
+        }
+        return entries;
+    }
+}
 
 export class ProgramPaths {
 public:
     ProgramPaths(int argc, char* argv[]) {
         args::ArgumentParser parser(
     "A simple assembler architecture",
-    "Usage example:\n  EasyASM -l ../../PicoBlaze -i ../../tests/test_compile_psm.psm -o ./out");
+    "Usage example:\n  EasyASM -l ../../PicoBlaze -i ../../tests/test_compile_psm.psm -o ./out\n"
+    "  EasyASM -l ../../PicoBlaze --glob \"firmware/**/*.psm\" -o ./out -j 8");
         args::HelpFlag help(parser, "help", "Display this help menu", {'h', "help"});
         args::ValueFlag<std::string> languageRootDirFlag(
             parser, "languageRootDir", "Path to the library root directory of the language",
             {'l', "language-root-dir"});
-        args::ValueFlag<std::string> sourceFilePathFlag(
+        args::ValueFlagList<std::string> sourceFilePathFlag(
             parser, "Input file",
-            "Path to the source file to compile", {'i', "input"});
+            "Path to the source file to compile ('-' reads stdin), may be repeated", {'i', "input"});
+        args::ValueFlagList<std::string> globFlag(
+            parser, "Glob pattern",
+            "Compile every file matching the pattern ('*', '?', '**'), may be repeated", {"glob"});
+        args::ValueFlag<std::string> manifestFlag(
+            parser, "Manifest file",
+            "Compile every file listed in the manifest, one path per line", {"manifest"});
+        args::ValueFlag<size_t> jobsFlag(
+            parser, "Jobs",
+            "Number of worker threads for batch and --parallel compilation (defaults to the number of cores)", {'j', "jobs"});
+        args::Flag serverFlag(
+            parser, "Server",
+            "Keep the language loaded and serve compile requests over stdin/stdout (Content-Length framed JSON)",
+            {"server"});
+        args::ValueFlag<std::string> socketFlag(
+            parser, "Socket path",
+            "Serve compile requests on a local (Unix domain) socket instead of stdin/stdout, implies --server",
+            {"socket"});
+        args::Flag buildBundleFlag(
+            parser, "Build bundle",
+            "Precompile the language libraries and specification into <language-root-dir>/Language.bundle",
+            {"build-bundle"});
         args::ValueFlag<std::string> outputDirFlag(
             parser, "Output directory",
             "Path to the directory where the output will be written", {'o', "output"});
+        args::ValueFlagList<std::string> outputFormatFlag(
+            parser, "Output format",
+            "Output format to write (mem, hex, bin, coe, vhd, v), may be repeated. Overrides 'OutputFormat' of the language",
+            {'f', "format"});
+        args::Flag compileOnlyFlag(
+            parser, "Compile only",
+            "Compile every input to a relocatable object file (<stem>.eo) without linking it",
+            {'c', "compile-only"});
+        args::Flag linkFlag(
+            parser, "Link",
+            "Treat the inputs as object files, place them in the given order and link them into one image",
+            {"link"});
+        args::Flag parallelFlag(
+            parser, "Parallel",
+            "Split a single source into chunks encoded on -j threads, the image is identical to a sequential run",
+            {"parallel"});
+        args::Flag simulateFlag(
+            parser, "Simulate",
+            "Treat the inputs as simulation tests (YAML), run them on the built-in PicoBlaze simulator on -j threads",
+            {"simulate"});
+        args::ValueFlag<std::string> cacheDirFlag(
+            parser, "Cache directory",
+            "Reuse images assembled before from the same source, language and formats, stored in this directory",
+            {"cache-dir"});
+        args::ValueFlag<uint64_t> cacheMaxSizeFlag(
+            parser, "Cache size",
+            "Size limit of --cache-dir in MiB, least recently used images are evicted beyond it (default 1024)",
+            {"cache-max-size"});
+        args::Flag stripUnusedFlag(
+            parser, "Strip unused",
+            "Remove code no root reaches before linking: address 0, code placed by ADDRESS and --keep labels",
+            {"strip-unused"});
+        args::ValueFlagList<std::string> keepFlag(
+            parser, "Label",
+            "Keep this label and what it reaches with --strip-unused, e.g. an entry point called from outside, may be repeated",
+            {"keep"});
+        args::Flag memoryReportFlag(
+            parser, "Memory report",
+            "Print the program memory used by every label, and what is unused (or removed with --strip-unused)",
+            {"memory-report"});
+        args::ValueFlag<std::string> diagnosticsFormatFlag(
+            parser, "Diagnostics format",
+            "How compile errors are reported: 'text' (default) on stderr, or 'json' on stdout, one object per source",
+            {"diagnostics-format"});
+        args::Flag profileFlag(
+            parser, "Profile",
+            "Time every phase and handler, print a summary and write a Chrome trace (not available with --server)",
+            {"profile"});
+        args::ValueFlag<std::string> profileTraceFlag(
+            parser, "Trace file",
+            "Path of the Chrome trace written by --profile (defaults to EasyASM.trace.json in the output directory)",
+            {"profile-trace"});
 
         try {
             parser.ParseCLI(argc, argv);
@@ -30,7 +211,62 @@ public:
             std::exit(1);
         }
 
-        if (!languageRootDirFlag || !sourceFilePathFlag) {
+        server = serverFlag || socketFlag;
+        buildBundle = buildBundleFlag;
+        compileOnly = compileOnlyFlag;
+        link = linkFlag;
+        if (compileOnly && link) {
+            std::cerr << "Error: --compile-only and --link cannot be combined." << std::endl;
+            std::exit(1);
+        }
+        parallel = parallelFlag;
+        if (parallel && (compileOnly || link)) {
+            std::cerr << "Error: --parallel cannot be combined with --compile-only or --link." << std::endl;
+            std::exit(1);
+        }
+        simulate = simulateFlag;
+        if (simulate && (compileOnly || link || parallel || server)) {
+            std::cerr << "Error: --simulate cannot be combined with --compile-only, --link, --parallel or --server."
+                      << std::endl;
+            std::exit(1);
+        }
+        deadCodeOptions.RemoveUnused = stripUnusedFlag;
+        deadCodeOptions.PrintReport = memoryReportFlag;
+        deadCodeOptions.KeepLabels = args::get(keepFlag);
+        if (deadCodeOptions.IsEnabled() && (compileOnly || link || simulate || server)) {
+            // objects do not record where ADDRESS placed code, so their code cannot be moved safely
+            std::cerr << "Error: --strip-unused and --memory-report need a source, they cannot be combined with "
+                         "--compile-only, --link, --simulate or --server." << std::endl;
+            std::exit(1);
+        }
+        if (!deadCodeOptions.KeepLabels.empty() && !deadCodeOptions.RemoveUnused) {
+            std::cerr << "Error: --keep only applies to --strip-unused." << std::endl;
+            std::exit(1);
+        }
+        if (cacheDirFlag) {
+            cacheDir = std::filesystem::path(args::get(cacheDirFlag));
+        }
+        if (cacheMaxSizeFlag) {
+            cacheMaxBytes = args::get(cacheMaxSizeFlag) << 20;
+        }
+        if (diagnosticsFormatFlag) {
+            auto format = args::get(diagnosticsFormatFlag);
+            if (format != "text" && format != "json") {
+                std::cerr << "Error: Unknown diagnostics format: " << format << "\n";
+                std::exit(1);
+            }
+            jsonDiagnostics = format == "json";
+        }
+        profile = profileFlag || profileTraceFlag;
+        if (profile && server) {
+            std::cerr << "Error: --profile cannot be combined with --server." << std::endl;
+            std::exit(1);
+        }
+        if (socketFlag) {
+            socketPath = std::filesystem::path(args::get(socketFlag));
+        }
+
+        if (!languageRootDirFlag || (!server && !buildBundle && !sourceFilePathFlag && !globFlag && !manifestFlag)) {
             std::cerr << "Error: Missing required arguments." << std::endl;
             parser.Help(std::cerr);
             std::exit(1);
@@ -42,23 +278,81 @@ public:
             std::cerr << "Error: Language root directory does not exist: " << languageRootDirStr << "\n";
             std::exit(1);
         }
-        std::string sourceFilePathStr = args::get(sourceFilePathFlag);
-        sourceFilePath = std::filesystem::path(sourceFilePathStr);
-        if (!std::filesystem::exists(sourceFilePath)) {
-            std::cerr << "Error: Source file does not exist: " << sourceFilePathStr << "\n";
+
+        for (const auto &sourceFilePathStr: args::get(sourceFilePathFlag)) {
+            sourceFilePaths.emplace_back(sourceFilePathStr);
+        }
+        for (const auto &pattern: args::get(globFlag)) {
+            auto matches = ExpandGlob(pattern);
+            if (matches.empty()) {
+                std::cerr << "Warning: Glob pattern matched no files: " << pattern << "\n";
+            }
+            sourceFilePaths.insert(sourceFilePaths.end(), matches.begin(), matches.end());
+        }
+        if (manifestFlag) {
+            auto entries = ReadManifest(args::get(manifestFlag));
+            sourceFilePaths.insert(sourceFilePaths.end(), entries.begin(), entries.end());
+        }
+
+        if (server || buildBundle) {
+            return; // no sources needed, for a server they arrive with the requests
+        }
+
+        if (sourceFilePaths.empty()) {
+            std::cerr << "Error: No source files to compile." << "\n";
+            std::exit(1);
+        }
+        for (const auto &path: sourceFilePaths) {
+            if (path == Core::StdinSourcePath) {
+                continue;
+            }
+            if (!std::filesystem::exists(path)) {
+                std::cerr << "Error: Source file does not exist: " << path.string() << "\n";
+                std::exit(1);
+            }
+        }
+        sourceFilePath = sourceFilePaths.front();
+        // the objects of a link all go into one image
+        batch = !link && !simulate && (sourceFilePaths.size() > 1 || globFlag || manifestFlag);
+        jobs = jobsFlag ? std::max<size_t>(args::get(jobsFlag), 1) : 0;
+        if (parallel && batch) {
+            std::cerr << "Error: --parallel assembles a single source, batches are already spread over -j workers."
+                      << "\n";
             std::exit(1);
         }
+        if ((batch || link || simulate) && std::ranges::contains(sourceFilePaths, std::filesystem::path(Core::StdinSourcePath))) {
+            std::cerr << "Error: Standard input ('-') can only be assembled on its own." << "\n";
+            std::exit(1);
+        }
+
         if (outputDirFlag) {
             std::string outputDirStr = args::get(outputDirFlag);
             outputDir = std::filesystem::path(outputDirStr);
             if (!std::filesystem::exists(outputDir)) {
                 std::filesystem::create_directories(outputDir);
             }
+            hasOutputDir = true;
         } else {
             outputDir = sourceFilePath.parent_path();
         }
 
-        outputFileName = sourceFilePath.filename().string();
+        for (const auto &formatName: args::get(outputFormatFlag)) {
+            auto format = Core::Output::ParseOutputFormat(formatName);
+            if (!format) {
+                std::cerr << "Error: Unknown output format: " << formatName << "\n";
+                std::exit(1);
+            }
+            outputFormats.push_back(*format);
+        }
+
+        if (profile) {
+            profileTracePath = profileTraceFlag
+                                   ? std::filesystem::path(args::get(profileTraceFlag))
+                                   : outputDir / "EasyASM.trace.json";
+        }
+
+        outputFileName = sourceFilePath == Core::StdinSourcePath ? "stdin.mem" : sourceFilePath.filename().string();
+        outputStem = sourceFilePath == Core::StdinSourcePath ? "stdin" : sourceFilePath.stem().string();
         if (outputFileName.find_last_of('.') != std::string::npos) {
             outputFileName = outputFileName.substr(0, outputFileName.find_last_of('.')) + ".mem";
         }
@@ -72,17 +366,116 @@ public:
         return sourceFilePath;
     }
 
+    const std::vector<std::filesystem::path>& GetSourceFilePaths() const {
+        return sourceFilePaths;
+    }
+
     const std::filesystem::path& GetOutputDir() const {
         return outputDir;
     }
 
+    // Output directory of any input: the -o directory if given, otherwise next to the source
+    std::filesystem::path GetOutputDirFor(const std::filesystem::path& source) const {
+        return hasOutputDir ? outputDir : source.parent_path();
+    }
+
     const std::string& GetOutputFileName() const {
         return outputFileName;
     }
 
+    const std::string& GetOutputStem() const {
+        return outputStem;
+    }
+
+    const std::vector<Core::Output::OutputFormat>& GetOutputFormats() const {
+        return outputFormats;
+    }
+
+    bool IsBatch() const {
+        return batch;
+    }
+
+    bool IsBuildBundle() const {
+        return buildBundle;
+    }
+
+    bool IsServer() const {
+        return server;
+    }
+
+    const std::optional<std::filesystem::path>& GetSocketPath() const {
+        return socketPath;
+    }
+
+    bool IsCompileOnly() const {
+        return compileOnly;
+    }
+
+    bool IsLink() const {
+        return link;
+    }
+
+    bool IsParallel() const {
+        return parallel;
+    }
+
+    // The inputs are simulation tests rather than sources.
+    bool IsSimulate() const {
+        return simulate;
+    }
+
+    // Only used when assembling images, object files and links are always built.
+    const std::optional<std::filesystem::path>& GetCacheDir() const {
+        return cacheDir;
+    }
+
+    uint64_t GetCacheMaxBytes() const {
+        return cacheMaxBytes;
+    }
+
+    const Core::DeadCode::Options& GetDeadCodeOptions() const {
+        return deadCodeOptions;
+    }
+
+    bool IsJsonDiagnostics() const {
+        return jsonDiagnostics;
+    }
+
+    bool IsProfiling() const {
+        return profile;
+    }
+
+    const std::filesystem::path& GetProfileTracePath() const {
+        return profileTracePath;
+    }
+
+    // 0 means one worker per core
+    size_t GetJobCount() const {
+        return jobs;
+    }
+
 private:
     std::filesystem::path languageRootDir;
     std::filesystem::path sourceFilePath;
+    std::vector<std::filesystem::path> sourceFilePaths;
     std::filesystem::path outputDir;
+    bool hasOutputDir = false;
     std::string outputFileName;
+    std::string outputStem;
+    std::vector<Core::Output::OutputFormat> outputFormats;
+    bool batch = false;
+    size_t jobs = 0;
+    bool server = false;
+    bool buildBundle = false;
+    std::optional<std::filesystem::path> socketPath;
+    bool compileOnly = false;
+    bool link = false;
+    bool parallel = false;
+    bool simulate = false;
+    std::optional<std::filesystem::path> cacheDir;
+    uint64_t cacheMaxBytes = Core::Cache::DefaultMaxCacheBytes;
+    Core::DeadCode::Options deadCodeOptions;
+    bool jsonDiagnostics = false;
+    bool profile = false;
+    std::filesystem::path profileTracePath;
 };
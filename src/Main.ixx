@@ -5,39 +5,155 @@ import Vendor.yaml;
 import <cassert>;
 
 import Core.Compiler;
+import Core.Assembler;
 import std;
 import FindPaths;
+import Batch;
+import Server;
+import Simulate;
 import Core.Exceptions;
+import Core.Profiler;
+import Core.BuildCache;
+import Core.ChunkedAssembly;
+import Core.Diagnostics;
+import Core.Json;
 
-export int main(int argc, char *argv[]) {
-    ProgramPaths paths{argc, argv};
-    try {
-        Core::Compiler compiler{paths.GetLanguageRootDir()};
-        auto sourceFile = std::ifstream(paths.GetSourceFilePath());
-        std::string source((std::istreambuf_iterator<char>(sourceFile)),
-             std::istreambuf_iterator<char>());
-
-        Core::SourceCompiler sourceCompiler{compiler.CreateSourceCompiler(source)};
-        sourceCompiler.CompileAll();
-        sourceCompiler.Link();
-        std::ofstream outputFile(paths.GetOutputDir() / paths.GetOutputFileName());
-        outputFile << sourceCompiler.GenerateOutput();
-        std::u8string u8str = (paths.GetOutputDir() / paths.GetOutputFileName()).u8string();
-        std::string out(reinterpret_cast<const char*>(u8str.c_str()), u8str.size());
-        std::cout << "Compilation successful. Output has been written to: "
-                  << out << "\n";
-    } catch (const std::exception &e) {
-        std::cerr << std::format("Compilation failed due to an error:\n{}\n",
-                         e.what());
-        if (auto wrapped = dynamic_cast<const Core::Exceptions::WrappedGenericException*>(&e)) {
-            if (auto implementationError = dynamic_cast<const Core::Exceptions::CompilerImplementationError*>(wrapped->GetPointer())) {
-                return -1;
+namespace {
+    void ReportProfile(const Core::Profiling::Profiler &profiler, const std::filesystem::path &tracePath) {
+        std::cout << "\nProfile:\n" << profiler.FormatSummary();
+        try {
+            profiler.WriteChromeTrace(tracePath);
+            std::cout << "Chrome trace has been written to: " << tracePath.string() << "\n";
+        } catch (const std::exception &e) {
+            std::cerr << std::format("Failed to write the profile trace:\n{}\n", e.what());
+        }
+    }
+
+    struct CacheContext {
+        std::unique_ptr<Core::Cache::BuildCache> Cache;
+        std::string LanguageDigest;
+    };
+
+    // A cache that cannot be opened only costs the speedup, the build goes on without it.
+    CacheContext OpenBuildCache(const ProgramPaths &paths) {
+        CacheContext context;
+        // a hit prints no memory report
+        if (!paths.GetCacheDir() || paths.IsCompileOnly() || paths.IsLink() ||
+            paths.GetDeadCodeOptions().PrintReport) {
+            return context;
+        }
+        try {
+            context.LanguageDigest = Core::Cache::ComputeLanguageDigest(paths.GetLanguageRootDir());
+            context.Cache = std::make_unique<Core::Cache::BuildCache>(*paths.GetCacheDir(), paths.GetCacheMaxBytes());
+        } catch (const std::exception &e) {
+            std::cerr << std::format("Warning: Build cache disabled:\n{}\n", e.what());
+            context.Cache.reset();
+        }
+        return context;
+    }
+
+    int RunSingle(const ProgramPaths &paths, std::shared_ptr<Core::Profiling::Profiler> profiler,
+                  const CacheContext &cache) {
+        try {
+            // created on demand, a cache hit never needs the Compiler or its Lua state
+            std::optional<Core::Compiler> compiler;
+            auto getCompiler = [&]() -> const Core::Compiler & {
+                if (!compiler) {
+                    compiler.emplace(paths.GetLanguageRootDir(), profiler);
+                }
+                return *compiler;
+            };
+
+            Core::AssembleJob job{paths.GetSourceFilePath(), paths.GetOutputDir(), paths.GetOutputStem()};
+            job.DeadCodeOptions = paths.GetDeadCodeOptions();
+            if (paths.IsParallel()) {
+                job.Chunking = Core::Chunked::ChunkedOptions{paths.GetLanguageRootDir(), paths.GetJobCount()};
+            }
+            std::vector<std::filesystem::path> outputPaths;
+            bool cacheHit = false;
+            if (paths.IsCompileOnly()) {
+                outputPaths = {Core::CompileObjectFile(getCompiler(), job)};
+            } else if (paths.IsLink()) {
+                outputPaths = Core::LinkObjectFiles(getCompiler(), paths.GetSourceFilePaths(), paths.GetOutputDir(),
+                                                    paths.GetOutputStem(), paths.GetOutputFormats());
+            } else if (cache.Cache) {
+                auto result = Core::AssembleFileCached(*cache.Cache, cache.LanguageDigest, getCompiler, job,
+                                                       paths.GetOutputFormats());
+                outputPaths = std::move(result.OutputPaths);
+                cacheHit = result.CacheHit;
+            } else {
+                outputPaths = Core::AssembleFile(getCompiler(), job, paths.GetOutputFormats());
+            }
+
+            std::string out;
+            for (const auto &outputPath: outputPaths) {
+                std::u8string u8str = outputPath.u8string();
+                if (!out.empty())
+                    out += ", ";
+                out.append(reinterpret_cast<const char*>(u8str.c_str()), u8str.size());
+            }
+            std::cout << (cacheHit ? "Compilation successful (cached). Output has been written to: "
+                                   : "Compilation successful. Output has been written to: ")
+                      << out << "\n";
+        } catch (const Core::DiagnosticError &e) {
+            std::u8string u8str = paths.GetSourceFilePath().u8string();
+            std::string sourceName(reinterpret_cast<const char*>(u8str.c_str()), u8str.size());
+            if (paths.IsJsonDiagnostics()) {
+                Core::Json::JsonWriter writer;
+                Core::WriteDiagnosticsJson(writer, e.GetDiagnostics(), sourceName);
+                std::cout << writer.GetOutput() << "\n";
+            } else {
+                std::cerr << std::format("Compilation failed due to an error:\n{}\n",
+                                         Core::FormatDiagnostics(e.GetDiagnostics(), sourceName));
             }
+            return 1;
+        } catch (const std::exception &e) {
+            std::cerr << std::format("Compilation failed due to an error:\n{}\n",
+                             e.what());
+            if (auto wrapped = dynamic_cast<const Core::Exceptions::WrappedGenericException*>(&e)) {
+                if (auto implementationError = dynamic_cast<const Core::Exceptions::CompilerImplementationError*>(wrapped->GetPointer())) {
+                    return -1;
+                }
+            }
+            return 1;
+        } catch (...) {
+            std::cerr << "Compilation failed due to an unknown error.\n";
+            return 1;
         }
-    } catch (...) {
-        std::cerr << "Compilation failed due to an unknown error.\n";
-        return 1;
+
+        return 0;
     }
+}
 
-    return 0;
+export int main(int argc, char *argv[]) {
+    ProgramPaths paths{argc, argv};
+    if (paths.IsBuildBundle()) {
+        try {
+            auto bundlePath = Core::Compiler::BuildBundle(paths.GetLanguageRootDir());
+            std::cout << "Language bundle has been written to: " << bundlePath.string() << "\n";
+            return 0;
+        } catch (const std::exception &e) {
+            std::cerr << std::format("Failed to build language bundle:\n{}\n", e.what());
+            return 1;
+        }
+    }
+    if (paths.IsServer()) {
+        return RunServer(paths);
+    }
+    if (paths.IsSimulate()) {
+        return RunSimulations(paths);
+    }
+    // a failed run is profiled as well, up to the point where it stopped
+    auto profiler = paths.IsProfiling() ? std::make_shared<Core::Profiling::Profiler>() : nullptr;
+    auto cache = OpenBuildCache(paths);
+    int result = paths.IsBatch()
+                     ? RunBatch(paths, profiler, cache.Cache.get(), cache.LanguageDigest)
+                     : RunSingle(paths, profiler, cache);
+    if (profiler) {
+        ReportProfile(*profiler, paths.GetProfileTracePath());
+    }
+    if (cache.Cache) {
+        cache.Cache->Trim();
+    }
+    return result;
 }
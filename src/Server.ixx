@@ -0,0 +1,588 @@
+module;
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <afunix.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+export module Server;
+
+import std;
+import Vendor.yaml;
+import FindPaths;
+import Core.Compiler;
+import Core.Output;
+import Core.Json;
+import Core.Diagnostics;
+import Core.Incremental;
+
+namespace {
+#ifdef _WIN32
+    using NativeSocket = SOCKET;
+    constexpr NativeSocket invalidSocket = INVALID_SOCKET;
+
+    void CloseSocket(NativeSocket socket) {
+        closesocket(socket);
+    }
+
+    std::string GetLastSocketError() {
+        return std::system_category().message(WSAGetLastError());
+    }
+#else
+    using NativeSocket = int;
+    constexpr NativeSocket invalidSocket = -1;
+
+    void CloseSocket(NativeSocket socket) {
+        close(socket);
+    }
+
+    std::string GetLastSocketError() {
+        return std::generic_category().message(errno);
+    }
+#endif
+
+    // A client that hangs up before reading its reply must fail the write, not raise SIGPIPE and end the
+    // server. Platforms without MSG_NOSIGNAL set SO_NOSIGPIPE on the socket instead.
+#ifdef MSG_NOSIGNAL
+    constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+    constexpr int sendFlags = 0;
+#endif
+
+    // Messages are framed like LSP: "Content-Length: N\r\n\r\n" followed by N bytes of JSON.
+    class MessageChannel {
+    public:
+        // Larger bodies are skipped and longer header lines cut off rather than buffered, a peer can't make
+        // the server allocate any size.
+        static constexpr size_t maxMessageSize = 64 << 20;
+        static constexpr size_t maxHeaderLineSize = 8 << 10;
+
+        struct Message {
+            std::string Body;
+            std::optional<std::string> Error; // the frame was consumed but can't be handled, Body is empty
+        };
+
+        virtual ~MessageChannel() = default;
+
+        // Returns nullopt once the peer closed the channel.
+        std::optional<Message> ReadMessage() {
+            constexpr std::string_view contentLengthHeader = "Content-Length:";
+            std::optional<size_t> contentLength;
+            std::optional<std::string> error;
+            while (true) {
+                bool overlong = false;
+                auto line = ReadLine(overlong);
+                if (!line)
+                    return std::nullopt;
+                if (overlong) {
+                    error = std::format("Header line exceeds {} bytes", maxHeaderLineSize);
+                    continue;
+                }
+                if (line->empty()) {
+                    if (contentLength || error)
+                        break;
+                    continue; // tolerate blank lines between frames
+                }
+                if (line->starts_with(contentLengthHeader)) {
+                    auto value = std::string_view(*line).substr(contentLengthHeader.size());
+                    value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+                    size_t length = 0;
+                    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+                    if (ec != std::errc{}) {
+                        error = std::format("Malformed header '{}'", *line);
+                        continue;
+                    }
+                    contentLength = length;
+                }
+                // other headers are ignored
+            }
+
+            if (!contentLength)
+                return Message{{}, std::move(error)};
+            if (*contentLength > maxMessageSize) {
+                if (!Skip(*contentLength))
+                    return std::nullopt;
+                return Message{{}, std::format("Message of {} bytes exceeds the limit of {} bytes",
+                                               *contentLength, maxMessageSize)};
+            }
+
+            std::string body(*contentLength, '\0');
+            if (!ReadExact(body.data(), body.size()))
+                return std::nullopt;
+            return Message{std::move(body), std::move(error)};
+        }
+
+        void WriteMessage(std::string_view body) {
+            WriteAll(std::format("Content-Length: {}\r\n\r\n", body.size()));
+            WriteAll(body);
+            FlushOutput();
+        }
+
+    protected:
+        // Returns 0 at the end of the stream
+        virtual size_t ReadSome(char *buffer, size_t size) = 0;
+
+        virtual void WriteAll(std::string_view data) = 0;
+
+        virtual void FlushOutput() {}
+
+    private:
+        bool Fill() {
+            if (m_Begin < m_End)
+                return true;
+            m_Begin = 0;
+            m_End = ReadSome(m_Buffer.data(), m_Buffer.size());
+            return m_End > 0;
+        }
+
+        // Drops what goes past maxHeaderLineSize, but still consumes the line up to its end.
+        std::optional<std::string> ReadLine(bool &overlong) {
+            std::string line;
+            while (true) {
+                if (!Fill())
+                    return line.empty() ? std::nullopt : std::optional(std::move(line));
+                char c = m_Buffer[m_Begin++];
+                if (c == '\n') {
+                    if (!line.empty() && line.back() == '\r')
+                        line.pop_back();
+                    return line;
+                }
+                if (line.size() < maxHeaderLineSize) {
+                    line += c;
+                } else {
+                    overlong = true;
+                }
+            }
+        }
+
+        bool ReadExact(char *output, size_t size) {
+            while (size > 0) {
+                if (!Fill())
+                    return false;
+                size_t count = std::min(size, m_End - m_Begin);
+                std::memcpy(output, m_Buffer.data() + m_Begin, count);
+                m_Begin += count;
+                output += count;
+                size -= count;
+            }
+            return true;
+        }
+
+        bool Skip(size_t size) {
+            while (size > 0) {
+                if (!Fill())
+                    return false;
+                size_t count = std::min(size, m_End - m_Begin);
+                m_Begin += count;
+                size -= count;
+            }
+            return true;
+        }
+
+        std::array<char, 1 << 16> m_Buffer{};
+        size_t m_Begin = 0;
+        size_t m_End = 0;
+    };
+
+    class StdioChannel : public MessageChannel {
+    public:
+        StdioChannel() {
+#ifdef _WIN32
+            _setmode(_fileno(stdin), _O_BINARY);
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        }
+
+    protected:
+        size_t ReadSome(char *buffer, size_t size) override {
+#ifdef _WIN32
+            int count = _read(_fileno(stdin), buffer, static_cast<unsigned>(size));
+#else
+            auto count = read(STDIN_FILENO, buffer, size);
+#endif
+            return count > 0 ? static_cast<size_t>(count) : 0;
+        }
+
+        void WriteAll(std::string_view data) override {
+            std::fwrite(data.data(), 1, data.size(), stdout);
+        }
+
+        void FlushOutput() override {
+            std::fflush(stdout);
+        }
+    };
+
+    class SocketChannel : public MessageChannel {
+    public:
+        explicit SocketChannel(NativeSocket socket) : m_Socket(socket) {
+#ifdef SO_NOSIGPIPE
+            int enable = 1;
+            setsockopt(m_Socket, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#endif
+        }
+
+        ~SocketChannel() override {
+            CloseSocket(m_Socket);
+        }
+
+    protected:
+        size_t ReadSome(char *buffer, size_t size) override {
+            auto count = recv(m_Socket, buffer, static_cast<int>(size), 0);
+            return count > 0 ? static_cast<size_t>(count) : 0;
+        }
+
+        void WriteAll(std::string_view data) override {
+            while (!data.empty()) {
+                auto count = send(m_Socket, data.data(), static_cast<int>(data.size()), sendFlags);
+                if (count <= 0)
+                    throw std::runtime_error("Failed to write to the client socket");
+                data.remove_prefix(static_cast<size_t>(count));
+            }
+        }
+
+    private:
+        NativeSocket m_Socket;
+    };
+
+    std::string EncodeBase64(std::string_view data) {
+        constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string encoded;
+        encoded.reserve((data.size() + 2) / 3 * 4);
+        for (size_t i = 0; i < data.size(); i += 3) {
+            uint32_t chunk = static_cast<uint8_t>(data[i]) << 16;
+            if (i + 1 < data.size())
+                chunk |= static_cast<uint8_t>(data[i + 1]) << 8;
+            if (i + 2 < data.size())
+                chunk |= static_cast<uint8_t>(data[i + 2]);
+            encoded += alphabet[(chunk >> 18) & 0x3F];
+            encoded += alphabet[(chunk >> 12) & 0x3F];
+            encoded += i + 1 < data.size() ? alphabet[(chunk >> 6) & 0x3F] : '=';
+            encoded += i + 2 < data.size() ? alphabet[chunk & 0x3F] : '=';
+        }
+        return encoded;
+    }
+
+    class ServerSession {
+    public:
+        explicit ServerSession(Core::Compiler &compiler) : m_Compiler(compiler) {
+            m_Compiler.SetPrintHandler([this](std::string_view line) {
+                m_Messages.emplace_back(line);
+            });
+        }
+
+        bool IsShutdownRequested() const {
+            return m_ShutdownRequested;
+        }
+
+        void Serve(MessageChannel &channel) {
+            while (!m_ShutdownRequested) {
+                auto message = channel.ReadMessage();
+                if (!message)
+                    return;
+                channel.WriteMessage(message->Error ? RejectMessage(*message->Error) : HandleRequest(message->Body));
+            }
+        }
+
+    private:
+        std::string RejectMessage(std::string_view error) {
+            m_Messages.clear();
+            Core::Json::JsonWriter response;
+            response.BeginObject();
+            response.Key("id").Null();
+            WriteFailure(response, error);
+            return response.EndObject().TakeOutput();
+        }
+
+        std::string HandleRequest(std::string_view body) {
+            auto start = std::chrono::steady_clock::now();
+            m_Messages.clear();
+
+            Core::Json::JsonWriter response;
+            response.BeginObject();
+
+            YAML::Node request;
+            try {
+                request = YAML::Load(std::string(body));
+            } catch (const YAML::Exception &e) {
+                response.Key("id").Null();
+                WriteFailure(response, std::format("Malformed request: {}", e.what()));
+                return response.EndObject().TakeOutput();
+            }
+            if (!request.IsMap()) {
+                response.Key("id").Null();
+                WriteFailure(response, "Malformed request: expected an object");
+                return response.EndObject().TakeOutput();
+            }
+
+            try {
+                WriteId(response, request["id"]);
+                auto method = request["method"] ? request["method"].as<std::string>() : std::string("compile");
+                if (method == "compile") {
+                    Compile(request, response);
+                } else if (method == "update") {
+                    Update(request, response);
+                } else if (method == "close") {
+                    m_Documents.erase(GetDocumentName(request));
+                    response.Member("success", true);
+                } else if (method == "ping") {
+                    response.Member("success", true);
+                } else if (method == "shutdown") {
+                    m_ShutdownRequested = true;
+                    response.Member("success", true);
+                } else {
+                    WriteFailure(response, std::format("Unknown method '{}'", method));
+                }
+            } catch (const Core::DiagnosticError &e) {
+                response.Member("success", false);
+                WriteDiagnostics(response, std::nullopt, e.GetDiagnostics());
+            } catch (const std::exception &e) {
+                WriteFailure(response, e.what());
+            }
+
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start);
+            response.Member("elapsedMicroseconds", elapsed.count());
+            return response.EndObject().TakeOutput();
+        }
+
+        void Compile(const YAML::Node &request, Core::Json::JsonWriter &response) {
+            if (!request["source"])
+                throw std::runtime_error("Compile request has no 'source'");
+
+            auto name = request["name"] ? request["name"].as<std::string>() : std::string("image");
+            std::vector<Core::Output::OutputFormat> formats;
+            if (request["formats"]) {
+                for (const auto &formatName: request["formats"]) {
+                    auto format = Core::Output::ParseOutputFormat(formatName.as<std::string>());
+                    if (!format)
+                        throw std::runtime_error(std::format("Unknown output format '{}'", formatName.as<std::string>()));
+                    formats.push_back(*format);
+                }
+            } else {
+                formats = m_Compiler.GetOutputFormats();
+            }
+
+            Core::SourceCompiler sourceCompiler{m_Compiler.CreateSourceCompiler(request["source"].as<std::string>())};
+            sourceCompiler.CompileAll();
+            sourceCompiler.Link();
+
+            struct EncodedOutput {
+                std::string_view Format;
+                std::string_view Encoding;
+                std::string Data;
+            };
+
+            // everything is generated before writing, so a failure cannot leave a half written response
+            std::vector<EncodedOutput> outputs;
+            if (formats.empty()) {
+                outputs.push_back({"mem", "text", sourceCompiler.GenerateOutput()});
+            }
+            for (auto format: formats) {
+                Core::Output::StringSink sink;
+                sourceCompiler.EmitOutput(format, sink, name);
+                if (format == Core::Output::OutputFormat::Binary) {
+                    outputs.push_back({"bin", "base64", EncodeBase64(sink.GetOutput())});
+                } else {
+                    outputs.push_back({
+                        Core::Output::GetFileExtension(format).substr(1), "text", std::move(sink.GetOutput())
+                    });
+                }
+            }
+
+            response.Member("success", true);
+            response.Key("outputs").BeginArray();
+            for (const auto &output: outputs) {
+                response.BeginObject()
+                        .Member("format", output.Format)
+                        .Member("encoding", output.Encoding)
+                        .Member("data", output.Data)
+                        .EndObject();
+            }
+            response.EndArray();
+            WriteDiagnostics(response, std::nullopt);
+        }
+
+        static std::string GetDocumentName(const YAML::Node &request) {
+            return request["document"] ? request["document"].as<std::string>() : std::string("image");
+        }
+
+        // Reassembles an open document from its whole new text, encoding only the lines that need it, and
+        // answers with the machine code of every line.
+        void Update(const YAML::Node &request, Core::Json::JsonWriter &response) {
+            if (!request["source"])
+                throw std::runtime_error("Update request has no 'source'");
+
+            auto [document, opened] = m_Documents.try_emplace(GetDocumentName(request));
+            if (opened) {
+                document->second = std::make_unique<Core::Incremental::IncrementalAssembler>(m_Compiler);
+            }
+            auto &assembler = *document->second;
+            auto result = assembler.Update(request["source"].as<std::string>());
+
+            size_t wordWidth = m_Compiler.GetImageLayout().WordWidth;
+            const auto &image = assembler.GetImage();
+            response.Member("success", result.Success);
+            response.Key("encodedLines").BeginArray();
+            for (auto line: result.EncodedLines) {
+                response.Number(line);
+            }
+            response.EndArray();
+            response.Key("lines").BeginArray();
+            auto lines = assembler.GetLines();
+            for (size_t i = 0; i < lines.size(); ++i) {
+                const auto &line = lines[i];
+                if (line.Bits.Empty() || line.Placement)
+                    continue; // nothing, or only the padding up to the placed code
+                response.BeginObject()
+                        .Member("line", i + 1)
+                        .Member("address", line.BitBegin / wordWidth);
+                response.Key("words").BeginArray();
+                uint64_t end = std::min<uint64_t>(line.GetBitEnd(), image.Size());
+                for (uint64_t bit = line.BitBegin; bit + wordWidth <= end; bit += wordWidth) {
+                    response.Number(image.ReadBits(bit, wordWidth));
+                }
+                response.EndArray().EndObject();
+            }
+            response.EndArray();
+            WriteDiagnostics(response, std::nullopt, assembler.GetDiagnostics());
+        }
+
+        void WriteFailure(Core::Json::JsonWriter &response, std::string_view error) {
+            response.Member("success", false);
+            WriteDiagnostics(response, error);
+        }
+
+        void WriteDiagnostics(Core::Json::JsonWriter &response, std::optional<std::string_view> error,
+                              std::span<const Core::Diagnostic> diagnostics = {}) {
+            response.Key("diagnostics").BeginArray();
+            for (const auto &message: m_Messages) {
+                response.BeginObject().Member("severity", "info").Member("message", message).EndObject();
+            }
+            for (const auto &diagnostic: diagnostics) {
+                response.BeginObject().Member("severity", Core::GetSeverityName(diagnostic.Level));
+                if (diagnostic.Span) {
+                    response.Member("line", diagnostic.Span->Begin.Line)
+                            .Member("column", diagnostic.Span->Begin.Column);
+                }
+                response.Member("message", diagnostic.Message).EndObject();
+            }
+            if (error) {
+                response.BeginObject().Member("severity", "error").Member("message", *error).EndObject();
+            }
+            response.EndArray();
+        }
+
+        static void WriteId(Core::Json::JsonWriter &response, const YAML::Node &id) {
+            response.Key("id");
+            if (!id || !id.IsScalar()) {
+                response.Null();
+                return;
+            }
+            try {
+                response.Number(id.as<int64_t>());
+            } catch (const YAML::Exception &) {
+                response.String(id.as<std::string>());
+            }
+        }
+
+        Core::Compiler &m_Compiler;
+        std::unordered_map<std::string, std::unique_ptr<Core::Incremental::IncrementalAssembler>> m_Documents;
+        std::vector<std::string> m_Messages;
+        bool m_ShutdownRequested = false;
+    };
+
+    int RunSocketServer(ServerSession &session, const std::filesystem::path &socketPath) {
+#ifdef _WIN32
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+            std::cerr << "Error: Failed to initialize Winsock\n";
+            return 1;
+        }
+#endif
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        auto pathString = socketPath.string();
+        if (pathString.size() >= sizeof(address.sun_path)) {
+            std::cerr << "Error: Socket path is too long: " << pathString << "\n";
+            return 1;
+        }
+        std::memcpy(address.sun_path, pathString.c_str(), pathString.size() + 1);
+
+        NativeSocket listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener == invalidSocket) {
+            std::cerr << "Error: Failed to create socket\n";
+            return 1;
+        }
+
+        std::error_code ignored;
+        std::filesystem::remove(socketPath, ignored);
+        if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(listener, 8) != 0) {
+            std::cerr << "Error: Failed to listen on socket: " << pathString << "\n";
+            CloseSocket(listener);
+            return 1;
+        }
+
+        std::cerr << "EasyASM server listening on " << pathString << "\n";
+        // a persistent failure, e.g. out of file descriptors, is retried ever more slowly instead of spinning
+        constexpr auto maxAcceptBackoff = std::chrono::seconds(2);
+        std::chrono::milliseconds acceptBackoff{0};
+        while (!session.IsShutdownRequested()) {
+            NativeSocket client = accept(listener, nullptr, nullptr);
+            if (client == invalidSocket) {
+                if (acceptBackoff.count() == 0) {
+                    std::cerr << "Failed to accept a client connection: " << GetLastSocketError() << "\n";
+                }
+                acceptBackoff = std::min<std::chrono::milliseconds>(
+                    std::max(acceptBackoff * 2, std::chrono::milliseconds(10)), maxAcceptBackoff);
+                std::this_thread::sleep_for(acceptBackoff);
+                continue;
+            }
+            acceptBackoff = std::chrono::milliseconds(0);
+            try {
+                SocketChannel channel(client);
+                session.Serve(channel);
+            } catch (const std::exception &e) {
+                std::cerr << "Client connection failed: " << e.what() << "\n";
+            }
+        }
+
+        CloseSocket(listener);
+        std::filesystem::remove(socketPath, ignored);
+        return 0;
+    }
+}
+
+// Keeps one Compiler (and its Lua state and parsed language specification) resident and serves compile
+// requests over stdin/stdout, or over a local socket when --socket is given.
+export int RunServer(const ProgramPaths &paths) {
+    std::unique_ptr<Core::Compiler> compiler;
+    try {
+        compiler = std::make_unique<Core::Compiler>(paths.GetLanguageRootDir());
+    } catch (const std::exception &e) {
+        std::cerr << std::format("Failed to load language: {}\n", e.what());
+        return 1;
+    }
+
+    ServerSession session(*compiler);
+    if (paths.GetSocketPath()) {
+        return RunSocketServer(session, *paths.GetSocketPath());
+    }
+
+    try {
+        StdioChannel channel;
+        session.Serve(channel);
+    } catch (const std::exception &e) {
+        std::cerr << "Server failed: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
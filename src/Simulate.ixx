@@ -0,0 +1,97 @@
+export module Simulate;
+
+import std;
+import FindPaths;
+import Core.Compiler;
+import Core.Assembler;
+import Core.WorkerPool;
+import Core.Simulator;
+import Core.SimulationTest;
+
+namespace {
+    struct TestOutcome {
+        std::optional<Core::Sim::SimulationResult> Result;
+        std::string Error; // the test could not be run at all
+    };
+
+    // Like a batch worker, the Compiler is only created for the first test that names a source.
+    struct SimulationWorker {
+        const ProgramPaths &Paths;
+        std::unique_ptr<Core::Compiler> Compiler;
+
+        std::shared_ptr<const Core::Sim::Program> LoadProgram(const Core::Sim::SimulationTest &test) {
+            if (test.ImagePath) {
+                return std::make_shared<const Core::Sim::Program>(Core::Sim::Program::FromMemFile(*test.ImagePath));
+            }
+            if (!Compiler) {
+                Compiler = std::make_unique<Core::Compiler>(Paths.GetLanguageRootDir());
+            }
+            return std::make_shared<const Core::Sim::Program>(
+                Core::Sim::Program::FromBitBuffer(Core::AssembleImage(*Compiler, *test.SourcePath)));
+        }
+    };
+
+    std::string ToDisplayString(const std::filesystem::path &path) {
+        std::u8string u8str = path.u8string();
+        return std::string(reinterpret_cast<const char *>(u8str.c_str()), u8str.size());
+    }
+}
+
+// Runs every input as a simulation test (see Core::Sim::SimulationTest) on a pool of workers and reports
+// them in input order. Returns 1 if any test fails or cannot be run.
+export int RunSimulations(const ProgramPaths &paths) {
+    const auto &testPaths = paths.GetSourceFilePaths();
+    size_t threadCount = paths.GetJobCount() == 0 ? Core::GetDefaultWorkerCount() : paths.GetJobCount();
+    std::vector<TestOutcome> outcomes(testPaths.size());
+    auto start = std::chrono::steady_clock::now();
+
+    Core::ParallelForEach(
+        testPaths.size(), threadCount,
+        [&] {
+            return SimulationWorker{paths};
+        },
+        [&](SimulationWorker &worker, size_t index) {
+            auto &outcome = outcomes[index];
+            try {
+                auto test = Core::Sim::LoadSimulationTest(testPaths[index]);
+                outcome.Result = Core::Sim::RunSimulationTest(test, worker.LoadProgram(test));
+            } catch (const std::exception &e) {
+                outcome.Error = e.what();
+            } catch (...) {
+                outcome.Error = "unknown error";
+            }
+        });
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    size_t passed = 0;
+    uint64_t totalCycles = 0;
+    for (size_t i = 0; i < testPaths.size(); ++i) {
+        const auto &outcome = outcomes[i];
+        auto name = ToDisplayString(testPaths[i]);
+        if (!outcome.Result) {
+            std::cerr << std::format("ERROR {}:\n{}\n", name, outcome.Error);
+            continue;
+        }
+
+        const auto &result = *outcome.Result;
+        totalCycles += result.Cycles;
+        if (result.Passed) {
+            ++passed;
+            std::cout << std::format("PASS  {} ({}, {} cycles)\n", name,
+                                     Core::Sim::GetStopReasonName(result.Stop), result.Cycles);
+        } else {
+            std::cout << std::format("FAIL  {} ({} cycles)\n", name, result.Cycles);
+            for (const auto &failure: result.Failures) {
+                std::cout << std::format("      {}\n", failure);
+            }
+        }
+    }
+
+    size_t failed = testPaths.size() - passed;
+    std::cout << std::format("Simulation finished: {} passed, {} failed ({} tests, {} cycles, {} threads, {} ms)\n",
+                             passed, failed, testPaths.size(), totalCycles,
+                             std::min(threadCount, testPaths.size()), elapsed.count());
+    return failed == 0 ? 0 : 1;
+}